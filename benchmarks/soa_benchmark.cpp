@@ -0,0 +1,253 @@
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <soa.hpp>
+
+// Benchmarks whose containers would use more memory than this are not registered
+#ifndef SOA_BENCHMARK_MAX_BYTES
+#define SOA_BENCHMARK_MAX_BYTES (size_t(2) << 30)
+#endif
+
+// Largest size for the benchmarks that shift half of the container on each iteration
+#ifndef SOA_BENCHMARK_MAX_SHIFT_SIZE
+#define SOA_BENCHMARK_MAX_SHIFT_SIZE size_t(1000000)
+#endif
+
+template<typename F>
+struct Fields2 {
+	F f0, f1;
+};
+
+template<typename F>
+struct Fields4 {
+	F f0, f1, f2, f3;
+};
+
+template<typename F>
+struct Fields8 {
+	F f0, f1, f2, f3, f4, f5, f6, f7;
+};
+
+template<typename F>
+struct Fields16 {
+	F f0, f1, f2, f3, f4, f5, f6, f7;
+	F f8, f9, f10, f11, f12, f13, f14, f15;
+};
+
+template<typename F>
+struct Fields32 {
+	F f0, f1, f2, f3, f4, f5, f6, f7;
+	F f8, f9, f10, f11, f12, f13, f14, f15;
+	F f16, f17, f18, f19, f20, f21, f22, f23;
+	F f24, f25, f26, f27, f28, f29, f30, f31;
+};
+
+// Containers under test, with std::vector<T> as the array of structures baseline
+template<typename T>
+using AoS = std::vector<T>;
+template<typename T>
+using SoA = soa::soa<T>;
+template<typename T>
+using BlockSoA = soa::soa<T, std::allocator<T>, soa::block_storage>;
+
+template<template<typename> typename Container>
+constexpr const char *container_name = "";
+template<>
+constexpr const char *container_name<AoS> = "aos";
+template<>
+constexpr const char *container_name<SoA> = "soa";
+template<>
+constexpr const char *container_name<BlockSoA> = "soa_block";
+
+template<typename F>
+constexpr const char *field_name = "";
+template<>
+constexpr const char *field_name<float> = "float";
+template<>
+constexpr const char *field_name<std::string> = "string";
+
+template<typename T>
+T make_value(size_t index) {
+	T value;
+	reflect::for_each<T>([&](auto I) {
+		using F = std::remove_cvref_t<decltype(reflect::get<I>(value))>;
+		if constexpr (std::is_same_v<F, std::string>) {
+			reflect::get<I>(value) = std::to_string(index + I);
+		}
+		else {
+			reflect::get<I>(value) = F(index + I);
+		}
+	});
+	return value;
+}
+
+// Cheap value derived from a field, so that loops must read it
+inline size_t weight(float value) {
+	return size_t(value);
+}
+inline size_t weight(const std::string& value) {
+	return value.size();
+}
+
+template<typename Container>
+Container make_container(size_t size) {
+	using T = typename Container::value_type;
+	Container container;
+	container.reserve(size);
+	for (size_t i = 0; i < size; i++) {
+		container.push_back(make_value<T>(i));
+	}
+	return container;
+}
+
+template<template<typename> typename Container, typename T>
+void BM_push_back(benchmark::State& state) {
+	size_t size = state.range(0);
+	T value = make_value<T>(1);
+	for (auto _ : state) {
+		Container<T> container;
+		for (size_t i = 0; i < size; i++) {
+			container.push_back(value);
+		}
+		benchmark::DoNotOptimize(container.size());
+	}
+	state.SetItemsProcessed(state.iterations() * size);
+}
+
+template<template<typename> typename Container, typename T>
+void BM_emplace_back(benchmark::State& state) {
+	size_t size = state.range(0);
+	auto fields = reflect::to<std::tuple>(make_value<T>(1));
+	for (auto _ : state) {
+		Container<T> container;
+		for (size_t i = 0; i < size; i++) {
+			std::apply([&](const auto&... field) {
+				container.emplace_back(field...);
+			}, fields);
+		}
+		benchmark::DoNotOptimize(container.size());
+	}
+	state.SetItemsProcessed(state.iterations() * size);
+}
+
+template<template<typename> typename Container, typename T>
+void BM_insert_middle(benchmark::State& state) {
+	auto container = make_container<Container<T>>(state.range(0));
+	T value = make_value<T>(1);
+	for (auto _ : state) {
+		// pop_back keeps the size constant, so every iteration shifts the same number of elements
+		container.insert(container.begin() + container.size() / 2, value);
+		container.pop_back();
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+template<template<typename> typename Container, typename T>
+void BM_erase_middle(benchmark::State& state) {
+	auto container = make_container<Container<T>>(state.range(0));
+	T value = make_value<T>(1);
+	for (auto _ : state) {
+		// push_back keeps the size constant, so every iteration shifts the same number of elements
+		container.erase(container.begin() + container.size() / 2);
+		container.push_back(value);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+template<template<typename> typename Container, typename T>
+void BM_iterate_all_fields(benchmark::State& state) {
+	auto container = make_container<Container<T>>(state.range(0));
+	for (auto _ : state) {
+		size_t sum = 0;
+		for (auto&& element : container) {
+			reflect::for_each<T>([&](auto I) {
+				if constexpr (std::is_same_v<Container<T>, AoS<T>>) {
+					sum += weight(reflect::get<I>(element));
+				}
+				else {
+					sum += weight(element.template field<I>());
+				}
+			});
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * container.size());
+}
+
+template<template<typename> typename Container, typename T>
+void BM_scan_column(benchmark::State& state) {
+	auto container = make_container<Container<T>>(state.range(0));
+	for (auto _ : state) {
+		size_t sum = 0;
+		if constexpr (std::is_same_v<Container<T>, AoS<T>>) {
+			for (const T& element : container) {
+				sum += weight(element.f1);
+			}
+		}
+		else {
+			for (const auto& value : container.template field<1>()) {
+				sum += weight(value);
+			}
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * container.size());
+}
+
+template<typename Fn>
+void register_benchmark(const std::string& name, size_t element_size, size_t max_size, Fn fn) {
+	auto *benchmark = benchmark::RegisterBenchmark(name.c_str(), fn);
+	for (size_t size = 1000; size <= 100000000 && size <= max_size; size *= 10) {
+		if (size * element_size <= SOA_BENCHMARK_MAX_BYTES) {
+			benchmark->Arg(size);
+		}
+	}
+}
+
+template<template<typename> typename Container, template<typename> typename Fields, typename F>
+void register_benchmarks(const char *width) {
+	using T = Fields<F>;
+	// Strings made by make_value fit in the small string buffer, so sizeof(T) is the whole element size
+	size_t element_size = sizeof(T);
+	std::string suffix = std::string("<") + container_name<Container> + ", " + width + "x" + field_name<F> + ">";
+	register_benchmark("push_back" + suffix, element_size, SIZE_MAX, BM_push_back<Container, T>);
+	register_benchmark("emplace_back" + suffix, element_size, SIZE_MAX, BM_emplace_back<Container, T>);
+	register_benchmark("insert_middle" + suffix, element_size, SOA_BENCHMARK_MAX_SHIFT_SIZE, BM_insert_middle<Container, T>);
+	register_benchmark("erase_middle" + suffix, element_size, SOA_BENCHMARK_MAX_SHIFT_SIZE, BM_erase_middle<Container, T>);
+	register_benchmark("iterate_all_fields" + suffix, element_size, SIZE_MAX, BM_iterate_all_fields<Container, T>);
+	register_benchmark("scan_column" + suffix, element_size, SIZE_MAX, BM_scan_column<Container, T>);
+}
+
+template<template<typename> typename Container, typename F>
+void register_widths() {
+	register_benchmarks<Container, Fields2, F>("2");
+	register_benchmarks<Container, Fields4, F>("4");
+	register_benchmarks<Container, Fields8, F>("8");
+	register_benchmarks<Container, Fields16, F>("16");
+	register_benchmarks<Container, Fields32, F>("32");
+}
+
+template<typename F>
+void register_containers() {
+	register_widths<AoS, F>();
+	register_widths<SoA, F>();
+	register_widths<BlockSoA, F>();
+}
+
+int main(int argc, char **argv) {
+	register_containers<float>();
+	register_containers<std::string>();
+
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+		return 1;
+	}
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
@@ -1,630 +1,6692 @@
 #ifndef __SOA_HPP__
 #define __SOA_HPP__
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <compare>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#ifdef SOA_EXECUTION_POLICIES
+#include <execution>
+#endif
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <numeric>
+#include <ranges>
 #include <span>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
 #include <utility>
+#include <variant>
 #include <vector>
 
 #include "reflect/reflect"
 
 namespace soa {
 
-namespace detail {
-	/// Templated metafunction to transform each of a tuple's type
-	template<template<typename> typename Transformer, typename... Ts>
-	auto transform_tuple_types(std::tuple<Ts...>) -> std::tuple<Transformer<Ts>...>;
-
-	/// Union used to workaround std::vector<bool> specialization
-	union union_bool {
-		bool value;
-
-		union_bool() : value(false) {}
-		union_bool(bool value) : value(value) {}
-		operator bool() const { return value; }
-	};
-
-	/// Convert bool -> union_bool
-	template<typename T>
-	using bool_to_union = std::conditional_t<std::is_same_v<std::remove_cv_t<T>, bool>, union_bool, T>;
+/**
+ * Span whose data is guaranteed to start at an `Alignment` byte boundary, as returned by `soa::aligned_field`.
+ * `data()` is marked with `std::assume_aligned`, so that compilers can use aligned SIMD loads and stores.
+ * Elements in [`size()`, `padded_size()`) are inside the allocation, but are not constructed.
+ * Kernels may process them to avoid scalar epilogues, as long as their values are not used.
+ */
+template<typename U, size_t Alignment>
+class aligned_span : public std::span<U> {
+public:
+	static constexpr size_t alignment = Alignment;
 
-	/// Convert union_bool -> bool
-	template<typename T>
-	using union_to_bool = std::conditional_t<std::is_same_v<std::remove_cv_t<T>, union_bool>, bool, T>;
+	aligned_span(U *data, size_t size, size_t padded_size)
+		: std::span<U>(data, size)
+		, padded(padded_size)
+	{
+	}
 
-	/// Get a span from a vector, converting union_bool -> bool
-	template<typename T>
-	auto vector_to_span(std::vector<T>& v) {
-		return std::span((union_to_bool<T> *) v.data(), v.size());
+	U *data() const {
+		return std::assume_aligned<Alignment>(std::span<U>::data());
 	}
-	template<typename T>
-	auto vector_to_span(const std::vector<T>& v) {
-		return std::span((const union_to_bool<T> *) v.data(), v.size());
+
+	/// Size rounded up to a whole number of `Alignment` byte SIMD vectors
+	size_t padded_size() const {
+		return padded;
 	}
 
-	/// Tuple of vectors, one for each field of type T
-	template<typename T>
-	using fields_vector_tuple = decltype(
-		transform_tuple_types<std::vector>(
-			transform_tuple_types<bool_to_union>(
-				reflect::to<std::tuple>(std::declval<T>())
-			)
-		)
-	);
-}
+private:
+	size_t padded;
+};
 
 /**
- * Structure of Arrays (SoA) container for aggregate type T.
+ * Tuple with copies of the selected fields of an element, the value type of `field_view` iterators.
+ * It is a distinct type so that it has a common reference with the tuples of references yielded by views.
+ */
+template<typename... U>
+struct field_tuple : std::tuple<U...> {
+	using std::tuple<U...>::tuple;
+};
+
+/**
+ * Proxy reference to the selected fields of an element, the reference type of `field_view` iterators.
+ * It is a tuple of references, so structured bindings and `std::get` work on it,
+ * but assigning to it assigns the referred fields, even through a const proxy, like `_reference` does.
  *
- * Each field of T is stored in a separate std::vector, allowing for better data locality and cache performance.
- * It provides an API similar to std::vector, allowing for easy manipulation of the data including usage of STL algorithms.
- * Individual elements can be accessed and modified through a proxy object that provides access to the underlying fields.
+ * @code
+ * view[i] = view[j];
+ * @endcode
  */
-template<typename T>
-class soa {
-	template<typename _soa> struct _reference;
-	template<typename _soa> struct _iterator;
+template<typename... U>
+struct field_reference : std::tuple<U&...> {
+	using value_type = field_tuple<std::remove_cv_t<U>...>;
 
-public:
-	using reference = _reference<soa>;
-	using const_reference = _reference<const soa>;
-	using iterator = _iterator<soa>;
-	using const_iterator = _iterator<const soa>;
+	using std::tuple<U&...>::tuple;
+	field_reference(const field_reference&) = default;
 
-	soa() = default;
-	explicit soa(size_t count) {
-		for_each_vector([&](auto&& vec, auto&& field) {
-			vec.assign(count, field);
-		}, T{});
-	}
-	soa(size_t count, const T& value) {
-		for_each_vector([&](auto&& vec, auto&& field) {
-			vec.assign(count, field);
-		}, value);
-	}
-	template<typename InputIt>
-	soa(InputIt first, InputIt last) {
-		insert(end(), first, last);
+	/**
+	 * Assign `value`'s fields to the referred fields.
+	 */
+	field_reference& operator=(const value_type& value) requires (!std::is_const_v<U> && ...) {
+		assign(value);
+		return *this;
 	}
-	soa(const soa& other) = default;
-	soa(soa&& other) = default;
-	soa(std::initializer_list<T> ilist) {
-		insert(end(), ilist);
+	field_reference& operator=(value_type&& value) requires (!std::is_const_v<U> && ...) {
+		assign(std::move(value));
+		return *this;
 	}
-
-	soa& operator=(const soa& other) = default;
-	soa& operator=(soa&& other) = default;
-	soa& operator=(std::initializer_list<T> ilist) {
-		assign(ilist);
+	const field_reference& operator=(const value_type& value) const requires (!std::is_const_v<U> && ...) {
+		assign(value);
+		return *this;
+	}
+	const field_reference& operator=(value_type&& value) const requires (!std::is_const_v<U> && ...) {
+		assign(std::move(value));
+		return *this;
+	}
+	field_reference& operator=(const field_reference& value) requires (!std::is_const_v<U> && ...) {
+		assign(value);
+		return *this;
+	}
+	const field_reference& operator=(const field_reference& value) const requires (!std::is_const_v<U> && ...) {
+		assign(value);
 		return *this;
 	}
 
-	void assign(size_t count, const T& value) {
-		clear();
-		for_each_vector([&](auto&& vec, auto&& field) {
-			vec.assign(count, field);
-		}, value);
+	/**
+	 * Swap the referred fields with the ones referred by `other`.
+	 */
+	void swap(const field_reference& other) const requires (!std::is_const_v<U> && ...) {
+		[&]<auto... Ns>(std::index_sequence<Ns...>) {
+			using std::swap;
+			(swap(std::get<Ns>(*this), std::get<Ns>(other)), ...);
+		}(std::index_sequence_for<U...>{});
 	}
-	template<typename InputIt>
-	void assign(InputIt first, InputIt last) {
-		clear();
-		insert(end(), first, last);
+	friend void swap(field_reference a, field_reference b) requires (!std::is_const_v<U> && ...) {
+		a.swap(b);
 	}
-	void assign(std::initializer_list<T> ilist) {
-		clear();
-		insert(end(), ilist);
+
+private:
+	template<typename Tuple>
+	void assign(Tuple&& value) const {
+		[&]<auto... Ns>(std::index_sequence<Ns...>) {
+			((std::get<Ns>(*this) = std::get<Ns>(std::forward<Tuple>(value))), ...);
+		}(std::index_sequence_for<U...>{});
 	}
+};
 
-	// Element access
-	reference at(size_t index) {
-		if (index >= size()) {
-			throw std::out_of_range("Index out of range");
+/**
+ * Non-owning view over some field arrays of a SoA, as returned by `soa::view`.
+ * Iterating yields `field_reference` proxies to the selected fields only, so loops don't touch other columns.
+ * `iter_move` and `iter_swap` act on the selected fields, so views can be sorted with `std::ranges::sort`.
+ * Views are invalidated together with the iterators of the SoA they came from.
+ *
+ * @code
+ * for (auto [x, vx] : soa.view<"x", "vx">()) {
+ *     x += vx;
+ * }
+ * @endcode
+ */
+template<typename... U>
+class field_view : public std::ranges::view_interface<field_view<U...>> {
+public:
+	class iterator {
+	public:
+		using iterator_concept = std::random_access_iterator_tag;
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = field_tuple<std::remove_cv_t<U>...>;
+		using difference_type = std::ptrdiff_t;
+		using reference = field_reference<U...>;
+		using pointer = void;
+
+		iterator() = default;
+		iterator(std::tuple<U*...> columns, difference_type index) : columns(columns), index(index) {}
+
+		iterator& operator++() {
+			++index;
+			return *this;
 		}
-		return reference(this, index);
-	}
-	const_reference at(size_t index) const {
-		if (index >= size()) {
-			throw std::out_of_range("Index out of range");
+		iterator operator++(int) {
+			iterator previous = *this;
+			++index;
+			return previous;
 		}
-		return const_reference(this, index);
+
+		iterator& operator+=(difference_type n) {
+			index += n;
+			return *this;
+		}
+
+		iterator& operator--() {
+			--index;
+			return *this;
+		}
+		iterator operator--(int) {
+			iterator previous = *this;
+			--index;
+			return previous;
+		}
+
+		iterator& operator-=(difference_type n) {
+			index -= n;
+			return *this;
+		}
+
+		iterator operator+(difference_type n) const {
+			return iterator(columns, index + n);
+		}
+		friend iterator operator+(difference_type n, const iterator& it) {
+			return it + n;
+		}
+
+		iterator operator-(difference_type n) const {
+			return iterator(columns, index - n);
+		}
+		difference_type operator-(const iterator& other) const {
+			return index - other.index;
+		}
+
+		bool operator==(const iterator& other) const {
+			return index == other.index;
+		}
+		std::strong_ordering operator<=>(const iterator& other) const {
+			return index <=> other.index;
+		}
+
+		reference operator*() const {
+			return std::apply([&](U*... columns) {
+				return reference(columns[index]...);
+			}, columns);
+		}
+		reference operator[](difference_type n) const {
+			return *(*this + n);
+		}
+
+		/**
+		 * Construct a value by moving the selected fields out of the pointed element.
+		 * Used by ranges algorithms, like `std::ranges::sort`.
+		 */
+		friend value_type iter_move(const iterator& it) {
+			return std::apply([&](U*... columns) {
+				return value_type(std::move(columns[it.index])...);
+			}, it.columns);
+		}
+
+		/**
+		 * Swap the selected fields of the pointed elements in place.
+		 * Used by ranges algorithms, like `std::ranges::sort`.
+		 */
+		friend void iter_swap(const iterator& a, const iterator& b) requires (!std::is_const_v<U> && ...) {
+			(*a).swap(*b);
+		}
+
+	private:
+		std::tuple<U*...> columns;
+		difference_type index = 0;
+	};
+
+	field_view() = default;
+	field_view(size_t size, U*... columns) : columns(columns...), count(size) {}
+
+	iterator begin() const {
+		return iterator(columns, 0);
+	}
+	iterator end() const {
+		return iterator(columns, count);
 	}
 
-	reference operator[](size_t index) {
-		return reference(this, index);
+	size_t size() const {
+		return count;
 	}
-	const_reference operator[](size_t index) const {
-		return const_reference(this, index);
+
+	/// Span over the J-th selected field array
+	template<size_t J>
+	std::span<std::tuple_element_t<J, std::tuple<U...>>> field() const {
+		return { std::get<J>(columns), count };
 	}
 
-	template<size_t I>
-	auto field() {
-		return detail::vector_to_span(get_vector<I>());
+private:
+	std::tuple<U*...> columns;
+	size_t count = 0;
+};
+
+/**
+ * Iterator over a field array stored in tiles, see `tiled_span`.
+ * `tiles` points to the field array of the first tile, the next tile's array being `Stride` bytes after it.
+ */
+template<typename U, size_t N, size_t Stride>
+class tiled_iterator {
+	using byte_type = std::conditional_t<std::is_const_v<U>, const std::byte, std::byte>;
+
+public:
+	using iterator_concept = std::random_access_iterator_tag;
+	using iterator_category = std::random_access_iterator_tag;
+	using value_type = std::remove_cv_t<U>;
+	using difference_type = std::ptrdiff_t;
+	using reference = U&;
+	using pointer = U*;
+
+	tiled_iterator() = default;
+	tiled_iterator(byte_type *tiles, difference_type index) : tiles(tiles), index(index) {}
+	template<typename V> requires std::same_as<const V, U>
+	tiled_iterator(const tiled_iterator<V, N, Stride>& other) : tiles(other.tiles), index(other.index) {}
+
+	tiled_iterator& operator++() {
+		++index;
+		return *this;
 	}
-	template<size_t I>
-	auto field() const {
-		return detail::vector_to_span(get_vector<I>());
+	tiled_iterator operator++(int) {
+		tiled_iterator previous = *this;
+		++index;
+		return previous;
 	}
 
-	template<reflect::fixed_string FieldName>
-	auto field() {
-		constexpr size_t I = reflect::index_of<FieldName, T>();
-		return field<I>();
+	tiled_iterator& operator+=(difference_type n) {
+		index += n;
+		return *this;
 	}
-	template<reflect::fixed_string FieldName>
-	auto field() const {
-		constexpr size_t I = reflect::index_of<FieldName, T>();
-		return field<I>();
+
+	tiled_iterator& operator--() {
+		--index;
+		return *this;
+	}
+	tiled_iterator operator--(int) {
+		tiled_iterator previous = *this;
+		--index;
+		return previous;
 	}
 
-	template<typename U>
-	auto field() {
-		return detail::vector_to_span(get_vector<detail::bool_to_union<U>>());
+	tiled_iterator& operator-=(difference_type n) {
+		index -= n;
+		return *this;
 	}
-	template<typename U>
-	auto field() const {
-		return detail::vector_to_span(get_vector<detail::bool_to_union<U>>());
+
+	tiled_iterator operator+(difference_type n) const {
+		return tiled_iterator(tiles, index + n);
+	}
+	friend tiled_iterator operator+(difference_type n, const tiled_iterator& it) {
+		return it + n;
 	}
 
-	reference front() {
-		return reference(this, 0);
+	tiled_iterator operator-(difference_type n) const {
+		return tiled_iterator(tiles, index - n);
 	}
-	const_reference front() const {
-		return const_reference(this, 0);
+	difference_type operator-(const tiled_iterator& other) const {
+		return index - other.index;
 	}
 
-	reference back() {
-		return reference(this, size() - 1);
+	bool operator==(const tiled_iterator& other) const {
+		return tiles == other.tiles
+			&& index == other.index;
 	}
-	const_reference back() const {
-		return const_reference(this, size() - 1);
+	std::strong_ordering operator<=>(const tiled_iterator& other) const {
+		return index <=> other.index;
 	}
 
-	// Iterators
-	iterator begin() {
-		return iterator(this, 0);
+	reference operator*() const {
+		size_t i = index;
+		return *reinterpret_cast<U *>(tiles + i / N * Stride + i % N * sizeof(U));
 	}
-	const_iterator begin() const {
-		return const_iterator(this, 0);
+	pointer operator->() const {
+		return std::addressof(**this);
 	}
-	const_iterator cbegin() const {
-		return const_iterator(this, 0);
+	reference operator[](difference_type n) const {
+		return *(*this + n);
 	}
 
-	iterator end() {
-		return iterator(this, size());
-	}
-	const_iterator end() const {
-		return const_iterator(this, size());
+private:
+	template<typename, size_t, size_t> friend class tiled_iterator;
+	byte_type *tiles = nullptr;
+	difference_type index = 0;
+};
+
+/**
+ * Range over a field array stored by `tiled_storage`, as returned by `soa::field`.
+ * Elements are grouped in tiles of `N` contiguous elements, so `tile(k)` gives a span for vectorized loops.
+ *
+ * @code
+ * auto x = soa.field<"x">();
+ * for (size_t k = 0; k < x.tile_count(); k++) {
+ *     for (float& value : x.tile(k)) {
+ *         value *= 2;
+ *     }
+ * }
+ * @endcode
+ */
+template<typename U, size_t N, size_t Stride>
+class tiled_span {
+public:
+	using element_type = U;
+	using value_type = std::remove_cv_t<U>;
+	using iterator = tiled_iterator<U, N, Stride>;
+	using reference = U&;
+
+	static constexpr size_t tile_size = N;
+
+	tiled_span() = default;
+	tiled_span(iterator first, size_t size) : first(first), count(size) {}
+
+	iterator begin() const {
+		return first;
 	}
-	const_iterator cend() const {
-		return const_iterator(this, size());
+	iterator end() const {
+		return first + count;
 	}
 
-	// Capacity
+	size_t size() const {
+		return count;
+	}
 	bool empty() const {
-		return get_vector<0>().empty();
+		return count == 0;
 	}
 
-	size_t size() const {
-		return get_vector<0>().size();
+	reference operator[](size_t index) const {
+		return first[index];
+	}
+	reference front() const {
+		return first[0];
+	}
+	reference back() const {
+		return first[count - 1];
 	}
 
-	size_t max_size() const {
-		return get_vector<0>().max_size();
+	/// Number of tiles, the last one possibly partial
+	size_t tile_count() const {
+		return (count + N - 1) / N;
 	}
 
-	void reserve(size_t new_cap) {
-		for_each_vector([&](auto&& vec) {
-			vec.reserve(new_cap);
-		});
+	/// Contiguous elements of the k-th tile
+	std::span<U> tile(size_t k) const {
+		return std::span<U>(std::addressof(first[k * N]), std::min(N, count - k * N));
 	}
 
-	size_t capacity() const {
-		return get_vector<0>().capacity();
+private:
+	iterator first;
+	size_t count = 0;
+};
+
+/**
+ * Iterator over a field array stored in fixed-size chunks, see `chunked_span`.
+ * `chunks` points to the table of chunk pointers, each chunk being an array of `N` elements.
+ */
+template<typename U, size_t N>
+class chunked_iterator {
+	using chunk_pointer = std::remove_cv_t<U> *;
+
+public:
+	using iterator_concept = std::random_access_iterator_tag;
+	using iterator_category = std::random_access_iterator_tag;
+	using value_type = std::remove_cv_t<U>;
+	using difference_type = std::ptrdiff_t;
+	using reference = U&;
+	using pointer = U*;
+
+	chunked_iterator() = default;
+	chunked_iterator(const chunk_pointer *chunks, difference_type index) : chunks(chunks), index(index) {}
+	template<typename V> requires std::same_as<const V, U>
+	chunked_iterator(const chunked_iterator<V, N>& other) : chunks(other.chunks), index(other.index) {}
+
+	chunked_iterator& operator++() {
+		++index;
+		return *this;
+	}
+	chunked_iterator operator++(int) {
+		chunked_iterator previous = *this;
+		++index;
+		return previous;
 	}
 
-	void shrink_to_fit() {
-		for_each_vector([&](auto&& vec) {
-			vec.shrink_to_fit();
-		});
+	chunked_iterator& operator+=(difference_type n) {
+		index += n;
+		return *this;
 	}
 
-	// Modifiers
-	void clear() {
-		for_each_vector([&](auto&& vec) {
-			vec.clear();
-		});
+	chunked_iterator& operator--() {
+		--index;
+		return *this;
+	}
+	chunked_iterator operator--(int) {
+		chunked_iterator previous = *this;
+		--index;
+		return previous;
 	}
 
-	iterator insert(const_iterator pos, const T& value) {
-		size_t index = pos.index;
-		for_each_vector([&](auto&& vec, auto&& field) {
-			vec.insert(vec.begin() + index, field);
-		}, value);
-		return iterator(this, index);
+	chunked_iterator& operator-=(difference_type n) {
+		index -= n;
+		return *this;
 	}
-	iterator insert(const_iterator pos, size_t count, const T& value) {
-		for (size_t i = 0; i < count; ++i) {
-			insert(pos + i, value);
-		}
-		return iterator(this, pos.index);
+
+	chunked_iterator operator+(difference_type n) const {
+		return chunked_iterator(chunks, index + n);
 	}
-	template<typename InputIt>
-	iterator insert(const_iterator pos, InputIt first, InputIt last) {
-		size_t index = pos.index;
-		for (auto it = first; it != last; ++it, ++pos) {
-			insert(pos, *it);
-		}
-		return iterator(this, index);
+	friend chunked_iterator operator+(difference_type n, const chunked_iterator& it) {
+		return it + n;
 	}
-	iterator insert(const_iterator pos, std::initializer_list<T> ilist) {
-		size_t index = pos.index;
-		for (auto&& value : ilist) {
-			insert(pos++, value);
+
+	chunked_iterator operator-(difference_type n) const {
+		return chunked_iterator(chunks, index - n);
+	}
+	difference_type operator-(const chunked_iterator& other) const {
+		return index - other.index;
+	}
+
+	bool operator==(const chunked_iterator& other) const {
+		return chunks == other.chunks
+			&& index == other.index;
+	}
+	std::strong_ordering operator<=>(const chunked_iterator& other) const {
+		return index <=> other.index;
+	}
+
+	reference operator*() const {
+		size_t i = index;
+		return chunks[i / N][i % N];
+	}
+	pointer operator->() const {
+		return std::addressof(**this);
+	}
+	reference operator[](difference_type n) const {
+		return *(*this + n);
+	}
+
+private:
+	template<typename, size_t> friend class chunked_iterator;
+	const chunk_pointer *chunks = nullptr;
+	difference_type index = 0;
+};
+
+/**
+ * Range over a field array stored by `chunked_storage`, as returned by `soa::field`.
+ * Elements are stored in separately allocated chunks of `N` elements, so `tile(k)` gives a span over the k-th chunk for vectorized loops.
+ *
+ * @code
+ * auto x = soa.field<"x">();
+ * for (size_t k = 0; k < x.tile_count(); k++) {
+ *     for (float& value : x.tile(k)) {
+ *         value *= 2;
+ *     }
+ * }
+ * @endcode
+ */
+template<typename U, size_t N>
+class chunked_span {
+public:
+	using element_type = U;
+	using value_type = std::remove_cv_t<U>;
+	using iterator = chunked_iterator<U, N>;
+	using reference = U&;
+
+	static constexpr size_t tile_size = N;
+
+	chunked_span() = default;
+	chunked_span(iterator first, size_t size) : first(first), count(size) {}
+
+	iterator begin() const {
+		return first;
+	}
+	iterator end() const {
+		return first + count;
+	}
+
+	size_t size() const {
+		return count;
+	}
+	bool empty() const {
+		return count == 0;
+	}
+
+	reference operator[](size_t index) const {
+		return first[index];
+	}
+	reference front() const {
+		return first[0];
+	}
+	reference back() const {
+		return first[count - 1];
+	}
+
+	/// Number of chunks, the last one possibly partial
+	size_t tile_count() const {
+		return (count + N - 1) / N;
+	}
+
+	/// Contiguous elements of the k-th chunk
+	std::span<U> tile(size_t k) const {
+		return std::span<U>(std::addressof(first[k * N]), std::min(N, count - k * N));
+	}
+
+private:
+	iterator first;
+	size_t count = 0;
+};
+
+/**
+ * Proxy reference to a bit of a packed `bool` column, as returned by `bit_span<bool>`.
+ * Like `std::vector<bool>::reference`, it converts to `bool` and assigning to it sets the bit.
+ */
+class bit_reference {
+public:
+	bit_reference(std::uint64_t *word, std::uint64_t mask) : word(word), mask(mask) {}
+	bit_reference(const bit_reference& other) = default;
+
+	operator bool() const {
+		return (*word & mask) != 0;
+	}
+
+	const bit_reference& operator=(bool value) const {
+		if (value) {
+			*word |= mask;
 		}
-		return iterator(this, index);
+		else {
+			*word &= ~mask;
+		}
+		return *this;
+	}
+	const bit_reference& operator=(const bit_reference& other) const {
+		return operator=(bool(other));
 	}
 
-	iterator erase(const_iterator pos) {
-		for_each_vector([&](auto&& vec) {
-			vec.erase(vec.begin() + pos.index);
-		});
-		return iterator(this, pos.index);
+	void flip() const {
+		*word ^= mask;
 	}
-	iterator erase(const_iterator first, const_iterator last) {
-		size_t first_index = first.index;
-		size_t last_index = last.index;
-		for_each_vector([&](auto&& vec) {
-			vec.erase(vec.begin() + first_index, vec.begin() + last_index);
-		});
-		return iterator(this, first_index);
+
+	friend void swap(bit_reference a, bit_reference b) {
+		bool value = a;
+		a = bool(b);
+		b = value;
 	}
 
-	void push_back(const T& value) {
-		for_each_vector([&](auto&& vec, auto&& field) {
-			vec.push_back(field);
-		}, value);
+private:
+	std::uint64_t *word;
+	std::uint64_t mask;
+};
+
+/**
+ * Random access iterator over a packed `bool` column.
+ * `B` is `bool` for mutable iterators, dereferencing to `bit_reference`, or `const bool` for constant iterators.
+ */
+template<typename B>
+class bit_iterator {
+	using word_type = std::conditional_t<std::is_const_v<B>, const std::uint64_t, std::uint64_t>;
+
+public:
+	using iterator_concept = std::random_access_iterator_tag;
+	using iterator_category = std::random_access_iterator_tag;
+	using value_type = bool;
+	using difference_type = std::ptrdiff_t;
+	using reference = std::conditional_t<std::is_const_v<B>, bool, bit_reference>;
+	using pointer = void;
+
+	bit_iterator() = default;
+	bit_iterator(word_type *words, difference_type index) : words(words), index(index) {}
+	template<typename V> requires std::same_as<const V, B>
+	bit_iterator(const bit_iterator<V>& other) : words(other.words), index(other.index) {}
+
+	bit_iterator& operator++() {
+		++index;
+		return *this;
+	}
+	bit_iterator operator++(int) {
+		bit_iterator previous = *this;
+		++index;
+		return previous;
 	}
 
-	void pop_back() {
-		for_each_vector([&](auto&& vec) {
-			vec.pop_back();
-		});
+	bit_iterator& operator+=(difference_type n) {
+		index += n;
+		return *this;
 	}
 
-	void resize(size_t count) {
-		for_each_vector([&](auto&& vec) {
-			vec.resize(count);
-		});
+	bit_iterator& operator--() {
+		--index;
+		return *this;
 	}
-	void resize(size_t count, const T& value) {
-		for_each_vector([&](auto&& vec, auto&& field) {
-			vec.resize(count, field);
-		}, value);
+	bit_iterator operator--(int) {
+		bit_iterator previous = *this;
+		--index;
+		return previous;
 	}
 
-	void swap(soa& other) noexcept {
-		vectors.swap(other.vectors);
+	bit_iterator& operator-=(difference_type n) {
+		index -= n;
+		return *this;
+	}
+
+	bit_iterator operator+(difference_type n) const {
+		return bit_iterator(words, index + n);
+	}
+	friend bit_iterator operator+(difference_type n, const bit_iterator& it) {
+		return it + n;
+	}
+
+	bit_iterator operator-(difference_type n) const {
+		return bit_iterator(words, index - n);
+	}
+	difference_type operator-(const bit_iterator& other) const {
+		return index - other.index;
+	}
+
+	bool operator==(const bit_iterator& other) const {
+		return words == other.words
+			&& index == other.index;
+	}
+	std::strong_ordering operator<=>(const bit_iterator& other) const {
+		return index <=> other.index;
+	}
+
+	reference operator*() const {
+		std::uint64_t mask = std::uint64_t(1) << (index % 64);
+		if constexpr (std::is_const_v<B>) {
+			return (words[index / 64] & mask) != 0;
+		}
+		else {
+			return bit_reference(words + index / 64, mask);
+		}
+	}
+	reference operator[](difference_type n) const {
+		return *(*this + n);
 	}
 
 private:
-	detail::fields_vector_tuple<T> vectors;
+	template<typename> friend class bit_iterator;
+	word_type *words = nullptr;
+	difference_type index = 0;
+};
 
-	template<size_t I>
-	auto& get_vector() {
-		return std::get<I>(vectors);
+/**
+ * Range over a `bool` field packed by `packed_bool_storage`, one bit per element, as returned by `soa::field`.
+ * `B` is `bool` or `const bool`, like the element type of a std::span.
+ * Bits are stored in 64-bit words, the bits of the last word past `size()` being always zero,
+ * so `words()` can be scanned directly, 64 elements at a time.
+ *
+ * @code
+ * soa::bit_span<const bool> alive = soa.field<"alive">();
+ * size_t alive_count = alive.count();
+ * @endcode
+ */
+template<typename B>
+class bit_span {
+	using word_type = std::conditional_t<std::is_const_v<B>, const std::uint64_t, std::uint64_t>;
+
+public:
+	using element_type = B;
+	using value_type = bool;
+	using iterator = bit_iterator<B>;
+	using reference = typename iterator::reference;
+
+	static constexpr size_t word_bits = 64;
+
+	bit_span() = default;
+	bit_span(word_type *words, size_t size) : first_word(words), bit_count(size) {}
+	template<typename V> requires std::same_as<const V, B>
+	bit_span(const bit_span<V>& other) : first_word(other.first_word), bit_count(other.bit_count) {}
+
+	iterator begin() const {
+		return iterator(first_word, 0);
 	}
-	template<size_t I>
-	auto& get_vector() const {
-		return std::get<I>(vectors);
+	iterator end() const {
+		return iterator(first_word, bit_count);
 	}
 
-	template<typename U>
-	auto& get_vector() {
-		return std::get<std::vector<U>>(vectors);
+	size_t size() const {
+		return bit_count;
 	}
-	template<typename U>
-	auto& get_vector() const {
-		return std::get<std::vector<U>>(vectors);
+	bool empty() const {
+		return bit_count == 0;
 	}
 
-	template<typename Fn>
-	void for_each_vector(Fn&& fn) {
-		reflect::for_each<T>([&](auto I) {
-			fn(get_vector<I>());
-		});
+	reference operator[](size_t index) const {
+		return begin()[index];
 	}
-	template<typename Fn>
-	void for_each_vector(Fn&& fn) const {
-		reflect::for_each<T>([&](auto I) {
-			fn(get_vector<I>());
-		});
+	reference front() const {
+		return begin()[0];
+	}
+	reference back() const {
+		return begin()[bit_count - 1];
 	}
 
-	template<typename Fn, typename U>
-	void for_each_vector(Fn&& fn, U&& value) {
-		reflect::for_each<T>([&](auto I) {
-			auto&& field = reflect::get<I>(value);
-			fn(get_vector<I>(), field);
-		});
+	/// Words holding the bits, element `i` being bit `i % 64` of word `i / 64`
+	std::span<word_type> words() const {
+		return std::span<word_type>(first_word, (bit_count + word_bits - 1) / word_bits);
 	}
-	template<typename Fn, typename U>
-	void for_each_vector(Fn&& fn, U&& value) const {
-		reflect::for_each<T>([&](auto I) {
-			auto&& field = reflect::get<I>(value);
-			fn(get_vector<I>(), field);
-		});
+
+	/// Number of true elements
+	size_t count() const {
+		size_t result = 0;
+		for (std::uint64_t word : words()) {
+			result += std::popcount(word);
+		}
+		return result;
 	}
 
-	auto fields(size_t index) {
-		return [&]<auto... Ns>(std::index_sequence<Ns...>) {
-			return std::forward_as_tuple(std::get<Ns>(vectors)[index]...);
-		}(std::make_index_sequence<reflect::size<std::remove_cvref_t<T>>()>{});
+	/// Whether any element is true
+	bool any() const {
+		std::uint64_t bits = 0;
+		for (std::uint64_t word : words()) {
+			bits |= word;
+		}
+		return bits != 0;
 	}
-	auto fields(size_t index) const {
-		return [&]<auto... Ns>(std::index_sequence<Ns...>) {
-			return std::forward_as_tuple(std::get<Ns>(vectors)[index]...);
-		}(std::make_index_sequence<reflect::size<std::remove_cvref_t<T>>()>{});
+
+	/// Whether all elements are true, true when empty
+	bool all() const {
+		auto full_words = words().first(bit_count / word_bits);
+		std::uint64_t bits = ~std::uint64_t(0);
+		for (std::uint64_t word : full_words) {
+			bits &= word;
+		}
+		size_t remainder = bit_count % word_bits;
+		return bits == ~std::uint64_t(0)
+			&& (remainder == 0 || first_word[full_words.size()] == (std::uint64_t(1) << remainder) - 1);
+	}
+
+	/// Whether no element is true
+	bool none() const {
+		return !any();
+	}
+
+private:
+	template<typename> friend class bit_span;
+	word_type *first_word = nullptr;
+	size_t bit_count = 0;
+};
+
+namespace detail {
+	/// Templated metafunction to transform each of a tuple's type
+	template<template<typename> typename Transformer, typename... Ts>
+	auto transform_tuple_types(std::tuple<Ts...>) -> std::tuple<Transformer<Ts>...>;
+
+	/// Union used to workaround std::vector<bool> specialization
+	union union_bool {
+		bool value;
+
+		union_bool() : value(false) {}
+		union_bool(bool value) : value(value) {}
+		operator bool() const { return value; }
+	};
+
+	/// Convert bool -> union_bool
+	template<typename T>
+	using bool_to_union = std::conditional_t<std::is_same_v<std::remove_cv_t<T>, bool>, union_bool, T>;
+
+	/// Convert union_bool -> bool
+	template<typename T>
+	using union_to_bool = std::conditional_t<std::is_same_v<std::remove_cv_t<T>, union_bool>, bool, T>;
+
+	/// Get a span from a vector, converting union_bool -> bool
+	template<typename T, typename Allocator>
+	auto vector_to_span(std::vector<T, Allocator>& v) {
+		return std::span((union_to_bool<T> *) v.data(), v.size());
+	}
+	template<typename T, typename Allocator>
+	auto vector_to_span(const std::vector<T, Allocator>& v) {
+		return std::span((const union_to_bool<T> *) v.data(), v.size());
 	}
 
+	/// Allocator rebound to type U
+	template<typename Allocator, typename U>
+	using rebind_alloc = typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
+
+	/// std::vector of U that uses Allocator rebound to U
+	template<typename Allocator>
+	struct rebound_vector {
+		template<typename U>
+		using type = std::vector<U, rebind_alloc<Allocator, U>>;
+	};
+
 	/**
-	 * Reference to an element of the SoA.
-	 * Accessing `field` return a reference to the original field in the SoA, so it can be modified directly.
-	 * Accessing `value` or `operator*` constructs a new value from all fields that are stored separately in the parent SoA.
-	 * It is possible to assign a new value to all underlying fields of the parent SoA at once using `soa[i] = value`.
+	 * Vector of bits with the interface of std::vector<bool> used by `vector_columns`, exposing its 64-bit words.
+	 * Bits past `size()` in the last word are always zero, see `bit_span`.
 	 */
-	template<typename _soa>
-	struct _reference {
-		_reference(_soa *parent, size_t index) : parent(parent), index(index) {}
+	template<typename Allocator>
+	class bit_vector {
+		static constexpr size_t word_bits = bit_span<bool>::word_bits;
 
-		/**
-		 * Access the underlying field of the element of the SoA by index.
-		 *
-		 * @code
-		 * auto x = soa[i].field<0>();
-		 * soa[i].field<0>() = x;
-		 * @endcode
-		 */
-		template<size_t I>
-		auto& field() {
-			return parent->template field<I>()[index];
+	public:
+		using value_type = bool;
+		using allocator_type = rebind_alloc<Allocator, std::uint64_t>;
+		using iterator = bit_iterator<bool>;
+		using const_iterator = bit_iterator<const bool>;
+
+		bit_vector() = default;
+		explicit bit_vector(const allocator_type& alloc) : words(alloc) {}
+		bit_vector(const bit_vector& other, const allocator_type& alloc) : words(other.words, alloc), count(other.count) {}
+		bit_vector(bit_vector&& other, const allocator_type& alloc) : words(std::move(other.words), alloc), count(std::exchange(other.count, 0)) {
+			other.words.clear();
 		}
-		template<size_t I>
-		auto& field() const {
-			return parent->template field<I>()[index];
+
+		allocator_type get_allocator() const {
+			return words.get_allocator();
 		}
 
-		/**
-		 * Access the underlying field of the element of the SoA by name.
-		 *
-		 * @code
-		 * auto x = soa[i].field<"x">();
-		 * soa[i].field<"x">() = x;
-		 * @endcode
-		 */
-		template<reflect::fixed_string FieldName>
-		auto& field() {
-			return parent->template field<FieldName>()[index];
+		size_t size() const {
+			return count;
 		}
-		template<reflect::fixed_string FieldName>
-		auto& field() const {
-			return parent->template field<FieldName>()[index];
+		size_t capacity() const {
+			return words.capacity() * word_bits;
+		}
+		size_t max_size() const {
+			return std::min(words.max_size(), std::numeric_limits<size_t>::max() / word_bits) * word_bits;
 		}
 
-		/**
-		 * Access the underlying field of the element of the SoA by type.
-		 * Only works if the type is unique within the aggregate type T.
-		 *
-		 * @code
-		 * auto x = soa[i].field<int>();
-		 * soa[i].field<int>() = x;
-		 * @endcode
-		 */
-		template<typename U>
-		auto& field() {
-			return parent->template field<U>()[index];
+		iterator begin() {
+			return iterator(words.data(), 0);
 		}
-		template<typename U>
-		auto& field() const {
-			return parent->template field<U>()[index];
+		const_iterator begin() const {
+			return const_iterator(words.data(), 0);
 		}
 
-		/**
-		 * Access all underlying fields of the element of the SoA as a tuple.
-		 *
-		 * @code
-		 * auto [x, y, z] = soa[i].fields();
-		 * std::tie(x, y, z) = soa[i].fields();
-		 * @endcode
-		 */
-		auto fields() {
-			return parent->fields(index);
+		bit_span<bool> span() {
+			return bit_span<bool>(words.data(), count);
 		}
-		auto fields() const {
-			return parent->fields(index);
+		bit_span<const bool> span() const {
+			return bit_span<const bool>(words.data(), count);
 		}
 
-		/**
-		 * Construct a new value from all fields of the element of the SoA.
-		 */
-		T value() const {
-			T v = std::make_from_tuple<T>(fields());
-			return v;
+		void assign(size_t new_count, bool value) {
+			clear();
+			resize(new_count, value);
 		}
 
-		bool operator==(const _reference& other) const {
-			if (parent == other.parent && index == other.index) {
-				// Fast path: same reference to the same index in the same parent SoA
-				return true;
-			}
-			else {
-				// Slow path: compare by value
-				return operator==(*other);
-			}
+		void reserve(size_t new_cap) {
+			words.reserve(word_count(new_cap));
 		}
-		bool operator==(const T& other) const {
-			return value() == other;
+
+		void shrink_to_fit() {
+			words.shrink_to_fit();
 		}
-		bool operator!=(const _reference& other) const {
-			return !operator==(other);
+
+		void clear() {
+			words.clear();
+			count = 0;
 		}
-		bool operator!=(const T& other) const {
-			return !operator==(other);
+
+		void insert(const_iterator pos, bool value) {
+			insert(pos, 1, value);
+		}
+		void insert(const_iterator pos, size_t n, bool value) {
+			size_t index = open_gap(pos, n);
+			std::fill_n(begin() + index, n, value);
+		}
+		template<typename It>
+		void insert(const_iterator pos, It first, It last) {
+			size_t index = open_gap(pos, std::distance(first, last));
+			std::copy(first, last, begin() + index);
 		}
 
-		/**
-		 * Assign `value`'s fields to an element of the SoA.
-		 *
-		 * @code
-		 * soa[i] = T{ ... };
-		 * @endcode
-		 */
-		_reference& operator=(const T& value) {
-			parent->for_each_vector([&](auto&& vec, auto&& field) {
-				vec[index] = field;
-			}, value);
+		template<typename Arg>
+		void emplace(const_iterator pos, Arg&& arg) {
+			insert(pos, bool(std::forward<Arg>(arg)));
+		}
+
+		void erase(const_iterator first, const_iterator last) {
+			size_t index = first - begin();
+			size_t n = last - first;
+			std::copy(begin() + index + n, begin() + count, begin() + index);
+			resize(count - n);
+		}
+
+		void push_back(bool value) {
+			resize(count + 1, value);
+		}
+
+		template<typename Arg>
+		void emplace_back(Arg&& arg) {
+			push_back(bool(std::forward<Arg>(arg)));
+		}
+
+		void pop_back() {
+			resize(count - 1);
+		}
+
+		void resize(size_t new_count) {
+			resize(new_count, false);
+		}
+		void resize(size_t new_count, bool value) {
+			size_t old_count = count;
+			words.resize(word_count(new_count));
+			count = new_count;
+			if (new_count > old_count) {
+				std::fill(begin() + old_count, begin() + new_count, value);
+			}
+			else if (new_count % word_bits != 0) {
+				// Keep the bits past the end zero
+				words.back() &= (std::uint64_t(1) << (new_count % word_bits)) - 1;
+			}
+		}
+
+	private:
+		std::vector<std::uint64_t, allocator_type> words;
+		size_t count = 0;
+
+		static size_t word_count(size_t bits) {
+			return (bits + word_bits - 1) / word_bits;
+		}
+
+		/// Insert `n` zero bits at `pos`, shifting the following bits, and return the index of the first one
+		size_t open_gap(const_iterator pos, size_t n) {
+			size_t index = pos - begin();
+			size_t old_count = count;
+			resize(count + n);
+			std::copy_backward(begin() + index, begin() + old_count, begin() + count);
+			std::fill_n(begin() + index, n, false);
+			return index;
+		}
+	};
+
+	/// Get a bit_span from a bit_vector
+	template<typename Allocator>
+	bit_span<bool> vector_to_span(bit_vector<Allocator>& v) {
+		return v.span();
+	}
+	template<typename Allocator>
+	bit_span<const bool> vector_to_span(const bit_vector<Allocator>& v) {
+		return v.span();
+	}
+
+	/// Like `rebound_vector`, but with a bit_vector for bool
+	template<typename Allocator>
+	struct packed_vector {
+		template<typename U>
+		using type = std::conditional_t<
+			std::is_same_v<std::remove_cv_t<U>, bool>,
+			bit_vector<Allocator>,
+			std::vector<U, rebind_alloc<Allocator, U>>
+		>;
+	};
+
+	/// Tuple of vectors, one for each field of type T, with bool fields packed in bit_vectors
+	template<typename T, typename Allocator = std::allocator<T>>
+	using packed_fields_vector_tuple = decltype(
+		transform_tuple_types<packed_vector<Allocator>::template type>(
+			reflect::to<std::tuple>(std::declval<T>())
+		)
+	);
+
+	/**
+	 * Vector with the interface of std::vector used by `vector_columns`, storing elements in chunks of `N` elements.
+	 * Growing allocates new chunks and only moves the table of chunk pointers, so elements never move and their addresses are stable.
+	 * Inserting in the middle appends the new elements, then rotates them into place.
+	 */
+	template<typename U, size_t N, typename Allocator>
+	class chunked_vector {
+	public:
+		using value_type = U;
+		using allocator_type = rebind_alloc<Allocator, U>;
+		using iterator = chunked_iterator<U, N>;
+		using const_iterator = chunked_iterator<const U, N>;
+
+	private:
+		using traits = std::allocator_traits<allocator_type>;
+		using chunk_table = std::vector<U *, rebind_alloc<Allocator, U *>>;
+
+	public:
+		chunked_vector() = default;
+		explicit chunked_vector(const allocator_type& alloc) : allocator(alloc), chunks(alloc) {}
+		// Copies delegate to the allocator constructor, so that the destructor frees the chunks if an element copy throws
+		chunked_vector(const chunked_vector& other)
+			: chunked_vector(traits::select_on_container_copy_construction(other.allocator))
+		{
+			insert(end(), other.begin(), other.end());
+		}
+		chunked_vector(const chunked_vector& other, const allocator_type& alloc)
+			: chunked_vector(alloc)
+		{
+			insert(end(), other.begin(), other.end());
+		}
+		chunked_vector(chunked_vector&& other) noexcept
+			: allocator(std::move(other.allocator))
+			, chunks(std::move(other.chunks))
+			, count(std::exchange(other.count, 0))
+		{
+		}
+		chunked_vector(chunked_vector&& other, const allocator_type& alloc)
+			: chunked_vector(alloc)
+		{
+			if (allocator == other.allocator) {
+				chunks = std::move(other.chunks);
+				count = std::exchange(other.count, 0);
+			}
+			else {
+				insert(end(), std::make_move_iterator(other.begin()), std::make_move_iterator(other.end()));
+				other.clear();
+			}
+		}
+		~chunked_vector() {
+			release();
+		}
+
+		chunked_vector& operator=(const chunked_vector& other) {
+			if (this != &other) {
+				if constexpr (traits::propagate_on_container_copy_assignment::value) {
+					if (allocator != other.allocator) {
+						release();
+						allocator = other.allocator;
+						chunks = chunk_table(allocator);
+					}
+				}
+				clear();
+				insert(end(), other.begin(), other.end());
+			}
 			return *this;
 		}
-		_reference& operator=(T&& value) {
-			parent->for_each_vector([&](auto&& vec, auto&& field) {
-				vec[index] = field;
-			}, std::move(value));
+		chunked_vector& operator=(chunked_vector&& other) noexcept(traits::propagate_on_container_move_assignment::value || traits::is_always_equal::value) {
+			if (this != &other) {
+				if (traits::propagate_on_container_move_assignment::value || allocator == other.allocator) {
+					release();
+					if constexpr (traits::propagate_on_container_move_assignment::value) {
+						allocator = std::move(other.allocator);
+					}
+					chunks = std::move(other.chunks);
+					count = std::exchange(other.count, 0);
+				}
+				else {
+					// Chunks can't be stolen from another allocator, so elements are moved one by one
+					clear();
+					insert(end(), std::make_move_iterator(other.begin()), std::make_move_iterator(other.end()));
+				}
+			}
 			return *this;
 		}
 
-		/**
-		 * Assign `value`'s fields to an element of the SoA.
-		 *
-		 * @code
-		 * soa[i] = soa[j];
-		 * @endcode
-		 */
-		_reference& operator=(const _reference& value) {
-			fields() = value.fields();
-			return *this;
+		allocator_type get_allocator() const {
+			return allocator;
 		}
 
-		/**
-		 * Alias for `value`.
-		 */
-		T operator*() const {
-			return value();
+		size_t size() const {
+			return count;
+		}
+		size_t capacity() const {
+			return chunks.size() * N;
+		}
+		size_t max_size() const {
+			return std::min(chunks.max_size(), std::numeric_limits<size_t>::max() / N) * N;
 		}
 
-		/**
-		 * Alias for `value`.
-		 */
-		operator T() const {
-			return value();
+		iterator begin() {
+			return iterator(chunks.data(), 0);
+		}
+		const_iterator begin() const {
+			return const_iterator(chunks.data(), 0);
+		}
+		iterator end() {
+			return begin() + count;
+		}
+		const_iterator end() const {
+			return begin() + count;
 		}
 
-		/**
-		 * Swap field values of two wrappers.
-		 *
-		 * @code
-		 * soa[i].swap(soa[j]);
-		 * @endcode
-		 */
-		void swap(_reference other) {
-			[&]<auto... Ns>(std::index_sequence<Ns...>) {
-				using std::swap;
-				(swap(field<Ns>(), other.field<Ns>()), ...);
-			}(std::make_index_sequence<reflect::size<T>()>{});
+		chunked_span<U, N> span() {
+			return chunked_span<U, N>(begin(), count);
+		}
+		chunked_span<const U, N> span() const {
+			return chunked_span<const U, N>(begin(), count);
+		}
+
+		void assign(size_t new_count, const U& value) {
+			clear();
+			resize(new_count, value);
+		}
+
+		void reserve(size_t new_cap) {
+			if (new_cap > capacity()) {
+				chunks.reserve((new_cap + N - 1) / N);
+				while (capacity() < new_cap) {
+					add_chunk();
+				}
+			}
+		}
+
+		/// Free the chunks past the last element
+		void shrink_to_fit() {
+			size_t used = (count + N - 1) / N;
+			while (chunks.size() > used) {
+				traits::deallocate(allocator, chunks.back(), N);
+				chunks.pop_back();
+			}
+			chunks.shrink_to_fit();
+		}
+
+		void clear() {
+			truncate(0);
+		}
+
+		void insert(const_iterator pos, const U& value) {
+			emplace(pos, value);
+		}
+		void insert(const_iterator pos, U&& value) {
+			emplace(pos, std::move(value));
+		}
+		void insert(const_iterator pos, size_t n, const U& value) {
+			size_t index = pos - begin();
+			append([&] {
+				for (size_t i = 0; i < n; i++) {
+					emplace_back(value);
+				}
+			});
+			std::rotate(begin() + index, end() - n, end());
+		}
+		template<typename It>
+		void insert(const_iterator pos, It first, It last) {
+			size_t index = pos - begin();
+			size_t old_count = count;
+			append([&] {
+				for ( ; first != last; ++first) {
+					emplace_back(*first);
+				}
+			});
+			std::rotate(begin() + index, begin() + old_count, end());
+		}
+
+		template<typename... Args>
+		void emplace(const_iterator pos, Args&&... args) {
+			size_t index = pos - begin();
+			emplace_back(std::forward<Args>(args)...);
+			std::rotate(begin() + index, end() - 1, end());
+		}
+
+		void erase(const_iterator first, const_iterator last) {
+			size_t index = first - begin();
+			size_t n = last - first;
+			std::move(begin() + index + n, end(), begin() + index);
+			truncate(count - n);
+		}
+
+		void push_back(const U& value) {
+			emplace_back(value);
+		}
+		void push_back(U&& value) {
+			emplace_back(std::move(value));
+		}
+
+		template<typename... Args>
+		void emplace_back(Args&&... args) {
+			if (count == capacity()) {
+				add_chunk();
+			}
+			traits::construct(allocator, std::addressof(begin()[count]), std::forward<Args>(args)...);
+			count++;
+		}
+
+		void pop_back() {
+			truncate(count - 1);
+		}
+
+		void resize(size_t new_count) {
+			if (new_count < count) {
+				truncate(new_count);
+			}
+			else {
+				reserve(new_count);
+				append([&] {
+					while (count < new_count) {
+						emplace_back();
+					}
+				});
+			}
+		}
+		void resize(size_t new_count, const U& value) {
+			if (new_count < count) {
+				truncate(new_count);
+			}
+			else {
+				reserve(new_count);
+				append([&] {
+					while (count < new_count) {
+						emplace_back(value);
+					}
+				});
+			}
+		}
+		/// Like `resize`, but leaves new trivially default constructible elements uninitialized
+		void resize_for_overwrite(size_t new_count) {
+			if constexpr (std::is_trivially_default_constructible_v<U> && std::is_trivially_destructible_v<U>) {
+				if (new_count < count) {
+					truncate(new_count);
+				}
+				else {
+					reserve(new_count);
+					count = new_count;
+				}
+			}
+			else {
+				resize(new_count);
+			}
 		}
 
 	private:
-		_soa *parent;
-		size_t index;
+		[[no_unique_address]] allocator_type allocator;
+		chunk_table chunks;
+		size_t count = 0;
+
+		void add_chunk() {
+			U *chunk = traits::allocate(allocator, N);
+			try {
+				chunks.push_back(chunk);
+			}
+			catch (...) {
+				traits::deallocate(allocator, chunk, N);
+				throw;
+			}
+		}
+
+		/// Destroy the elements past `new_count`
+		void truncate(size_t new_count) {
+			while (count > new_count) {
+				count--;
+				traits::destroy(allocator, std::addressof(begin()[count]));
+			}
+		}
+
+		/// Call `fn` to construct elements at the end, destroying them if it throws
+		template<typename Fn>
+		void append(Fn&& fn) {
+			size_t old_count = count;
+			try {
+				fn();
+			}
+			catch (...) {
+				truncate(old_count);
+				throw;
+			}
+		}
+
+		/// Destroy all elements and free the chunks
+		void release() {
+			clear();
+			for (U *chunk : chunks) {
+				traits::deallocate(allocator, chunk, N);
+			}
+			chunks.clear();
+		}
+	};
+
+	/// Get a chunked_span from a chunked_vector
+	template<typename U, size_t N, typename Allocator>
+	chunked_span<U, N> vector_to_span(chunked_vector<U, N, Allocator>& v) {
+		return v.span();
+	}
+	template<typename U, size_t N, typename Allocator>
+	chunked_span<const U, N> vector_to_span(const chunked_vector<U, N, Allocator>& v) {
+		return v.span();
+	}
+
+	/// Like `rebound_vector`, but with a chunked_vector of chunks of N elements
+	template<typename Allocator, size_t N>
+	struct chunked_vector_type {
+		template<typename U>
+		using type = chunked_vector<U, N, Allocator>;
 	};
 
+	/// Tuple of chunked_vectors, one for each field of type T
+	template<typename T, typename Allocator, size_t N>
+	using chunked_fields_vector_tuple = decltype(
+		transform_tuple_types<chunked_vector_type<Allocator, N>::template type>(
+			reflect::to<std::tuple>(std::declval<T>())
+		)
+	);
+
+	/// Tuple of vectors, one for each field of type T
+	template<typename T, typename Allocator = std::allocator<T>>
+	using fields_vector_tuple = decltype(
+		transform_tuple_types<rebound_vector<Allocator>::template type>(
+			transform_tuple_types<bool_to_union>(
+				reflect::to<std::tuple>(std::declval<T>())
+			)
+		)
+	);
+
 	/**
-	 * Swap field values of two wrappers.
-	 *
-	 * @code
-	 * swap(soa[i], soa[j]);
-	 * @endcode
+	 * Vector with the interface of `Vector` used by `vector_columns`, whose copies share a single refcounted `Vector`.
+	 * Mutable accesses first clone the shared vector if another copy still refers to it,
+	 * so copies cost O(1) and only the columns that are then modified pay for a deep copy.
+	 * A copy may be read from another thread while the original is modified, since writes never reach a shared vector.
 	 */
-	template<typename _soa>
-	friend void swap(_reference<_soa> a, _reference<_soa> b) {
-		a.swap(b);
-	}
+	template<typename Vector>
+	class cow_vector {
+	public:
+		using value_type = typename Vector::value_type;
+		using allocator_type = typename Vector::allocator_type;
+		using iterator = typename Vector::iterator;
+		using const_iterator = typename Vector::const_iterator;
 
-	template<typename _soa>
-	struct _iterator {
-		using _const_soa = const std::remove_const_t<_soa>;
+		static_assert(std::is_copy_constructible_v<value_type>, "Copy-on-write columns must be copyable");
 
-		_iterator(_soa *parent, size_t index) : parent(parent), index(index) {}
+	private:
+		using traits = std::allocator_traits<allocator_type>;
 
-		_iterator& operator++() {
-			++index;
-			return *this;
+	public:
+		cow_vector() = default;
+		explicit cow_vector(const allocator_type& alloc) : allocator(alloc) {}
+		cow_vector(const cow_vector& other)
+			: allocator(traits::select_on_container_copy_construction(other.allocator))
+		{
+			share(other);
 		}
-		_iterator operator++(int) {
-			_iterator previous = *this;
-			++index;
-			return previous;
+		cow_vector(const cow_vector& other, const allocator_type& alloc)
+			: allocator(alloc)
+		{
+			share(other);
+		}
+		cow_vector(cow_vector&& other) noexcept = default;
+		cow_vector(cow_vector&& other, const allocator_type& alloc)
+			: allocator(alloc)
+		{
+			share(other);
+			other.vector.reset();
 		}
 
-		_iterator& operator+=(size_t n) {
-			index += n;
+		cow_vector& operator=(const cow_vector& other) {
+			if (this != &other) {
+				if constexpr (traits::propagate_on_container_copy_assignment::value) {
+					allocator = other.allocator;
+				}
+				share(other);
+			}
 			return *this;
 		}
-
-		_iterator& operator--() {
-			--index;
+		cow_vector& operator=(cow_vector&& other) noexcept(traits::propagate_on_container_move_assignment::value || traits::is_always_equal::value) {
+			if (this != &other) {
+				if constexpr (traits::propagate_on_container_move_assignment::value) {
+					allocator = std::move(other.allocator);
+				}
+				share(other);
+				other.vector.reset();
+			}
 			return *this;
 		}
-		_iterator operator--(int) {
-			_iterator previous = *this;
-			--index;
-			return previous;
+
+		allocator_type get_allocator() const {
+			return allocator;
 		}
 
-		_iterator& operator-=(size_t n) {
-			index -= n;
-			return *this;
+		size_t size() const {
+			return vector ? vector->size() : 0;
+		}
+		size_t capacity() const {
+			return vector ? vector->capacity() : 0;
+		}
+		size_t max_size() const {
+			return std::min<size_t>(traits::max_size(allocator), std::numeric_limits<std::ptrdiff_t>::max() / sizeof(value_type));
 		}
 
-		_iterator operator+(size_t n) const {
-			return _iterator(parent, index + n);
+		iterator begin() {
+			return unique().begin();
 		}
-		size_t operator+(const _iterator& other) const {
-			return index + other.index;
+		iterator end() {
+			return unique().end();
 		}
 
-		_iterator operator-(size_t n) const {
-			return _iterator(parent, index - n);
+		/// Vector that may be shared with other copies, null when empty
+		const Vector *shared() const {
+			return vector.get();
 		}
-		size_t operator-(const _iterator& other) const {
-			return index - other.index;
+
+		/// Vector owned by this copy alone, cloning the shared one first if needed
+		Vector& unique() {
+			if (!vector) {
+				vector = make_shared(Vector(allocator));
+			}
+			else if (vector.use_count() > 1) {
+				vector = make_shared(Vector(*vector, allocator));
+			}
+			else {
+				// Synchronizes with the release of the last other copy, whose reads must happen before our writes
+				std::atomic_thread_fence(std::memory_order_acquire);
+			}
+			return *vector;
 		}
 
-		bool operator==(const _iterator& other) const {
-			return parent == other.parent
-				&& index == other.index;
+		void assign(size_t count, const value_type& value) {
+			clear();
+			unique().assign(count, value);
 		}
-		bool operator!=(const _iterator& other) const {
-			return !operator==(other);
+
+		void reserve(size_t new_cap) {
+			if (new_cap > capacity()) {
+				unique().reserve(new_cap);
+			}
 		}
 
-		_reference<_soa> operator*() {
-			return _reference<_soa>(parent, index);
+		void shrink_to_fit() {
+			if (capacity() > size()) {
+				unique().shrink_to_fit();
+			}
 		}
-		_reference<_const_soa> operator*() const {
-			return _reference<_const_soa>(parent, index);
+
+		/// Drop the shared vector instead of cloning it
+		void clear() {
+			if (vector.use_count() > 1) {
+				vector.reset();
+			}
+			else if (vector) {
+				unique().clear();
+			}
 		}
 
-		operator _iterator<_const_soa>() const {
-			return _iterator<_const_soa>(parent, index);
+		template<typename... Args>
+		iterator insert(const_iterator pos, Args&&... args) {
+			return unique().insert(pos, std::forward<Args>(args)...);
+		}
+
+		template<typename... Args>
+		iterator emplace(const_iterator pos, Args&&... args) {
+			return unique().emplace(pos, std::forward<Args>(args)...);
+		}
+
+		iterator erase(const_iterator first, const_iterator last) {
+			return unique().erase(first, last);
+		}
+
+		template<typename U>
+		void push_back(U&& value) {
+			unique().push_back(std::forward<U>(value));
+		}
+
+		template<typename... Args>
+		void emplace_back(Args&&... args) {
+			unique().emplace_back(std::forward<Args>(args)...);
+		}
+
+		void pop_back() {
+			unique().pop_back();
+		}
+
+		void resize(size_t count) {
+			if (count != size()) {
+				unique().resize(count);
+			}
+		}
+		void resize(size_t count, const value_type& value) {
+			if (count != size()) {
+				unique().resize(count, value);
+			}
 		}
 
 	private:
-		friend class soa;
-		_soa *parent;
-		size_t index;
+		[[no_unique_address]] allocator_type allocator;
+		std::shared_ptr<Vector> vector;
+
+		/// Share the vector of `other`, or clone it if it comes from another allocator
+		void share(const cow_vector& other) {
+			if (allocator == other.allocator || !other.vector) {
+				vector = other.vector;
+			}
+			else {
+				vector = make_shared(Vector(*other.vector, allocator));
+			}
+		}
+
+		/// Move `source` into a new refcounted vector, allocated with the column allocator along with its control block
+		std::shared_ptr<Vector> make_shared(Vector&& source) const {
+			// Moved rather than constructed in place, since allocators like std::pmr::polymorphic_allocator add themselves to constructor arguments
+			return std::allocate_shared<Vector>(allocator, std::move(source));
+		}
 	};
-};
 
-}
+	/// Get a span from a cow_vector, cloning its vector if it is shared
+	template<typename Vector>
+	auto vector_to_span(cow_vector<Vector>& v) {
+		return vector_to_span(v.unique());
+	}
+	template<typename Vector>
+	auto vector_to_span(const cow_vector<Vector>& v) {
+		using span = decltype(vector_to_span(std::declval<const Vector&>()));
+		return v.shared() ? vector_to_span(*v.shared()) : span();
+	}
+
+	/// Like `rebound_vector`, but with a cow_vector
+	template<typename Allocator>
+	struct cow_vector_type {
+		template<typename U>
+		using type = cow_vector<std::vector<U, rebind_alloc<Allocator, U>>>;
+	};
+
+	/// Tuple of cow_vectors, one for each field of type T
+	template<typename T, typename Allocator = std::allocator<T>>
+	using cow_fields_vector_tuple = decltype(
+		transform_tuple_types<cow_vector_type<Allocator>::template type>(
+			transform_tuple_types<bool_to_union>(
+				reflect::to<std::tuple>(std::declval<T>())
+			)
+		)
+	);
+
+	/// Tuple with the type of each field of type T
+	template<typename T>
+	using field_types = decltype(reflect::to<std::tuple>(std::declval<T>()));
+
+	/// Type of the I-th field of type T
+	template<size_t I, typename T>
+	using field_type = std::tuple_element_t<I, field_types<T>>;
+
+	/// Whether all fields of type T can be compared with <=>
+	template<typename T>
+	constexpr bool fields_three_way_comparable = []<auto... Ns>(std::index_sequence<Ns...>) {
+		return (std::three_way_comparable<field_type<Ns, T>> && ...);
+	}(std::make_index_sequence<reflect::size<T>()>{});
+
+	template<typename T, typename Fields = std::make_index_sequence<reflect::size<T>()>>
+	struct fields_ordering_impl;
+	template<typename T, size_t... Ns>
+	struct fields_ordering_impl<T, std::index_sequence<Ns...>> {
+		using type = std::common_comparison_category_t<std::compare_three_way_result_t<field_type<Ns, T>>...>;
+	};
+
+	/// Result of comparing two values of type T field by field with <=>
+	template<typename T>
+	using fields_ordering = typename fields_ordering_impl<T>::type;
+
+	/// Index of the only field of type T with type U
+	template<typename U, typename T>
+	constexpr size_t index_of_type() {
+		return []<auto... Ns>(std::index_sequence<Ns...>) {
+			static_assert(((std::is_same_v<field_type<Ns, T>, U> ? 1 : 0) + ...) == 1, "Type must appear exactly once in the fields of T");
+			size_t index = 0;
+			((std::is_same_v<field_type<Ns, T>, U> ? (index = Ns) : 0), ...);
+			return index;
+		}(std::make_index_sequence<reflect::size<T>()>{});
+	}
+
+	/// Get the I-th field of `value`, moving from it when `value` is an rvalue
+	template<size_t I, typename U>
+	decltype(auto) forward_field(U&& value) {
+		if constexpr (std::is_lvalue_reference_v<U>) {
+			return reflect::get<I>(value);
+		}
+		else {
+			return std::move(reflect::get<I>(value));
+		}
+	}
+
+	/// Whether `U` is a proxy to an element of a SoA, exposing its fields by index
+	template<typename U>
+	concept field_proxy = requires(U value) {
+		value.template field<0>();
+	};
+
+	/**
+	 * Get the I-th field of the element pointed by `it`, which is a T or a SoA proxy of T.
+	 * Returns a reference for proxies and references, moving from rvalue references,
+	 * or a value moved from the temporary if the iterator returns elements by value.
+	 */
+	template<size_t I, typename T, typename It>
+	decltype(auto) iterator_field(const It& it) {
+		if constexpr (field_proxy<std::iter_reference_t<It>>) {
+			return (*it).template field<I>();
+		}
+		else if constexpr (std::is_reference_v<std::iter_reference_t<It>>) {
+			return forward_field<I>(*it);
+		}
+		else {
+			auto element = *it;
+			return field_type<I, T>(std::move(reflect::get<I>(element)));
+		}
+	}
+
+	/**
+	 * Iterator adaptor over elements of type T (or SoA proxies of T) that dereferences to their I-th field.
+	 * Used to insert ranges of elements one column at a time.
+	 */
+	template<size_t I, typename T, typename It>
+	struct field_iterator {
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = field_type<I, T>;
+		using difference_type = std::iter_difference_t<It>;
+		using pointer = void;
+		using reference = decltype(iterator_field<I, T>(std::declval<const It&>()));
+
+		It it;
+
+		reference operator*() const {
+			return iterator_field<I, T>(it);
+		}
+
+		field_iterator& operator++() {
+			++it;
+			return *this;
+		}
+		field_iterator operator++(int) {
+			field_iterator previous = *this;
+			++it;
+			return previous;
+		}
+
+		bool operator==(const field_iterator& other) const {
+			return it == other.it;
+		}
+		bool operator!=(const field_iterator& other) const {
+			return it != other.it;
+		}
+	};
+
+	/// Whether the elements of `It` can be inserted one column at a time, with multiple passes over the range
+	template<typename It, typename T>
+	concept forward_field_source = std::forward_iterator<It> && (
+		std::is_same_v<std::remove_cvref_t<std::iter_reference_t<It>>, T>
+		|| field_proxy<std::iter_reference_t<It>>
+	);
+
+#ifdef SOA_EXECUTION_POLICIES
+	/// Whether `Policy` is a standard execution policy, like `std::execution::par`
+	template<typename Policy>
+	concept execution_policy = std::is_execution_policy_v<std::remove_cvref_t<Policy>>;
+
+	/// Call `fn(I)` for each field index I in `Ns...`, concurrently as allowed by `policy`
+	template<size_t... Ns, typename ExecutionPolicy, typename Fn>
+	void for_each_field(std::index_sequence<Ns...>, ExecutionPolicy&& policy, Fn&& fn) {
+		std::array<size_t, sizeof...(Ns)> indices { Ns... };
+		std::for_each(policy, indices.begin(), indices.end(), [&](size_t index) {
+			((index == Ns ? fn(std::integral_constant<size_t, Ns>{}) : void()), ...);
+		});
+	}
+
+	/**
+	 * Call `fn(I)` for each field index I of type T, concurrently as allowed by `policy`.
+	 * As with standard parallel algorithms, `std::terminate` is called if `fn` throws.
+	 */
+	template<typename T, typename ExecutionPolicy, typename Fn>
+	void for_each_field(ExecutionPolicy&& policy, Fn&& fn) {
+		for_each_field(std::make_index_sequence<reflect::size<T>()>{}, policy, fn);
+	}
+
+	/// Size of a cache line, the granularity of false sharing
+	constexpr size_t cache_line_size = 64;
+
+	/// Bytes of the selected columns processed by each task of `soa::parallel_for` by default, about the size of an L1 data cache
+	constexpr size_t parallel_chunk_bytes = 32 * 1024;
+#else
+	/// Execution policies are disabled, define SOA_EXECUTION_POLICIES to enable them
+	template<typename Policy>
+	concept execution_policy = false;
+#endif
+
+	/// Round `value` up to a multiple of `alignment`
+	constexpr size_t align_up(size_t value, size_t alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	/// Whether all indices in `I...` are different
+	template<size_t... I>
+	constexpr bool distinct_indices() {
+		std::array<size_t, sizeof...(I)> indices { I... };
+		std::sort(indices.begin(), indices.end());
+		return std::adjacent_find(indices.begin(), indices.end()) == indices.end();
+	}
+
+	/**
+	 * Call `fn(columns[i]...)` for each i in [0, count).
+	 * Columns are `__restrict` parameters, so that compilers know they don't alias and can vectorize the loop.
+	 */
+	template<typename Fn, typename... U>
+	void for_each_index(size_t count, Fn& fn, U *__restrict... columns) {
+		for (size_t i = 0; i < count; i++) {
+			fn(columns[i]...);
+		}
+	}
+
+	/// Whether `Column` is a field array stored in tiles, like `tiled_span`
+	template<typename Column>
+	concept tiled_column = requires(const Column& column) {
+		column.tile(0);
+	};
+
+	/// Whether `Column` is a single contiguous array, like `std::span`
+	template<typename Column>
+	concept contiguous_column = requires(const Column& column) {
+		column.data();
+	};
+
+	/**
+	 * Call `fn(count, data...)` for each contiguous chunk of the columns, which must share the same size and layout.
+	 * Contiguous columns are a single chunk, while tiled columns have one chunk per tile.
+	 */
+	template<typename Fn, typename Column, typename... Columns>
+	void for_each_contiguous(Fn&& fn, const Column& column, const Columns&... columns) {
+		if constexpr (tiled_column<Column>) {
+			for (size_t k = 0; k < column.tile_count(); k++) {
+				fn(column.tile(k).size(), column.tile(k).data(), columns.tile(k).data()...);
+			}
+		}
+		else {
+			fn(column.size(), column.data(), columns.data()...);
+		}
+	}
+
+	/// Elements in a tile of `Column`, 1 for contiguous columns
+	template<typename Column>
+	constexpr size_t tile_size_of() {
+		if constexpr (tiled_column<Column>) {
+			return Column::tile_size;
+		}
+		else {
+			return 1;
+		}
+	}
+
+	/// Like `for_each_contiguous`, limited to the elements in [first, last)
+	template<typename Fn, typename Column, typename... Columns>
+	void for_each_contiguous_in(size_t first, size_t last, Fn&& fn, const Column& column, const Columns&... columns) {
+		if constexpr (tiled_column<Column>) {
+			constexpr size_t N = Column::tile_size;
+			for (size_t k = first / N; k * N < last; k++) {
+				size_t offset = std::max(first, k * N) - k * N;
+				size_t count = std::min(last, (k + 1) * N) - k * N - offset;
+				fn(count, column.tile(k).data() + offset, columns.tile(k).data() + offset...);
+			}
+		}
+		else {
+			fn(last - first, column.data() + first, columns.data() + first...);
+		}
+	}
+
+#ifdef SOA_EXECUTION_POLICIES
+	/**
+	 * Split the elements of the columns into chunks of about `chunk_size` elements, 0 to fit `parallel_chunk_bytes`,
+	 * and call `fn(std::span<U>...)` on their contiguous parts, one task per chunk, concurrently as allowed by `policy`.
+	 * Chunks are rounded to a multiple of 64 elements and of the tile size, so that they start at a cache line boundary
+	 * relative to the start of each column, and tasks never write to the same cache line or tile.
+	 */
+	template<typename ExecutionPolicy, typename Fn, typename Column, typename... Columns>
+	void parallel_for_chunks(ExecutionPolicy&& policy, Fn& fn, size_t chunk_size, const Column& column, const Columns&... columns) {
+		constexpr size_t granularity = [] {
+			size_t result = std::lcm(cache_line_size, tile_size_of<Column>());
+			((result = std::lcm(result, tile_size_of<Columns>())), ...);
+			return result;
+		}();
+		constexpr size_t row_bytes = (sizeof(typename Column::value_type) + ... + sizeof(typename Columns::value_type));
+		if (chunk_size == 0) {
+			chunk_size = parallel_chunk_bytes / row_bytes;
+		}
+		chunk_size = align_up(std::max<size_t>(chunk_size, 1), granularity);
+		size_t count = column.size();
+		std::vector<size_t> chunks((count + chunk_size - 1) / chunk_size);
+		std::iota(chunks.begin(), chunks.end(), size_t(0));
+		std::for_each(policy, chunks.begin(), chunks.end(), [&](size_t k) {
+			size_t first = k * chunk_size;
+			for_each_contiguous_in(first, std::min(count, first + chunk_size), [&](size_t n, auto *... data) {
+				fn(std::span(data, n)...);
+			}, column, columns...);
+		});
+	}
+#endif
+
+	/// Accumulate `reduce(acc, transform(columns[i]...))` for each i in [0, count), in order
+	template<typename Acc, typename Reduce, typename Transform, typename... U>
+	Acc transform_reduce_index(size_t count, Acc acc, Reduce& reduce, Transform& transform, const U *__restrict... columns) {
+		for (size_t i = 0; i < count; i++) {
+			acc = reduce(std::move(acc), transform(columns[i]...));
+		}
+		return acc;
+	}
+
+	/**
+	 * Column storage with one std::vector for each field of type T.
+	 * Each column grows independently, so growing the container allocates once per field.
+	 *
+	 * Column storages implement the row-level operations used by `soa` (see `block_columns` for the other implementation).
+	 * Each vector uses its own copy of `Allocator`, rebound to the field type.
+	 * `Vectors` is the tuple of vector types, that may replace std::vector for some fields (see `packed_bool_storage`).
+	 */
+	template<typename T, typename Allocator, typename Vectors = fields_vector_tuple<T, Allocator>>
+	class vector_columns {
+	public:
+		vector_columns() = default;
+		explicit vector_columns(const Allocator& alloc)
+			: vectors(make_vectors(alloc))
+		{
+		}
+		vector_columns(const vector_columns& other, const Allocator& alloc)
+			: vectors(make_vectors(other.vectors, alloc))
+		{
+		}
+		vector_columns(vector_columns&& other, const Allocator& alloc)
+			: vectors(make_vectors(std::move(other.vectors), alloc))
+		{
+		}
+
+		Allocator get_allocator() const {
+			return Allocator(get_vector<0>().get_allocator());
+		}
+
+		size_t size() const {
+			return get_vector<0>().size();
+		}
+		size_t capacity() const {
+			// Vectors of different types may have grown to different capacities
+			return [&]<auto... Ns>(std::index_sequence<Ns...>) {
+				return std::min({ get_vector<Ns>().capacity()... });
+			}(std::make_index_sequence<reflect::size<T>()>{});
+		}
+		size_t max_size() const {
+			return get_vector<0>().max_size();
+		}
+
+		template<size_t I>
+		auto column() {
+			return vector_to_span(get_vector<I>());
+		}
+		template<size_t I>
+		auto column() const {
+			return vector_to_span(get_vector<I>());
+		}
+		/// Capacity of the I-th vector, which may exceed `capacity()`
+		template<size_t I>
+		size_t column_capacity() const {
+			return get_vector<I>().capacity();
+		}
+
+		void assign(size_t count, const T& value) {
+			for_each_vector([&](auto&& vec, auto&& field) {
+				vec.assign(count, field);
+			}, value);
+		}
+
+		void reserve(size_t new_cap) {
+			for_each_vector([&](auto&& vec) {
+				vec.reserve(new_cap);
+			});
+		}
+
+		void shrink_to_fit() {
+			for_each_vector([&](auto&& vec) {
+				vec.shrink_to_fit();
+			});
+		}
+
+		void clear() {
+			for_each_vector([&](auto&& vec) {
+				vec.clear();
+			});
+		}
+
+		template<typename U>
+		void insert(size_t index, U&& value) {
+			for_each_vector([&](auto&& vec, auto&& field) {
+				vec.insert(vec.begin() + index, std::forward<decltype(field)>(field));
+			}, std::forward<U>(value));
+		}
+
+		void insert(size_t index, size_t count, const T& value) {
+			for_each_vector([&](auto&& vec, auto&& field) {
+				vec.insert(vec.begin() + index, count, field);
+			}, value);
+		}
+
+		template<typename It>
+		void insert(size_t index, It first, It last, size_t) {
+			reflect::for_each<T>([&](auto I) {
+				auto& vec = get_vector<I>();
+				vec.insert(vec.begin() + index, field_iterator<I, T, It>{first}, field_iterator<I, T, It>{last});
+			});
+		}
+
+		template<typename... Args>
+		void emplace(size_t index, Args&&... args) {
+			// Arguments may refer to elements of other columns, that move when their vector grows
+			field_types<T> arguments(std::forward<Args>(args)...);
+			reflect::for_each<T>([&](auto I) {
+				auto& vec = get_vector<I>();
+				vec.emplace(vec.begin() + index, std::get<I>(std::move(arguments)));
+			});
+		}
+
+		void erase(size_t first, size_t last) {
+			for_each_vector([&](auto&& vec) {
+				vec.erase(vec.begin() + first, vec.begin() + last);
+			});
+		}
+
+		template<typename U>
+		void push_back(U&& value) {
+			for_each_vector([&](auto&& vec, auto&& field) {
+				vec.push_back(std::forward<decltype(field)>(field));
+			}, std::forward<U>(value));
+		}
+
+		/**
+		 * Append an element, constructing each field in place when no vector has to grow.
+		 * Otherwise arguments may refer to elements of other columns, that move when their vector grows,
+		 * so the fields are first built in a tuple and then moved into their columns.
+		 */
+		template<typename... Args>
+		void emplace_back(Args&&... args) {
+			bool grows = [&]<auto... Ns>(std::index_sequence<Ns...>) {
+				return ((get_vector<Ns>().size() == get_vector<Ns>().capacity()) || ...);
+			}(std::make_index_sequence<reflect::size<T>()>{});
+			if (!grows) {
+				auto arguments = std::forward_as_tuple(std::forward<Args>(args)...);
+				reflect::for_each<T>([&](auto I) {
+					get_vector<I>().emplace_back(std::get<I>(std::move(arguments)));
+				});
+			}
+			else {
+				field_types<T> arguments(std::forward<Args>(args)...);
+				reflect::for_each<T>([&](auto I) {
+					get_vector<I>().emplace_back(std::get<I>(std::move(arguments)));
+				});
+			}
+		}
+
+		void pop_back() {
+			for_each_vector([&](auto&& vec) {
+				vec.pop_back();
+			});
+		}
+
+		void resize(size_t count) {
+			for_each_vector([&](auto&& vec) {
+				vec.resize(count);
+			});
+		}
+		void resize(size_t count, const T& value) {
+			for_each_vector([&](auto&& vec, auto&& field) {
+				vec.resize(count, field);
+			}, value);
+		}
+		/// std::vector has no uninitialized growth, so only chunked vectors skip initializing new elements
+		void resize_for_overwrite(size_t count) {
+			for_each_vector([&](auto&& vec) {
+				if constexpr (requires { vec.resize_for_overwrite(count); }) {
+					vec.resize_for_overwrite(count);
+				}
+				else {
+					vec.resize(count);
+				}
+			});
+		}
+
+#ifdef SOA_EXECUTION_POLICIES
+		// Column-wise operations, one vector per task
+		template<typename ExecutionPolicy>
+		void assign(ExecutionPolicy&& policy, size_t count, const T& value) {
+			for_each_vector(policy, [&](auto&& vec, auto I) {
+				vec.assign(count, reflect::get<I>(value));
+			});
+		}
+		template<typename ExecutionPolicy>
+		void reserve(ExecutionPolicy&& policy, size_t new_cap) {
+			for_each_vector(policy, [&](auto&& vec, auto) {
+				vec.reserve(new_cap);
+			});
+		}
+		template<typename ExecutionPolicy>
+		void shrink_to_fit(ExecutionPolicy&& policy) {
+			for_each_vector(policy, [&](auto&& vec, auto) {
+				vec.shrink_to_fit();
+			});
+		}
+		template<typename ExecutionPolicy>
+		void clear(ExecutionPolicy&& policy) {
+			for_each_vector(policy, [&](auto&& vec, auto) {
+				vec.clear();
+			});
+		}
+		template<typename ExecutionPolicy>
+		void erase(ExecutionPolicy&& policy, size_t first, size_t last) {
+			for_each_vector(policy, [&](auto&& vec, auto) {
+				vec.erase(vec.begin() + first, vec.begin() + last);
+			});
+		}
+		template<typename ExecutionPolicy>
+		void resize(ExecutionPolicy&& policy, size_t count) {
+			for_each_vector(policy, [&](auto&& vec, auto) {
+				vec.resize(count);
+			});
+		}
+		template<typename ExecutionPolicy>
+		void resize(ExecutionPolicy&& policy, size_t count, const T& value) {
+			for_each_vector(policy, [&](auto&& vec, auto I) {
+				vec.resize(count, reflect::get<I>(value));
+			});
+		}
+#endif
+
+		void swap(vector_columns& other) noexcept {
+			vectors.swap(other.vectors);
+		}
+
+	private:
+		Vectors vectors;
+
+		static Vectors make_vectors(const Allocator& alloc) {
+			return [&]<auto... Ns>(std::index_sequence<Ns...>) {
+				return Vectors(
+					std::tuple_element_t<Ns, Vectors>(alloc)...
+				);
+			}(std::make_index_sequence<reflect::size<T>()>{});
+		}
+		/// Copy or move each vector of `other` into memory from `alloc`, with the allocator-extended constructors of the vectors
+		template<typename OtherVectors>
+		static Vectors make_vectors(OtherVectors&& other, const Allocator& alloc) {
+			return [&]<auto... Ns>(std::index_sequence<Ns...>) {
+				return Vectors(
+					std::tuple_element_t<Ns, Vectors>(std::get<Ns>(std::forward<OtherVectors>(other)), alloc)...
+				);
+			}(std::make_index_sequence<reflect::size<T>()>{});
+		}
+
+		template<size_t I>
+		auto& get_vector() {
+			return std::get<I>(vectors);
+		}
+		template<size_t I>
+		auto& get_vector() const {
+			return std::get<I>(vectors);
+		}
+
+		template<typename Fn>
+		void for_each_vector(Fn&& fn) {
+			reflect::for_each<T>([&](auto I) {
+				fn(get_vector<I>());
+			});
+		}
+
+		template<typename Fn, typename U>
+		void for_each_vector(Fn&& fn, U&& value) {
+			reflect::for_each<T>([&](auto I) {
+				fn(get_vector<I>(), forward_field<I>(std::forward<U>(value)));
+			});
+		}
+
+#ifdef SOA_EXECUTION_POLICIES
+		template<execution_policy ExecutionPolicy, typename Fn>
+		void for_each_vector(ExecutionPolicy&& policy, Fn&& fn) {
+			for_each_field<T>(policy, [&](auto I) {
+				fn(get_vector<I>(), I);
+			});
+		}
+#endif
+	};
+
+	/**
+	 * Layout of `block_columns` where each column is a contiguous array, the arrays being back to back in the block.
+	 * Only the fields in `Fields` are stored, all fields of T by default.
+	 *
+	 * If `Alignment` is greater than 1, each column starts at an `Alignment` byte boundary
+	 * and capacity is padded to a multiple of the SIMD width of the narrowest field, `Alignment / sizeof(field)`.
+	 */
+	template<typename T, size_t Alignment = 1, typename Fields = std::make_index_sequence<reflect::size<T>()>>
+	struct contiguous_layout {
+		static_assert(std::has_single_bit(Alignment), "Alignment must be a power of 2");
+		static_assert(Fields::size() > 0, "At least one field must be stored in the block");
+
+		static constexpr size_t field_count = reflect::size<T>();
+		static constexpr size_t simd_alignment = Alignment;
+
+		/// Index sequence of the stored fields
+		using fields = Fields;
+
+		template<size_t I>
+		using column_iterator = field_type<I, T> *;
+
+		template<size_t I>
+		static constexpr size_t column_alignment = std::max(Alignment, alignof(field_type<I, T>));
+
+		/// Alignment of the block, that of the most aligned column
+		static constexpr size_t alignment = []<auto... Ns>(std::index_sequence<Ns...>) {
+			return std::max({ column_alignment<Ns>... });
+		}(fields{});
+
+		/// Capacity is always a multiple of this number of elements
+		static constexpr size_t capacity_granularity = []<auto... Ns>(std::index_sequence<Ns...>) {
+			return std::max<size_t>(1, Alignment / std::min({ sizeof(field_type<Ns, T>)... }));
+		}(fields{});
+
+		/// Byte offset of each stored column inside a block with `capacity` elements, followed by the total block size
+		static std::array<size_t, field_count + 1> offsets(size_t capacity) {
+			std::array<size_t, field_count + 1> result {};
+			size_t offset = 0;
+			[&]<auto... Ns>(std::index_sequence<Ns...>) {
+				((
+					offset = align_up(offset, column_alignment<Ns>),
+					result[Ns] = offset,
+					offset += capacity * sizeof(field_type<Ns, T>)
+				), ...);
+			}(fields{});
+			result[field_count] = align_up(offset, alignment);
+			return result;
+		}
+
+		static size_t block_size(size_t capacity) {
+			return offsets(capacity)[field_count];
+		}
+
+		template<size_t I>
+		static column_iterator<I> column_begin(std::byte *block, size_t capacity) {
+			return reinterpret_cast<column_iterator<I>>(block + offsets(capacity)[I]);
+		}
+
+		template<typename U, typename It>
+		static std::span<U> column_range(It first, size_t count) {
+			return std::span<U>(first, count);
+		}
+	};
+
+	/**
+	 * Layout of `block_columns` where elements are grouped in tiles of `N` elements (AoSoA).
+	 * Each tile holds an array of `N` elements for each field, so fields of the same element are close in memory.
+	 */
+	template<typename T, size_t N>
+	struct tiled_layout {
+		static_assert(std::has_single_bit(N), "Tile size must be a power of 2");
+
+		static constexpr size_t field_count = reflect::size<T>();
+		static constexpr size_t simd_alignment = 1;
+
+		/// Index sequence of the stored fields, all of them
+		using fields = std::make_index_sequence<field_count>;
+
+		/// Alignment of the block, that of the most aligned field
+		static constexpr size_t alignment = []<auto... Ns>(std::index_sequence<Ns...>) {
+			return std::max({ alignof(field_type<Ns, T>)... });
+		}(std::make_index_sequence<field_count>{});
+
+		static constexpr size_t capacity_granularity = N;
+
+		/// Byte offset of each field array inside a tile, followed by the tile size
+		static constexpr std::array<size_t, field_count + 1> tile_offsets = [] {
+			std::array<size_t, field_count + 1> result;
+			size_t offset = 0;
+			reflect::for_each<T>([&](auto I) {
+				offset = align_up(offset, alignof(field_type<I, T>));
+				result[I] = offset;
+				offset += N * sizeof(field_type<I, T>);
+			});
+			result[field_count] = align_up(offset, alignment);
+			return result;
+		}();
+
+		static constexpr size_t tile_bytes = tile_offsets[field_count];
+
+		template<size_t I>
+		using column_iterator = tiled_iterator<field_type<I, T>, N, tile_bytes>;
+
+		static size_t block_size(size_t capacity) {
+			return capacity / N * tile_bytes;
+		}
+
+		template<size_t I>
+		static column_iterator<I> column_begin(std::byte *block, size_t) {
+			return column_iterator<I>(block + tile_offsets[I], 0);
+		}
+
+		template<typename U, typename It>
+		static tiled_span<U, N, tile_bytes> column_range(It first, size_t count) {
+			return tiled_span<U, N, tile_bytes>(first, count);
+		}
+	};
+
+	/**
+	 * Column storage that keeps the arrays of all fields of type T in a single allocation.
+	 * All columns share the same size and capacity, so growing the container allocates only once.
+	 * Bools are stored as plain `bool` arrays, since `std::vector<bool>` is not involved.
+	 * The block is allocated with `Allocator` rebound to an internal, suitably aligned, unit type.
+	 *
+	 * `Layout` defines where each column lives inside the block (see `contiguous_layout` and `tiled_layout`).
+	 * Columns are accessed through `Layout::column_iterator`, so the same algorithms work for every layout.
+	 */
+	template<typename T, typename Allocator, typename Layout = contiguous_layout<T>>
+	class block_columns {
+		static constexpr size_t field_count = reflect::size<T>();
+
+		template<size_t I>
+		using column_type = field_type<I, T>;
+
+		using pointer_tuple = decltype([]<auto... Ns>(std::index_sequence<Ns...>) {
+			return std::tuple<typename Layout::template column_iterator<Ns>...>();
+		}(std::make_index_sequence<field_count>{}));
+
+		/// Allocation unit of the block, aligned as required by the layout
+		static constexpr size_t alignment = Layout::alignment;
+		struct alignas(alignment) unit {
+			std::byte bytes[alignment];
+		};
+		using unit_allocator = rebind_alloc<Allocator, unit>;
+		using unit_traits = std::allocator_traits<unit_allocator>;
+
+		/// Elements are relocated by copy when moving may throw, as std::vector does
+		template<typename U>
+		static constexpr bool relocate_by_move = std::is_trivially_copyable_v<U> || std::is_nothrow_move_constructible_v<U> || !std::is_copy_constructible_v<U>;
+
+		/// Position of the I-th field among the fields stored by the layout
+		template<size_t I>
+		static constexpr size_t stored_position = []<size_t... Ns>(std::index_sequence<Ns...>) {
+			size_t position = 0;
+			size_t k = 0;
+			((position = Ns == I ? k : position, k++), ...);
+			return position;
+		}(typename Layout::fields{});
+
+		/// Columns of trivially copyable fields stored in arrays are copied and shifted with memcpy and memmove
+		template<size_t I>
+		static constexpr bool bitwise_column = std::is_trivially_copyable_v<column_type<I>> && std::is_pointer_v<typename Layout::template column_iterator<I>>;
+
+	public:
+		block_columns() = default;
+		explicit block_columns(const Allocator& alloc)
+			: allocator(alloc)
+		{
+		}
+		block_columns(const block_columns& other)
+			: allocator(unit_traits::select_on_container_copy_construction(other.allocator))
+		{
+			copy_elements(other);
+		}
+		block_columns(const block_columns& other, const Allocator& alloc)
+			: allocator(alloc)
+		{
+			copy_elements(other);
+		}
+		block_columns(block_columns&& other) noexcept
+			: allocator(std::move(other.allocator))
+		{
+			steal(other);
+		}
+		block_columns(block_columns&& other, const Allocator& alloc)
+			: allocator(alloc)
+		{
+			if (allocator == other.allocator) {
+				steal(other);
+			}
+			else {
+				move_elements(other);
+			}
+		}
+		~block_columns() {
+			clear();
+			deallocate(buffer, element_capacity);
+		}
+
+		block_columns& operator=(const block_columns& other) {
+			if (this != &other) {
+				release();
+				if constexpr (unit_traits::propagate_on_container_copy_assignment::value) {
+					allocator = other.allocator;
+				}
+				copy_elements(other);
+			}
+			return *this;
+		}
+		block_columns& operator=(block_columns&& other) noexcept(unit_traits::propagate_on_container_move_assignment::value || unit_traits::is_always_equal::value) {
+			if (this != &other) {
+				release();
+				if constexpr (unit_traits::propagate_on_container_move_assignment::value) {
+					allocator = std::move(other.allocator);
+					steal(other);
+				}
+				else if (allocator == other.allocator) {
+					steal(other);
+				}
+				else {
+					// Different allocators: elements must be moved one by one into memory from our allocator
+					move_elements(other);
+				}
+			}
+			return *this;
+		}
+
+		Allocator get_allocator() const {
+			return Allocator(allocator);
+		}
+
+		size_t size() const {
+			return element_count;
+		}
+		size_t capacity() const {
+			return element_capacity;
+		}
+		size_t max_size() const {
+			size_t bytes = std::min<size_t>(std::numeric_limits<std::ptrdiff_t>::max(), unit_traits::max_size(allocator) * sizeof(unit));
+			constexpr size_t granularity = Layout::capacity_granularity;
+			return bytes / Layout::block_size(granularity) * granularity;
+		}
+
+		template<size_t I>
+		auto column() {
+			return Layout::template column_range<column_type<I>>(std::get<I>(pointers), element_count);
+		}
+		template<size_t I>
+		auto column() const {
+			return Layout::template column_range<const column_type<I>>(std::get<I>(pointers), element_count);
+		}
+
+		template<size_t I>
+		auto aligned_column() requires (Layout::simd_alignment > 1) {
+			return aligned_span<column_type<I>, Layout::template column_alignment<I>>(std::get<I>(pointers), element_count, padded_size<I>());
+		}
+		template<size_t I>
+		auto aligned_column() const requires (Layout::simd_alignment > 1) {
+			return aligned_span<const column_type<I>, Layout::template column_alignment<I>>(std::get<I>(pointers), element_count, padded_size<I>());
+		}
+
+		void assign(size_t count, const T& value) {
+			clear();
+			resize(count, value);
+		}
+
+		void reserve(size_t new_cap) {
+			if (new_cap > max_size()) {
+				throw std::length_error("soa::reserve");
+			}
+			if (new_cap > element_capacity) {
+				reallocate(new_cap);
+			}
+		}
+
+		void shrink_to_fit() {
+			if (element_capacity > padded_capacity(element_count)) {
+				reallocate(element_count);
+			}
+		}
+
+		void clear() {
+			for_each_column([&](auto I) {
+				std::destroy_n(std::get<I>(pointers), element_count);
+			});
+			element_count = 0;
+		}
+
+		template<typename U>
+		void insert(size_t index, U&& value) {
+			construct_row(index, [&](auto I) -> decltype(auto) {
+				return forward_field<I>(std::forward<U>(value));
+			});
+		}
+
+		void insert(size_t index, size_t count, const T& value) {
+			construct_rows(index, count, [&](auto I, auto data) {
+				std::uninitialized_fill_n(data, count, reflect::get<I>(value));
+			});
+		}
+
+		template<typename It>
+		void insert(size_t index, It first, It last, size_t count) {
+			construct_rows(index, count, [&](auto I, auto data) {
+				std::uninitialized_copy(field_iterator<I, T, It>{first}, field_iterator<I, T, It>{last}, data);
+			});
+		}
+
+		template<typename... Args>
+		void emplace(size_t index, Args&&... args) {
+			auto arguments = std::forward_as_tuple(std::forward<Args>(args)...);
+			construct_row(index, [&](auto I) -> decltype(auto) {
+				return std::get<I>(std::move(arguments));
+			});
+		}
+
+		void erase(size_t first, size_t last) {
+			if (first == last) {
+				return;
+			}
+			size_t count = last - first;
+			for_each_column([&](auto I) {
+				auto data = std::get<I>(pointers);
+				if constexpr (bitwise_column<I>) {
+					std::memmove(data + first, data + last, (element_count - last) * sizeof(column_type<I>));
+				}
+				else {
+					std::move(data + last, data + element_count, data + first);
+					std::destroy_n(data + element_count - count, count);
+				}
+			});
+			element_count -= count;
+		}
+
+		template<typename U>
+		void push_back(U&& value) {
+			insert(element_count, std::forward<U>(value));
+		}
+
+		template<typename... Args>
+		void emplace_back(Args&&... args) {
+			emplace(element_count, std::forward<Args>(args)...);
+		}
+
+		void pop_back() {
+			--element_count;
+			for_each_column([&](auto I) {
+				std::destroy_at(std::addressof(std::get<I>(pointers)[element_count]));
+			});
+		}
+
+		void resize(size_t count) {
+			resize_with(count, [&](auto, auto data, size_t n) {
+				std::uninitialized_value_construct_n(data, n);
+			});
+		}
+		void resize(size_t count, const T& value) {
+			resize_with(count, [&](auto I, auto data, size_t n) {
+				std::uninitialized_fill_n(data, n, reflect::get<I>(value));
+			});
+		}
+
+		void resize_for_overwrite(size_t count) {
+			resize_with(count, [&](auto, auto data, size_t n) {
+				std::uninitialized_default_construct_n(data, n);
+			});
+		}
+
+#ifdef SOA_EXECUTION_POLICIES
+		// Column-wise operations: the block is allocated once, then columns are processed concurrently
+		template<typename ExecutionPolicy>
+		void assign(ExecutionPolicy&& policy, size_t count, const T& value) {
+			clear(policy);
+			resize(policy, count, value);
+		}
+		template<typename ExecutionPolicy>
+		void reserve(ExecutionPolicy&& policy, size_t new_cap) {
+			if (new_cap > max_size()) {
+				throw std::length_error("soa::reserve");
+			}
+			if (new_cap > element_capacity) {
+				reallocate(policy, new_cap);
+			}
+		}
+		template<typename ExecutionPolicy>
+		void shrink_to_fit(ExecutionPolicy&& policy) {
+			if (element_capacity > padded_capacity(element_count)) {
+				reallocate(policy, element_count);
+			}
+		}
+		template<typename ExecutionPolicy>
+		void clear(ExecutionPolicy&& policy) {
+			for_each_column(policy, [&](auto I) {
+				std::destroy_n(policy, std::get<I>(pointers), element_count);
+			});
+			element_count = 0;
+		}
+		template<typename ExecutionPolicy>
+		void erase(ExecutionPolicy&& policy, size_t first, size_t last) {
+			if (first == last) {
+				return;
+			}
+			size_t count = last - first;
+			for_each_column(policy, [&](auto I) {
+				// Source and destination may overlap, so elements are shifted sequentially inside each column
+				auto data = std::get<I>(pointers);
+				if constexpr (bitwise_column<I>) {
+					std::memmove(data + first, data + last, (element_count - last) * sizeof(column_type<I>));
+				}
+				else {
+					std::move(data + last, data + element_count, data + first);
+					std::destroy_n(data + element_count - count, count);
+				}
+			});
+			element_count -= count;
+		}
+		template<typename ExecutionPolicy>
+		void resize(ExecutionPolicy&& policy, size_t count) {
+			resize_with(policy, count, [&](auto, auto data, size_t n) {
+				std::uninitialized_value_construct_n(policy, data, n);
+			});
+		}
+		template<typename ExecutionPolicy>
+		void resize(ExecutionPolicy&& policy, size_t count, const T& value) {
+			resize_with(policy, count, [&](auto I, auto data, size_t n) {
+				std::uninitialized_fill_n(policy, data, n, reflect::get<I>(value));
+			});
+		}
+#endif
+
+		void swap(block_columns& other) noexcept {
+			if constexpr (unit_traits::propagate_on_container_swap::value) {
+				std::swap(allocator, other.allocator);
+			}
+			std::swap(buffer, other.buffer);
+			std::swap(pointers, other.pointers);
+			std::swap(element_count, other.element_count);
+			std::swap(element_capacity, other.element_capacity);
+		}
+
+	private:
+		[[no_unique_address]] unit_allocator allocator;
+		unit *buffer = nullptr;
+		pointer_tuple pointers{};
+		size_t element_count = 0;
+		size_t element_capacity = 0;
+
+		static size_t padded_capacity(size_t capacity) {
+			return align_up(capacity, Layout::capacity_granularity);
+		}
+
+		/// Number of elements of the I-th column that can be processed by full SIMD vectors, without going past capacity
+		template<size_t I>
+		size_t padded_size() const {
+			constexpr size_t lanes = std::max<size_t>(1, Layout::simd_alignment / sizeof(column_type<I>));
+			return std::min(align_up(element_count, lanes), element_capacity);
+		}
+
+		unit *allocate(size_t capacity) {
+			return capacity > 0 ? unit_traits::allocate(allocator, Layout::block_size(capacity) / sizeof(unit)) : nullptr;
+		}
+		void deallocate(unit *block, size_t capacity) {
+			if (block) {
+				unit_traits::deallocate(allocator, block, Layout::block_size(capacity) / sizeof(unit));
+			}
+		}
+
+		/// Destroy all elements and free the block
+		void release() {
+			clear();
+			deallocate(buffer, element_capacity);
+			buffer = nullptr;
+			pointers = {};
+			element_capacity = 0;
+		}
+
+		/// Take ownership of the block of `other`, which must be released or empty
+		void steal(block_columns& other) noexcept {
+			buffer = std::exchange(other.buffer, nullptr);
+			pointers = std::exchange(other.pointers, {});
+			element_count = std::exchange(other.element_count, 0);
+			element_capacity = std::exchange(other.element_capacity, 0);
+		}
+
+		/**
+		 * Copy construct all elements of `other` into this storage, which must be empty.
+		 * If a copy throws the block is freed, because constructors that throw never run the destructor.
+		 */
+		void copy_elements(const block_columns& other) {
+			if (other.element_count > 0) {
+				reserve(other.element_count);
+				try {
+					for_each_column_or_undo([&](auto I) {
+						if constexpr (bitwise_column<I>) {
+							std::memcpy(std::get<I>(pointers), std::get<I>(other.pointers), other.element_count * sizeof(column_type<I>));
+						}
+						else {
+							std::uninitialized_copy_n(std::get<I>(other.pointers), other.element_count, std::get<I>(pointers));
+						}
+					}, [&](auto I) {
+						std::destroy_n(std::get<I>(pointers), other.element_count);
+					});
+				}
+				catch (...) {
+					release();
+					throw;
+				}
+				element_count = other.element_count;
+			}
+		}
+
+		/// Move construct all elements of `other` into this storage, which must be empty, freeing the block if a move throws
+		void move_elements(block_columns& other) {
+			if (other.element_count > 0) {
+				reserve(other.element_count);
+				try {
+					for_each_column_or_undo([&](auto I) {
+						uninitialized_move_column<I>(std::get<I>(other.pointers), other.element_count, std::get<I>(pointers));
+					}, [&](auto I) {
+						std::destroy_n(std::get<I>(pointers), other.element_count);
+					});
+				}
+				catch (...) {
+					release();
+					throw;
+				}
+				element_count = other.element_count;
+				other.clear();
+			}
+		}
+
+		static pointer_tuple pointers_for(unit *block, size_t capacity) {
+			pointer_tuple result{};
+			if (block) {
+				for_each_column([&](auto I) {
+					std::get<I>(result) = Layout::template column_begin<I>(reinterpret_cast<std::byte *>(block), capacity);
+				});
+			}
+			return result;
+		}
+
+		/// Move construct `n` elements of the I-th column into uninitialized memory, with memcpy for bitwise columns
+		template<size_t I, typename It>
+		static void uninitialized_move_column(It first, size_t n, It dest) {
+			if constexpr (bitwise_column<I>) {
+				if (n > 0) {
+					std::memcpy(dest, first, n * sizeof(column_type<I>));
+				}
+			}
+			else {
+				std::uninitialized_move_n(first, n, dest);
+			}
+		}
+
+		/// Call `fn(I)` for each column stored in the block
+		template<typename Fn>
+		static void for_each_column(Fn&& fn) {
+			[&]<auto... Ns>(std::index_sequence<Ns...>) {
+				(fn(std::integral_constant<size_t, Ns>{}), ...);
+			}(typename Layout::fields{});
+		}
+#ifdef SOA_EXECUTION_POLICIES
+		/// Call `fn(I)` for each column stored in the block, concurrently as allowed by `policy`
+		template<typename ExecutionPolicy, typename Fn>
+		static void for_each_column(ExecutionPolicy&& policy, Fn&& fn) {
+			for_each_field(typename Layout::fields{}, policy, fn);
+		}
+#endif
+
+		/// Call `fn(I)` for each column, calling `undo(I)` for the columns already processed if one of them throws
+		template<typename Fn, typename Undo>
+		static void for_each_column_or_undo(Fn&& fn, Undo&& undo) {
+			size_t done = 0;
+			try {
+				for_each_column([&](auto I) {
+					fn(I);
+					++done;
+				});
+			}
+			catch (...) {
+				size_t undone = 0;
+				for_each_column([&](auto I) {
+					if (undone++ < done) {
+						undo(I);
+					}
+				});
+				throw;
+			}
+		}
+
+		size_t recommend(size_t new_size) const {
+			if (new_size > max_size()) {
+				throw std::length_error("soa");
+			}
+			return std::max(new_size, std::min(2 * element_capacity, max_size()));
+		}
+
+		/**
+		 * Move all columns to a new block with `new_capacity` elements.
+		 * Leaves a gap of `gap_count` elements at `gap_index` in each column, for insertions.
+		 * The gap is uninitialized, unless `construct_gap(new_pointers)` is given to construct its elements
+		 * before any element is relocated, so that they may be built from current elements.
+		 * `construct_gap` must leave nothing constructed if it throws.
+		 * If an exception is thrown, the current block is left untouched.
+		 */
+		template<typename ConstructGap = std::nullptr_t>
+		void reallocate(size_t new_capacity, size_t gap_index = 0, size_t gap_count = 0, ConstructGap&& construct_gap = nullptr) {
+			constexpr bool constructs_gap = !std::is_null_pointer_v<std::remove_cvref_t<ConstructGap>>;
+			new_capacity = padded_capacity(new_capacity);
+			unit *new_buffer = allocate(new_capacity);
+			pointer_tuple new_pointers = pointers_for(new_buffer, new_capacity);
+			if constexpr (constructs_gap) {
+				try {
+					construct_gap(new_pointers);
+				}
+				catch (...) {
+					deallocate(new_buffer, new_capacity);
+					throw;
+				}
+			}
+			auto relocate = [&](auto I, auto&& uninitialized_relocate_n) {
+				auto data = std::get<I>(pointers);
+				auto new_data = std::get<I>(new_pointers);
+				uninitialized_relocate_n(data, gap_index, new_data);
+				try {
+					uninitialized_relocate_n(data + gap_index, element_count - gap_index, new_data + gap_index + gap_count);
+				}
+				catch (...) {
+					std::destroy_n(new_data, gap_index);
+					throw;
+				}
+			};
+
+			// Columns that must be copied go first, so that throwing leaves no moved-from column behind
+			try {
+				for_each_column_or_undo([&](auto I) {
+					if constexpr (!relocate_by_move<column_type<I>>) {
+						relocate(I, [](auto first, size_t n, auto dest) { std::uninitialized_copy_n(first, n, dest); });
+					}
+				}, [&](auto I) {
+					if constexpr (!relocate_by_move<column_type<I>>) {
+						std::destroy_n(std::get<I>(new_pointers), gap_index);
+						std::destroy_n(std::get<I>(new_pointers) + gap_index + gap_count, element_count - gap_index);
+					}
+				});
+			}
+			catch (...) {
+				if constexpr (constructs_gap) {
+					for_each_column([&](auto I) {
+						std::destroy_n(std::get<I>(new_pointers) + gap_index, gap_count);
+					});
+				}
+				deallocate(new_buffer, new_capacity);
+				throw;
+			}
+			for_each_column([&](auto I) {
+				if constexpr (relocate_by_move<column_type<I>>) {
+					relocate(I, [&](auto first, size_t n, auto dest) { uninitialized_move_column<I>(first, n, dest); });
+				}
+				std::destroy_n(std::get<I>(pointers), element_count);
+			});
+
+			deallocate(buffer, element_capacity);
+			buffer = new_buffer;
+			pointers = new_pointers;
+			element_capacity = new_capacity;
+		}
+
+		/**
+		 * Open a gap of `count` uninitialized elements at `index` in each column, growing the block if necessary.
+		 * Elements after `index` are shifted by `count`, but `element_count` is not modified.
+		 */
+		void open_gap(size_t index, size_t count) {
+			if (element_count + count > element_capacity) {
+				reallocate(recommend(element_count + count), index, count);
+				return;
+			}
+			for_each_column([&](auto I) {
+				auto data = std::get<I>(pointers);
+				if constexpr (bitwise_column<I>) {
+					std::memmove(data + index + count, data + index, (element_count - index) * sizeof(column_type<I>));
+				}
+				else {
+					size_t tail = std::min(count, element_count - index);
+					std::uninitialized_move_n(data + element_count - tail, tail, data + element_count - tail + count);
+					std::move_backward(data + index, data + element_count - tail, data + element_count);
+					std::destroy_n(data + index, tail);
+				}
+			});
+		}
+
+		/// Close a gap previously opened with `open_gap`
+		void close_gap(size_t index, size_t count) {
+			for_each_column([&](auto I) {
+				auto data = std::get<I>(pointers);
+				if constexpr (bitwise_column<I>) {
+					std::memmove(data + index, data + index + count, (element_count - index) * sizeof(column_type<I>));
+				}
+				else {
+					size_t head = std::min(count, element_count - index);
+					std::uninitialized_move_n(data + index + count, head, data + index);
+					std::move(data + index + count + head, data + element_count + count, data + index + head);
+					size_t live_tail_start = std::max(element_count, index + count);
+					std::destroy(data + live_tail_start, data + element_count + count);
+				}
+			});
+		}
+
+		/**
+		 * Insert a new element at `index`, constructing each field I from `get(I)`, which may refer to elements of the container, as with std::vector.
+		 * So fields are constructed before the elements are relocated to a new block, or into temporaries when elements are shifted in place.
+		 */
+		template<typename Get>
+		void construct_row(size_t index, Get&& get) {
+			auto construct_fields = [&](const pointer_tuple& at) {
+				for_each_column_or_undo([&](auto I) {
+					std::construct_at(std::addressof(std::get<I>(at)[index]), get(I));
+				}, [&](auto I) {
+					std::destroy_at(std::addressof(std::get<I>(at)[index]));
+				});
+			};
+			if (element_count == element_capacity) {
+				reallocate(recommend(element_count + 1), index, 1, construct_fields);
+				element_count++;
+			}
+			else if (index == element_count) {
+				construct_fields(pointers);
+				element_count++;
+			}
+			else {
+				[&]<size_t... Ns>(std::index_sequence<Ns...>) {
+					std::tuple<column_type<Ns>...> values(get(std::integral_constant<size_t, Ns>{})...);
+					construct_rows(index, 1, [&](auto I, auto data) {
+						std::construct_at(std::addressof(*data), std::move(std::get<stored_position<I>>(values)));
+					});
+				}(typename Layout::fields{});
+			}
+		}
+
+		/// Insert `count` new elements at `index`, calling `construct(I, data)` to construct the fields of each column in place
+		template<typename Fn>
+		void construct_rows(size_t index, size_t count, Fn&& construct) {
+			if (count == 0) {
+				return;
+			}
+			open_gap(index, count);
+			try {
+				for_each_column_or_undo([&](auto I) {
+					construct(I, std::get<I>(pointers) + index);
+				}, [&](auto I) {
+					std::destroy_n(std::get<I>(pointers) + index, count);
+				});
+			}
+			catch (...) {
+				close_gap(index, count);
+				throw;
+			}
+			element_count += count;
+		}
+
+#ifdef SOA_EXECUTION_POLICIES
+		/// Move all columns to a new block with `new_capacity` elements, relocating columns concurrently
+		template<typename ExecutionPolicy>
+		void reallocate(ExecutionPolicy&& policy, size_t new_capacity) {
+			new_capacity = padded_capacity(new_capacity);
+			unit *new_buffer = allocate(new_capacity);
+			pointer_tuple new_pointers = pointers_for(new_buffer, new_capacity);
+			for_each_column(policy, [&](auto I) {
+				auto data = std::get<I>(pointers);
+				if constexpr (bitwise_column<I>) {
+					uninitialized_move_column<I>(data, element_count, std::get<I>(new_pointers));
+				}
+				else if constexpr (relocate_by_move<column_type<I>>) {
+					std::uninitialized_move_n(policy, data, element_count, std::get<I>(new_pointers));
+				}
+				else {
+					std::uninitialized_copy_n(policy, data, element_count, std::get<I>(new_pointers));
+				}
+				std::destroy_n(policy, data, element_count);
+			});
+			deallocate(buffer, element_capacity);
+			buffer = new_buffer;
+			pointers = new_pointers;
+			element_capacity = new_capacity;
+		}
+
+		/// Resize all columns concurrently, calling `construct(I, data, n)` to fill new elements
+		template<typename ExecutionPolicy, typename Fn>
+		void resize_with(ExecutionPolicy&& policy, size_t count, Fn&& construct) {
+			if (count > element_capacity) {
+				reallocate(policy, recommend(count));
+			}
+			for_each_column(policy, [&](auto I) {
+				auto data = std::get<I>(pointers);
+				if (count <= element_count) {
+					std::destroy(policy, data + count, data + element_count);
+				}
+				else {
+					construct(I, data + element_count, count - element_count);
+				}
+			});
+			element_count = count;
+		}
+#endif
+
+		/// Resize all columns, calling `construct(I, data, n)` to fill new elements
+		template<typename Fn>
+		void resize_with(size_t count, Fn&& construct) {
+			if (count <= element_count) {
+				for_each_column([&](auto I) {
+					std::destroy(std::get<I>(pointers) + count, std::get<I>(pointers) + element_count);
+				});
+			}
+			else {
+				if (count > element_capacity) {
+					reallocate(recommend(count));
+				}
+				for_each_column_or_undo([&](auto I) {
+					construct(I, std::get<I>(pointers) + element_count, count - element_count);
+				}, [&](auto I) {
+					std::destroy(std::get<I>(pointers) + element_count, std::get<I>(pointers) + count);
+				});
+			}
+			element_count = count;
+		}
+	};
+}
+
+namespace detail {
+	/**
+	 * Column storage that splits the fields of type T into hot and cold groups.
+	 * Hot fields, with indices `Hot...`, are kept in a single block like `block_storage`.
+	 * Each cold field has its own std::vector, which is materialized lazily:
+	 * it may be shorter than the container, missing elements being value-initialized on first access.
+	 *
+	 * So `reserve`, `resize(count)`, `erase` and `pop_back` never allocate nor touch unaccessed cold columns,
+	 * while operations given values of T (like `push_back` or `insert`) materialize them.
+	 * `soa::erase_unordered`, `erase_if` and sorts skip the cold columns that store no element, see `stored_size`.
+	 * Cold fields must be default constructible.
+	 * Accessing a cold column may allocate even through a const container, so first accesses are not thread safe.
+	 */
+	template<typename T, typename Allocator, size_t... Hot>
+	class hot_cold_columns {
+		template<size_t I>
+		static constexpr bool is_hot = ((I == Hot) || ...);
+
+		static_assert(distinct_indices<Hot...>(), "Hot fields must be listed exactly once");
+
+		template<size_t I>
+		using cold_vector = std::conditional_t<
+			is_hot<I>,
+			std::monostate,
+			typename rebound_vector<Allocator>::template type<bool_to_union<field_type<I, T>>>
+		>;
+
+		using hot_columns = block_columns<T, Allocator, contiguous_layout<T, 1, std::index_sequence<Hot...>>>;
+		using cold_tuple = decltype([]<auto... Ns>(std::index_sequence<Ns...>) {
+			return std::tuple<cold_vector<Ns>...>();
+		}(std::make_index_sequence<reflect::size<T>()>{}));
+
+	public:
+		hot_cold_columns() = default;
+		explicit hot_cold_columns(const Allocator& alloc)
+			: hot(alloc)
+			, cold(make_cold(alloc))
+		{
+		}
+		hot_cold_columns(const hot_cold_columns& other, const Allocator& alloc)
+			: hot(other.hot, alloc)
+			, cold(make_cold(other.cold, alloc))
+		{
+		}
+		hot_cold_columns(hot_cold_columns&& other, const Allocator& alloc)
+			: hot(std::move(other.hot), alloc)
+			, cold(make_cold(std::move(other.cold), alloc))
+		{
+		}
+
+		Allocator get_allocator() const {
+			return hot.get_allocator();
+		}
+
+		size_t size() const {
+			return hot.size();
+		}
+		size_t capacity() const {
+			return hot.capacity();
+		}
+		size_t max_size() const {
+			return hot.max_size();
+		}
+
+		template<size_t I>
+		auto column() {
+			if constexpr (is_hot<I>) {
+				return hot.template column<I>();
+			}
+			else {
+				return vector_to_span(materialize<I>());
+			}
+		}
+		template<size_t I>
+		auto column() const {
+			if constexpr (is_hot<I>) {
+				return hot.template column<I>();
+			}
+			else {
+				return vector_to_span(std::as_const(materialize<I>()));
+			}
+		}
+		/// Number of elements stored in the I-th column, without materializing it: 0 for cold columns that were never accessed
+		template<size_t I>
+		size_t stored_size() const {
+			if constexpr (is_hot<I>) {
+				return hot.size();
+			}
+			else {
+				return get_cold<I>().size();
+			}
+		}
+		/// Capacity of the I-th column, 0 for cold columns that were never materialized
+		template<size_t I>
+		size_t column_capacity() const {
+			if constexpr (is_hot<I>) {
+				return hot.capacity();
+			}
+			else {
+				return get_cold<I>().capacity();
+			}
+		}
+
+		void assign(size_t count, const T& value) {
+			clear();
+			resize(count, value);
+		}
+
+		void reserve(size_t new_cap) {
+			hot.reserve(new_cap);
+		}
+
+		void shrink_to_fit() {
+			hot.shrink_to_fit();
+			for_each_cold([&](auto I) {
+				get_cold<I>().shrink_to_fit();
+			});
+		}
+
+		void clear() {
+			hot.clear();
+			for_each_cold([&](auto I) {
+				get_cold<I>().clear();
+			});
+		}
+
+		template<typename U>
+		void insert(size_t index, U&& value) {
+			insert_rows(index, 1, [&](auto I, auto& vec) {
+				vec.insert(vec.begin() + index, forward_field<I>(std::forward<U>(value)));
+			}, [&] {
+				hot.insert(index, std::forward<U>(value));
+			});
+		}
+
+		void insert(size_t index, size_t count, const T& value) {
+			insert_rows(index, count, [&](auto I, auto& vec) {
+				vec.insert(vec.begin() + index, count, reflect::get<I>(value));
+			}, [&] {
+				hot.insert(index, count, value);
+			});
+		}
+
+		template<typename It>
+		void insert(size_t index, It first, It last, size_t count) {
+			insert_rows(index, count, [&](auto I, auto& vec) {
+				vec.insert(vec.begin() + index, field_iterator<I, T, It>{first}, field_iterator<I, T, It>{last});
+			}, [&] {
+				hot.insert(index, first, last, count);
+			});
+		}
+
+		template<typename... Args>
+		void emplace(size_t index, Args&&... args) {
+			// Arguments may refer to elements of other columns, that move when their vector grows
+			field_types<T> arguments(std::forward<Args>(args)...);
+			insert_rows(index, 1, [&](auto I, auto& vec) {
+				vec.emplace(vec.begin() + index, std::get<I>(std::move(arguments)));
+			}, [&] {
+				std::apply([&](auto&&... args) {
+					hot.emplace(index, std::forward<decltype(args)>(args)...);
+				}, std::move(arguments));
+			});
+		}
+
+		void erase(size_t first, size_t last) {
+			hot.erase(first, last);
+			for_each_cold([&](auto I) {
+				auto& vec = get_cold<I>();
+				if (first < vec.size()) {
+					vec.erase(vec.begin() + first, vec.begin() + std::min(last, vec.size()));
+				}
+			});
+		}
+
+		template<typename U>
+		void push_back(U&& value) {
+			insert(size(), std::forward<U>(value));
+		}
+
+		template<typename... Args>
+		void emplace_back(Args&&... args) {
+			emplace(size(), std::forward<Args>(args)...);
+		}
+
+		void pop_back() {
+			hot.pop_back();
+			truncate_cold(size());
+		}
+
+		void resize(size_t count) {
+			hot.resize(count);
+			truncate_cold(count);
+		}
+		void resize_for_overwrite(size_t count) {
+			hot.resize_for_overwrite(count);
+			truncate_cold(count);
+		}
+		void resize(size_t count, const T& value) {
+			if (count <= size()) {
+				resize(count);
+				return;
+			}
+			size_t old_count = size();
+			try {
+				for_each_cold([&](auto I) {
+					materialize<I>().resize(count, reflect::get<I>(value));
+				});
+				hot.resize(count, value);
+			}
+			catch (...) {
+				truncate_cold(old_count);
+				throw;
+			}
+		}
+
+#ifdef SOA_EXECUTION_POLICIES
+		// Column-wise operations: only the hot block is processed concurrently
+		template<typename ExecutionPolicy>
+		void assign(ExecutionPolicy&& policy, size_t count, const T& value) {
+			clear(policy);
+			resize(policy, count, value);
+		}
+		template<typename ExecutionPolicy>
+		void reserve(ExecutionPolicy&& policy, size_t new_cap) {
+			hot.reserve(policy, new_cap);
+		}
+		template<typename ExecutionPolicy>
+		void shrink_to_fit(ExecutionPolicy&& policy) {
+			hot.shrink_to_fit(policy);
+			for_each_cold([&](auto I) {
+				get_cold<I>().shrink_to_fit();
+			});
+		}
+		template<typename ExecutionPolicy>
+		void clear(ExecutionPolicy&& policy) {
+			hot.clear(policy);
+			for_each_cold([&](auto I) {
+				get_cold<I>().clear();
+			});
+		}
+		template<typename ExecutionPolicy>
+		void erase(ExecutionPolicy&& policy, size_t first, size_t last) {
+			hot.erase(policy, first, last);
+			for_each_cold([&](auto I) {
+				auto& vec = get_cold<I>();
+				if (first < vec.size()) {
+					vec.erase(vec.begin() + first, vec.begin() + std::min(last, vec.size()));
+				}
+			});
+		}
+		template<typename ExecutionPolicy>
+		void resize(ExecutionPolicy&& policy, size_t count) {
+			hot.resize(policy, count);
+			truncate_cold(count);
+		}
+		template<typename ExecutionPolicy>
+		void resize(ExecutionPolicy&& policy, size_t count, const T& value) {
+			if (count <= size()) {
+				resize(policy, count);
+				return;
+			}
+			for_each_cold([&](auto I) {
+				materialize<I>().resize(count, reflect::get<I>(value));
+			});
+			hot.resize(policy, count, value);
+		}
+#endif
+
+		void swap(hot_cold_columns& other) noexcept {
+			hot.swap(other.hot);
+			cold.swap(other.cold);
+		}
+
+	private:
+		hot_columns hot;
+		// Cold vectors may be materialized from const member functions
+		mutable cold_tuple cold;
+
+		static cold_tuple make_cold(const Allocator& alloc) {
+			return [&]<auto... Ns>(std::index_sequence<Ns...>) {
+				return cold_tuple(make_cold_vector<Ns>(alloc)...);
+			}(std::make_index_sequence<reflect::size<T>()>{});
+		}
+		template<size_t I>
+		static cold_vector<I> make_cold_vector(const Allocator& alloc) {
+			if constexpr (is_hot<I>) {
+				return {};
+			}
+			else {
+				return cold_vector<I>(alloc);
+			}
+		}
+		/// Copy or move the cold vectors of `other` into memory from `alloc`
+		template<typename OtherCold>
+		static cold_tuple make_cold(OtherCold&& other, const Allocator& alloc) {
+			return [&]<auto... Ns>(std::index_sequence<Ns...>) {
+				return cold_tuple(make_cold_vector<Ns>(std::get<Ns>(std::forward<OtherCold>(other)), alloc)...);
+			}(std::make_index_sequence<reflect::size<T>()>{});
+		}
+		template<size_t I, typename Vector>
+		static cold_vector<I> make_cold_vector(Vector&& other, const Allocator& alloc) {
+			if constexpr (is_hot<I>) {
+				return {};
+			}
+			else {
+				return cold_vector<I>(std::forward<Vector>(other), alloc);
+			}
+		}
+
+		template<size_t I>
+		auto& get_cold() const {
+			return std::get<I>(cold);
+		}
+
+		/// Call `fn(I)` for each cold field index
+		template<typename Fn>
+		static void for_each_cold(Fn&& fn) {
+			reflect::for_each<T>([&](auto I) {
+				if constexpr (!is_hot<I>) {
+					fn(I);
+				}
+			});
+		}
+
+		/// Value-initialize the missing elements of the I-th cold column
+		template<size_t I>
+		auto& materialize() const {
+			auto& vec = get_cold<I>();
+			if (vec.size() < size()) {
+				vec.resize(size());
+			}
+			return vec;
+		}
+
+		/// Remove elements past `count` from the materialized cold columns
+		void truncate_cold(size_t count) {
+			for_each_cold([&](auto I) {
+				auto& vec = get_cold<I>();
+				if (vec.size() > count) {
+					vec.erase(vec.begin() + count, vec.end());
+				}
+			});
+		}
+
+		/**
+		 * Insert `count` elements at `index`, calling `insert_cold(I, vec)` for each cold column and then `insert_hot()`.
+		 * Cold columns are materialized first. If an exception is thrown, elements already inserted are removed.
+		 */
+		template<typename ColdFn, typename HotFn>
+		void insert_rows(size_t index, size_t count, ColdFn&& insert_cold, HotFn&& insert_hot) {
+			for_each_cold([&](auto I) {
+				materialize<I>();
+			});
+			size_t done = 0;
+			try {
+				for_each_cold([&](auto I) {
+					insert_cold(I, get_cold<I>());
+					++done;
+				});
+				insert_hot();
+			}
+			catch (...) {
+				size_t undone = 0;
+				for_each_cold([&](auto I) {
+					if (undone++ < done) {
+						auto& vec = get_cold<I>();
+						vec.erase(vec.begin() + index, vec.begin() + index + count);
+					}
+				});
+				throw;
+			}
+		}
+	};
+}
+
+/**
+ * Reallocation of a column of a `soa` using `instrumented_storage`, reported to `Instrumentation::on_reallocation`.
+ * The column holding `moved_elements` elements of `element_size` bytes went from `old_capacity` to `new_capacity` elements.
+ * Storages that grow without relocating elements, like `chunked_storage`, still report the elements they keep as moved.
+ */
+struct reallocation_event {
+	std::string_view field;
+	size_t element_size;
+	size_t old_capacity;
+	size_t new_capacity;
+	size_t moved_elements;
+};
+
+/**
+ * Operation of a `soa` using `instrumented_storage` that may allocate or shift rows, reported to `Instrumentation::on_operation`.
+ * `shifted_rows` rows, of `row_size` bytes over all columns, were moved by `insert` or `erase` to open or close a gap.
+ */
+struct operation_event {
+	std::string_view operation;
+	size_t shifted_rows;
+	size_t row_size;
+	std::chrono::nanoseconds duration;
+};
+
+/**
+ * Instrumentation of `instrumented_storage` summing events into static counters,
+ * shared by all containers instrumented with the same `Tag`.
+ */
+template<typename Tag = void>
+struct instrumentation_counters {
+	/// Number of column reallocations
+	static inline std::atomic<size_t> reallocations = 0;
+	/// Bytes of elements moved by reallocations
+	static inline std::atomic<size_t> moved_bytes = 0;
+	/// Number of instrumented operations
+	static inline std::atomic<size_t> operations = 0;
+	/// Bytes of elements moved by `insert` and `erase` gaps
+	static inline std::atomic<size_t> shifted_bytes = 0;
+	/// Total duration of instrumented operations, in nanoseconds
+	static inline std::atomic<std::chrono::nanoseconds::rep> nanoseconds = 0;
+
+	static void on_reallocation(const reallocation_event& event) {
+		reallocations.fetch_add(1, std::memory_order_relaxed);
+		moved_bytes.fetch_add(event.moved_elements * event.element_size, std::memory_order_relaxed);
+	}
+
+	static void on_operation(const operation_event& event) {
+		operations.fetch_add(1, std::memory_order_relaxed);
+		shifted_bytes.fetch_add(event.shifted_rows * event.row_size, std::memory_order_relaxed);
+		nanoseconds.fetch_add(event.duration.count(), std::memory_order_relaxed);
+	}
+
+	static void reset() {
+		reallocations = 0;
+		moved_bytes = 0;
+		operations = 0;
+		shifted_bytes = 0;
+		nanoseconds = 0;
+	}
+};
+
+namespace detail {
+	/**
+	 * Column storage of `instrumented_storage`, wrapping each operation of `Columns` that may allocate or shift rows
+	 * with calls to the hooks of `Instrumentation`. Capacities are only compared, and the clock only read, for hooks it defines.
+	 */
+	template<typename T, typename Columns, typename Instrumentation>
+	class instrumented_columns : public Columns {
+		static constexpr bool reports_reallocations = requires(const reallocation_event& event) {
+			Instrumentation::on_reallocation(event);
+		};
+		static constexpr bool reports_operations = requires(const operation_event& event) {
+			Instrumentation::on_operation(event);
+		};
+
+		static constexpr size_t row_size = []<auto... Ns>(std::index_sequence<Ns...>) {
+			return (sizeof(field_type<Ns, T>) + ...);
+		}(std::make_index_sequence<reflect::size<T>()>{});
+
+	public:
+		using Columns::Columns;
+
+		void assign(size_t count, const T& value) {
+			instrument("assign", 0, [&] {
+				Columns::assign(count, value);
+			});
+		}
+
+		void reserve(size_t new_cap) {
+			instrument("reserve", 0, [&] {
+				Columns::reserve(new_cap);
+			});
+		}
+
+		void shrink_to_fit() {
+			instrument("shrink_to_fit", 0, [&] {
+				Columns::shrink_to_fit();
+			});
+		}
+
+		template<typename U>
+		void insert(size_t index, U&& value) {
+			instrument("insert", this->size() - index, [&] {
+				Columns::insert(index, std::forward<U>(value));
+			});
+		}
+
+		void insert(size_t index, size_t count, const T& value) {
+			instrument("insert", this->size() - index, [&] {
+				Columns::insert(index, count, value);
+			});
+		}
+
+		template<typename It>
+		void insert(size_t index, It first, It last, size_t count) {
+			instrument("insert", this->size() - index, [&] {
+				Columns::insert(index, first, last, count);
+			});
+		}
+
+		template<typename... Args>
+		void emplace(size_t index, Args&&... args) {
+			instrument("emplace", this->size() - index, [&] {
+				Columns::emplace(index, std::forward<Args>(args)...);
+			});
+		}
+
+		void erase(size_t first, size_t last) {
+			instrument("erase", this->size() - last, [&] {
+				Columns::erase(first, last);
+			});
+		}
+
+		template<typename U>
+		void push_back(U&& value) {
+			instrument("push_back", 0, [&] {
+				Columns::push_back(std::forward<U>(value));
+			});
+		}
+
+		template<typename... Args>
+		void emplace_back(Args&&... args) {
+			instrument("emplace_back", 0, [&] {
+				Columns::emplace_back(std::forward<Args>(args)...);
+			});
+		}
+
+		void resize(size_t count) {
+			instrument("resize", 0, [&] {
+				Columns::resize(count);
+			});
+		}
+		void resize(size_t count, const T& value) {
+			instrument("resize", 0, [&] {
+				Columns::resize(count, value);
+			});
+		}
+		void resize_for_overwrite(size_t count) {
+			instrument("resize_for_overwrite", 0, [&] {
+				Columns::resize_for_overwrite(count);
+			});
+		}
+
+#ifdef SOA_EXECUTION_POLICIES
+		template<typename ExecutionPolicy>
+		void assign(ExecutionPolicy&& policy, size_t count, const T& value) {
+			instrument("assign", 0, [&] {
+				Columns::assign(policy, count, value);
+			});
+		}
+		template<typename ExecutionPolicy>
+		void reserve(ExecutionPolicy&& policy, size_t new_cap) {
+			instrument("reserve", 0, [&] {
+				Columns::reserve(policy, new_cap);
+			});
+		}
+		template<typename ExecutionPolicy>
+		void shrink_to_fit(ExecutionPolicy&& policy) {
+			instrument("shrink_to_fit", 0, [&] {
+				Columns::shrink_to_fit(policy);
+			});
+		}
+		template<typename ExecutionPolicy>
+		void erase(ExecutionPolicy&& policy, size_t first, size_t last) {
+			instrument("erase", this->size() - last, [&] {
+				Columns::erase(policy, first, last);
+			});
+		}
+		template<typename ExecutionPolicy>
+		void resize(ExecutionPolicy&& policy, size_t count) {
+			instrument("resize", 0, [&] {
+				Columns::resize(policy, count);
+			});
+		}
+		template<typename ExecutionPolicy>
+		void resize(ExecutionPolicy&& policy, size_t count, const T& value) {
+			instrument("resize", 0, [&] {
+				Columns::resize(policy, count, value);
+			});
+		}
+#endif
+
+	private:
+		/// Capacity of each column, shared by all columns in block storages
+		std::array<size_t, reflect::size<T>()> column_capacities() const {
+			std::array<size_t, reflect::size<T>()> capacities;
+			reflect::for_each<T>([&](auto I) {
+				if constexpr (requires(const Columns& columns) { columns.template column_capacity<I>(); }) {
+					capacities[I] = this->template column_capacity<I>();
+				}
+				else {
+					capacities[I] = this->capacity();
+				}
+			});
+			return capacities;
+		}
+
+		/// Run `fn`, the operation `operation` which shifts `shifted_rows` rows, and report it
+		template<typename Fn>
+		void instrument(std::string_view operation, size_t shifted_rows, Fn&& fn) {
+			std::array<size_t, reflect::size<T>()> old_capacities {};
+			size_t old_size = this->size();
+			std::chrono::steady_clock::time_point start;
+			if constexpr (reports_reallocations) {
+				old_capacities = column_capacities();
+			}
+			if constexpr (reports_operations) {
+				start = std::chrono::steady_clock::now();
+			}
+
+			fn();
+
+			if constexpr (reports_operations) {
+				auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+				Instrumentation::on_operation(operation_event{ operation, shifted_rows, row_size, duration });
+			}
+			if constexpr (reports_reallocations) {
+				auto new_capacities = column_capacities();
+				reflect::for_each<T>([&](auto I) {
+					if (new_capacities[I] != old_capacities[I]) {
+						Instrumentation::on_reallocation(reallocation_event{
+							reflect::member_name<I, T>(), sizeof(field_type<I, T>),
+							old_capacities[I], new_capacities[I], std::min(old_size, this->size())
+						});
+					}
+				});
+			}
+		}
+	};
+}
+
+/// Storage policy that keeps each field in its own std::vector (default).
+struct vector_storage {
+	template<typename T, typename Allocator>
+	using columns = detail::vector_columns<T, Allocator>;
+};
+
+/**
+ * Storage policy like `vector_storage`, with copy-on-write columns: copies of the container share refcounted column vectors,
+ * so copying costs O(fields) (see `soa::snapshot`), and a column is cloned on its first mutable access,
+ * through `field`, proxies or modifiers, while a copy still shares it. Fields must be copyable.
+ * Cloning a column invalidates spans and references into it, so they must be taken again after copying the container.
+ */
+struct cow_storage {
+	template<typename T, typename Allocator>
+	using columns = detail::vector_columns<T, Allocator, detail::cow_fields_vector_tuple<T, Allocator>>;
+};
+
+/**
+ * Storage policy like `vector_storage`, but packing `bool` fields in bits, 64 elements per word.
+ * Their `field` is a `bit_span`, with word access and `count`, `any` and `all` helpers, instead of a std::span.
+ * Since bits can't be referenced, proxies return `bit_reference` for these fields,
+ * and column kernels and `view` are not available for them.
+ */
+struct packed_bool_storage {
+	template<typename T, typename Allocator>
+	using columns = detail::vector_columns<T, Allocator, detail::packed_fields_vector_tuple<T, Allocator>>;
+};
+
+/// Storage policy that keeps all fields in a single contiguous allocation with a shared capacity.
+struct block_storage {
+	template<typename T, typename Allocator>
+	using columns = detail::block_columns<T, Allocator>;
+};
+
+/**
+ * Storage policy like `block_storage`, with every column starting at an `Alignment` byte boundary
+ * and capacity padded to a multiple of the SIMD width of the narrowest field.
+ * Enables `soa::aligned_field`, for writing SIMD kernels without scalar prologues or epilogues.
+ */
+template<size_t Alignment = 64>
+struct aligned_block_storage {
+	template<typename T, typename Allocator>
+	using columns = detail::block_columns<T, Allocator, detail::contiguous_layout<T, Alignment>>;
+};
+
+/**
+ * Storage policy that groups elements in tiles of `N`, each tile holding a small array per field (AoSoA).
+ * Like `block_storage`, everything lives in a single allocation and capacity is a multiple of `N`.
+ * Fields of the same element stay close in memory, which eases TLB and prefetcher pressure when loops read several fields,
+ * while each field array of a tile is still contiguous for vectorized loops.
+ * `soa::field` returns a `tiled_span` instead of a `std::span`.
+ */
+template<size_t N = 16>
+struct tiled_storage {
+	template<typename T, typename Allocator>
+	using columns = detail::block_columns<T, Allocator, detail::tiled_layout<T, N>>;
+};
+
+/**
+ * Storage policy with one deque-like vector per field, made of separately allocated chunks of `N` elements.
+ * Growing allocates new chunks without moving existing elements, so it never holds two copies of a column,
+ * and element addresses stay valid until the element is erased or elements are inserted before it.
+ * `soa::field` returns a `chunked_span` instead of a `std::span`, whose chunks are contiguous for vectorized loops.
+ */
+template<size_t N = 4096>
+struct chunked_storage {
+	static_assert(N > 0, "Chunks must hold at least one element");
+
+	template<typename T, typename Allocator>
+	using columns = detail::vector_columns<T, Allocator, detail::chunked_fields_vector_tuple<T, Allocator, N>>;
+};
+
+/**
+ * Storage policy that splits fields into a hot group, listed by name, and a cold group with all other fields.
+ * Hot fields share a single dense block, like `block_storage`.
+ * Cold fields live in separate vectors that are only allocated and filled when first accessed or given values,
+ * so they cost no memory bandwidth on `reserve`, `resize` or `erase` (see `detail::hot_cold_columns`).
+ *
+ * @code
+ * soa::soa<Particle, std::allocator<Particle>, soa::hot_cold_storage<"position", "velocity">> particles;
+ * @endcode
+ */
+template<reflect::fixed_string... HotFields>
+struct hot_cold_storage {
+	template<typename T, typename Allocator>
+	using columns = detail::hot_cold_columns<T, Allocator, reflect::index_of<HotFields, T>()...>;
+};
+
+/**
+ * Storage policy that stores columns like `Storage`, reporting allocations and row shifts to the static hooks of `Instrumentation`:
+ * - `on_reallocation(const soa::reallocation_event&)`, once for each column whose capacity changed;
+ * - `on_operation(const soa::operation_event&)`, after each operation that may allocate or shift rows, with its duration.
+ * Both hooks are optional. Containers using `Storage` itself are not instrumented, so disabled instrumentation costs nothing.
+ *
+ * @code
+ * using counters = soa::instrumentation_counters<struct particles_tag>;
+ * soa::soa<Particle, std::allocator<Particle>, soa::instrumented_storage<counters>> particles;
+ * // ...
+ * std::println("{} reallocations moved {} bytes", counters::reallocations.load(), counters::moved_bytes.load());
+ * @endcode
+ */
+template<typename Instrumentation = instrumentation_counters<>, typename Storage = vector_storage>
+struct instrumented_storage {
+	template<typename T, typename Allocator>
+	using columns = detail::instrumented_columns<T, typename Storage::template columns<T, Allocator>, Instrumentation>;
+};
+
+/**
+ * Field encoding of `frozen_soa` storing values as they are, the default.
+ * Each encoding provides a `column<U>` type built from a random access range of U, with:
+ * - `size()` and `operator[]`, that decodes a single value;
+ * - `decode(first, count, buffer)`, that decodes `count` values and returns a pointer to them,
+ *   either into `buffer` or into the column itself;
+ * - `memory_usage()`, the number of bytes allocated by the column, not counting memory owned by the values.
+ */
+struct plain_encoding {
+	template<typename U>
+	class column {
+	public:
+		template<typename Range>
+		explicit column(const Range& values)
+			: values(std::ranges::begin(values), std::ranges::end(values))
+		{
+		}
+
+		size_t size() const {
+			return values.size();
+		}
+
+		const U& operator[](size_t index) const {
+			return detail::vector_to_span(values)[index];
+		}
+
+		const U *decode(size_t first, size_t, U *) const {
+			return detail::vector_to_span(values).data() + first;
+		}
+
+		size_t memory_usage() const {
+			return values.capacity() * sizeof(values[0]);
+		}
+
+	private:
+		std::vector<detail::bool_to_union<U>> values;
+	};
+};
+
+/**
+ * Field encoding of `frozen_soa` storing each distinct value once, in a sorted dictionary,
+ * and a `Code` per element indexing it. Suited to low-cardinality fields, like enums or small sets of strings.
+ * `values()` and `codes()` expose the encoded data, so that filters can compare codes instead of values.
+ * Values must be ordered by `operator<`. Throws std::length_error if there are more distinct values than codes.
+ */
+template<std::unsigned_integral Code = std::uint32_t>
+struct dictionary_encoding {
+	template<typename U>
+	class column {
+	public:
+		template<typename Range>
+		explicit column(const Range& range)
+			: dictionary(std::ranges::begin(range), std::ranges::end(range))
+		{
+			std::sort(dictionary.begin(), dictionary.end());
+			dictionary.erase(std::unique(dictionary.begin(), dictionary.end()), dictionary.end());
+			dictionary.shrink_to_fit();
+			if (!dictionary.empty() && dictionary.size() - 1 > std::numeric_limits<Code>::max()) {
+				throw std::length_error("Too many distinct values for the dictionary code type");
+			}
+			elements.reserve(std::ranges::size(range));
+			for (const U& value : range) {
+				elements.push_back(Code(std::lower_bound(dictionary.begin(), dictionary.end(), value) - dictionary.begin()));
+			}
+		}
+
+		size_t size() const {
+			return elements.size();
+		}
+
+		const U& operator[](size_t index) const {
+			return values()[elements[index]];
+		}
+
+		const U *decode(size_t first, size_t count, U *buffer) const {
+			auto dictionary_values = values();
+			for (size_t i = 0; i < count; i++) {
+				buffer[i] = dictionary_values[elements[first + i]];
+			}
+			return buffer;
+		}
+
+		/// Distinct values, sorted
+		std::span<const U> values() const {
+			return detail::vector_to_span(dictionary);
+		}
+
+		/// Index in `values()` of each element
+		std::span<const Code> codes() const {
+			return elements;
+		}
+
+		size_t memory_usage() const {
+			return dictionary.capacity() * sizeof(dictionary[0]) + elements.capacity() * sizeof(Code);
+		}
+
+	private:
+		std::vector<detail::bool_to_union<U>> dictionary;
+		std::vector<Code> elements;
+	};
+};
+
+/**
+ * Field encoding of `frozen_soa` for integers, splitting elements in blocks of `BlockSize`
+ * and storing each element as its offset from the block minimum (frame of reference),
+ * using 0, 1, 2, 4 or 8 bytes per offset depending on the block's range.
+ * Suited to increasing values, like timestamps or ids, and to small values.
+ */
+template<size_t BlockSize = 128>
+struct frame_of_reference_encoding {
+	template<typename U>
+	class column {
+		static_assert(std::is_integral_v<U> && !std::is_same_v<U, bool>, "Frame of reference encoding requires integers");
+
+		using unsigned_type = std::make_unsigned_t<U>;
+
+		struct block {
+			U base;
+			unsigned width;
+			size_t offset;
+		};
+
+	public:
+		template<typename Range>
+		explicit column(const Range& range)
+			: count(std::ranges::size(range))
+		{
+			auto first = std::ranges::begin(range);
+			blocks.reserve((count + BlockSize - 1) / BlockSize);
+			for (size_t start = 0; start < count; start += BlockSize) {
+				size_t end = std::min(count, start + BlockSize);
+				auto [min, max] = std::minmax_element(first + start, first + end);
+				U base = *min;
+				// Small types promote to int, so the difference is truncated back to their width
+				std::uint64_t range_max = std::uint64_t(unsigned_type(unsigned_type(*max) - unsigned_type(base)));
+				unsigned width = range_max == 0 ? 0 : std::bit_ceil(unsigned(std::bit_width(range_max) + 7) / 8);
+				blocks.push_back(block{ base, width, bytes.size() });
+				bytes.resize(bytes.size() + (end - start) * width);
+				for (size_t i = start; i < end; i++) {
+					std::uint64_t offset = std::uint64_t(unsigned_type(unsigned_type(U(first[i])) - unsigned_type(base)));
+					store(bytes.data() + blocks.back().offset + (i - start) * width, width, offset);
+				}
+			}
+			bytes.shrink_to_fit();
+		}
+
+		size_t size() const {
+			return count;
+		}
+
+		U operator[](size_t index) const {
+			const block& b = blocks[index / BlockSize];
+			std::uint64_t offset = load(bytes.data() + b.offset + (index % BlockSize) * b.width, b.width);
+			return U(unsigned_type(b.base) + unsigned_type(offset));
+		}
+
+		const U *decode(size_t first, size_t count, U *buffer) const {
+			size_t index = first;
+			size_t end = first + count;
+			while (index < end) {
+				const block& b = blocks[index / BlockSize];
+				size_t block_end = std::min(end, (index / BlockSize + 1) * BlockSize);
+				const std::byte *data = bytes.data() + b.offset + (index % BlockSize) * b.width;
+				U *out = buffer + (index - first);
+				switch (b.width) {
+					case 0: std::fill(out, out + (block_end - index), b.base); break;
+					case 1: decode_offsets<std::uint8_t>(data, block_end - index, b.base, out); break;
+					case 2: decode_offsets<std::uint16_t>(data, block_end - index, b.base, out); break;
+					case 4: decode_offsets<std::uint32_t>(data, block_end - index, b.base, out); break;
+					default: decode_offsets<std::uint64_t>(data, block_end - index, b.base, out); break;
+				}
+				index = block_end;
+			}
+			return buffer;
+		}
+
+		size_t memory_usage() const {
+			return blocks.capacity() * sizeof(block) + bytes.capacity();
+		}
+
+	private:
+		std::vector<block> blocks;
+		std::vector<std::byte> bytes;
+		size_t count = 0;
+
+		static void store(std::byte *data, unsigned width, std::uint64_t offset) {
+			for (unsigned i = 0; i < width; i++) {
+				data[i] = std::byte(offset >> (8 * i));
+			}
+		}
+		static std::uint64_t load(const std::byte *data, unsigned width) {
+			std::uint64_t offset = 0;
+			for (unsigned i = 0; i < width; i++) {
+				offset |= std::uint64_t(data[i]) << (8 * i);
+			}
+			return offset;
+		}
+
+		template<typename Offset>
+		static void decode_offsets(const std::byte *data, size_t n, U base, U *out) {
+			for (size_t i = 0; i < n; i++) {
+				Offset offset;
+				if constexpr (std::endian::native == std::endian::little) {
+					std::memcpy(&offset, data + i * sizeof(Offset), sizeof(Offset));
+				}
+				else {
+					offset = Offset(load(data + i * sizeof(Offset), sizeof(Offset)));
+				}
+				out[i] = U(unsigned_type(base) + unsigned_type(offset));
+			}
+		}
+	};
+};
+
+/**
+ * Field encoding of `frozen_soa` storing runs of equal consecutive values once, with the index where each run ends.
+ * Suited to sorted or low-cardinality fields with long runs. Accessing a single element is a binary search over runs.
+ */
+struct run_length_encoding {
+	template<typename U>
+	class column {
+	public:
+		template<typename Range>
+		explicit column(const Range& range) {
+			size_t index = 0;
+			for (const U& value : range) {
+				if (run_values.empty() || !(values().back() == value)) {
+					run_values.push_back(value);
+					run_ends.push_back(index + 1);
+				}
+				else {
+					run_ends.back() = index + 1;
+				}
+				index++;
+			}
+			run_values.shrink_to_fit();
+			run_ends.shrink_to_fit();
+		}
+
+		size_t size() const {
+			return run_ends.empty() ? 0 : run_ends.back();
+		}
+
+		const U& operator[](size_t index) const {
+			return values()[run_of(index)];
+		}
+
+		const U *decode(size_t first, size_t count, U *buffer) const {
+			auto values = this->values();
+			size_t end = first + count;
+			for (size_t run = run_of(first), index = first; index < end; run++) {
+				size_t run_end = std::min(end, run_ends[run]);
+				std::fill(buffer + (index - first), buffer + (run_end - first), values[run]);
+				index = run_end;
+			}
+			return buffer;
+		}
+
+		/// Value of each run
+		std::span<const U> values() const {
+			return detail::vector_to_span(run_values);
+		}
+
+		/// Index past the last element of each run
+		std::span<const size_t> ends() const {
+			return run_ends;
+		}
+
+		size_t memory_usage() const {
+			return run_values.capacity() * sizeof(run_values[0]) + run_ends.capacity() * sizeof(size_t);
+		}
+
+	private:
+		std::vector<detail::bool_to_union<U>> run_values;
+		std::vector<size_t> run_ends;
+
+		size_t run_of(size_t index) const {
+			return std::upper_bound(run_ends.begin(), run_ends.end(), index) - run_ends.begin();
+		}
+	};
+};
+
+/**
+ * Select the encoding of a field of `frozen_soa` by name.
+ *
+ * @code
+ * auto frozen = soa.freeze<soa::encode<"status", soa::dictionary_encoding<std::uint8_t>>>();
+ * @endcode
+ */
+template<reflect::fixed_string FieldName, typename Encoding>
+struct encode {
+	using encoding = Encoding;
+
+	template<typename T>
+	static constexpr size_t index = reflect::index_of<FieldName, T>();
+};
+
+template<typename T, typename... Encodings>
+class frozen_soa;
+
+/// Memory of a column of a `soa`, as reported by `soa::memory_usage`
+struct column_memory_usage {
+	std::string_view name;
+	/// Bytes holding the elements of the container
+	size_t used_bytes;
+	/// Bytes allocated for the column capacity
+	size_t allocated_bytes;
+
+	size_t wasted_bytes() const {
+		return allocated_bytes - used_bytes;
+	}
+};
+
+/**
+ * Structure of Arrays (SoA) container for aggregate type T.
+ *
+ * Each field of T is stored in a separate array, allowing for better data locality and cache performance.
+ * It provides an API similar to std::vector, allowing for easy manipulation of the data including usage of STL algorithms.
+ * Individual elements can be accessed and modified through a proxy object that provides access to the underlying fields.
+ *
+ * Memory is obtained from `Allocator`, which is rebound to each field type (or to the block type in `block_storage`).
+ * The `Storage` policy defines how the arrays are allocated:
+ * - `vector_storage` (default): one std::vector for each field.
+ * - `packed_bool_storage`: like `vector_storage`, with `bool` fields packed in bits.
+ * - `block_storage`: all arrays in a single allocation with a shared capacity, so growing allocates only once.
+ * - `tiled_storage<N>`: a single allocation of tiles with N elements, each tile holding a small array per field.
+ * - `chunked_storage<N>`: one vector of chunks with N elements for each field, so growing never moves elements.
+ * - `hot_cold_storage<"field"...>`: listed fields in a single block, other fields in lazily materialized vectors.
+ * - `cow_storage`: like `vector_storage`, with column vectors shared between copies until modified.
+ */
+template<typename T, typename Allocator = std::allocator<T>, typename Storage = vector_storage>
+class soa {
+	template<typename _soa> struct _reference;
+	template<typename _soa> struct _iterator;
+	using _columns = typename Storage::template columns<T, Allocator>;
+
+public:
+	using value_type = T;
+	using size_type = size_t;
+	using difference_type = std::ptrdiff_t;
+	using reference = _reference<soa>;
+	using const_reference = _reference<const soa>;
+	using iterator = _iterator<soa>;
+	using const_iterator = _iterator<const soa>;
+	using allocator_type = Allocator;
+
+	soa() = default;
+	explicit soa(const Allocator& alloc)
+		: columns(alloc)
+	{
+	}
+	explicit soa(size_t count, const Allocator& alloc = Allocator())
+		: columns(alloc)
+	{
+		columns.assign(count, T{});
+	}
+	soa(size_t count, const T& value, const Allocator& alloc = Allocator())
+		: columns(alloc)
+	{
+		columns.assign(count, value);
+	}
+	template<std::input_iterator InputIt>
+	soa(InputIt first, InputIt last, const Allocator& alloc = Allocator())
+		: columns(alloc)
+	{
+		insert(end(), first, last);
+	}
+	soa(const soa& other) = default;
+	soa(const soa& other, const Allocator& alloc)
+		: columns(other.columns, alloc)
+	{
+	}
+	soa(soa&& other) = default;
+	soa(soa&& other, const Allocator& alloc)
+		: columns(std::move(other.columns), alloc)
+	{
+	}
+	soa(std::initializer_list<T> ilist, const Allocator& alloc = Allocator())
+		: columns(alloc)
+	{
+		insert(end(), ilist);
+	}
+
+	soa& operator=(const soa& other) = default;
+	soa& operator=(soa&& other) = default;
+	soa& operator=(std::initializer_list<T> ilist) {
+		assign(ilist);
+		return *this;
+	}
+
+	void assign(size_t count, const T& value) {
+		columns.assign(count, value);
+	}
+	template<std::input_iterator InputIt>
+	void assign(InputIt first, InputIt last) {
+		clear();
+		insert(end(), first, last);
+	}
+	void assign(std::initializer_list<T> ilist) {
+		clear();
+		insert(end(), ilist);
+	}
+#ifdef SOA_EXECUTION_POLICIES
+	/**
+	 * Overloads taking an execution policy process the columns concurrently, as allowed by `policy`.
+	 * As with standard parallel algorithms, `std::terminate` is called if an element operation throws.
+	 *
+	 * @code
+	 * soa.assign(std::execution::par, count, value);
+	 * @endcode
+	 */
+	template<detail::execution_policy ExecutionPolicy>
+	void assign(ExecutionPolicy&& policy, size_t count, const T& value) {
+		columns.assign(policy, count, value);
+	}
+#endif
+
+	allocator_type get_allocator() const {
+		return columns.get_allocator();
+	}
+
+	// Element access
+	reference at(size_t index) {
+		if (index >= size()) {
+			throw std::out_of_range("Index out of range");
+		}
+		return reference(this, index);
+	}
+	const_reference at(size_t index) const {
+		if (index >= size()) {
+			throw std::out_of_range("Index out of range");
+		}
+		return const_reference(this, index);
+	}
+
+	reference operator[](size_t index) {
+		return reference(this, index);
+	}
+	const_reference operator[](size_t index) const {
+		return const_reference(this, index);
+	}
+
+	template<size_t I>
+	auto field() {
+		return columns.template column<I>();
+	}
+	template<size_t I>
+	auto field() const {
+		return columns.template column<I>();
+	}
+
+	template<reflect::fixed_string FieldName>
+	auto field() {
+		constexpr size_t I = reflect::index_of<FieldName, T>();
+		return field<I>();
+	}
+	template<reflect::fixed_string FieldName>
+	auto field() const {
+		constexpr size_t I = reflect::index_of<FieldName, T>();
+		return field<I>();
+	}
+
+	template<typename U>
+	auto field() {
+		constexpr size_t I = detail::index_of_type<U, T>();
+		return field<I>();
+	}
+	template<typename U>
+	auto field() const {
+		constexpr size_t I = detail::index_of_type<U, T>();
+		return field<I>();
+	}
+
+	/**
+	 * Access a field array as a span carrying the storage alignment, see `aligned_span`.
+	 * Only available with `aligned_block_storage`.
+	 *
+	 * @code
+	 * soa::aligned_span<float, 64> x = soa.aligned_field<"x">();
+	 * @endcode
+	 */
+	template<size_t I>
+	auto aligned_field() requires requires(_columns& c) { c.template aligned_column<I>(); } {
+		return columns.template aligned_column<I>();
+	}
+	template<size_t I>
+	auto aligned_field() const requires requires(const _columns& c) { c.template aligned_column<I>(); } {
+		return columns.template aligned_column<I>();
+	}
+	template<reflect::fixed_string FieldName>
+	auto aligned_field() {
+		constexpr size_t I = reflect::index_of<FieldName, T>();
+		return aligned_field<I>();
+	}
+	template<reflect::fixed_string FieldName>
+	auto aligned_field() const {
+		constexpr size_t I = reflect::index_of<FieldName, T>();
+		return aligned_field<I>();
+	}
+	template<typename U>
+	auto aligned_field() {
+		constexpr size_t I = detail::index_of_type<U, T>();
+		return aligned_field<I>();
+	}
+	template<typename U>
+	auto aligned_field() const {
+		constexpr size_t I = detail::index_of_type<U, T>();
+		return aligned_field<I>();
+	}
+
+	/**
+	 * Non-owning view over the selected fields, see `field_view`.
+	 * Its iterators yield tuples of references to the selected fields only and can be used with ranges algorithms.
+	 * Only available when field arrays are contiguous, that is, not with `tiled_storage` or `chunked_storage` nor for packed `bool` fields.
+	 *
+	 * @code
+	 * for (auto [x, vx] : soa.view<"x", "vx">()) {
+	 *     x += vx;
+	 * }
+	 * @endcode
+	 */
+	template<size_t... I>
+	auto view() requires (detail::contiguous_column<decltype(std::declval<_columns&>().template column<I>())> && ...) {
+		static_assert(sizeof...(I) > 0, "At least one field must be selected");
+		return field_view(size(), field<I>().data()...);
+	}
+	template<size_t... I>
+	auto view() const requires (detail::contiguous_column<decltype(std::declval<const _columns&>().template column<I>())> && ...) {
+		static_assert(sizeof...(I) > 0, "At least one field must be selected");
+		return field_view(size(), field<I>().data()...);
+	}
+	template<reflect::fixed_string... FieldNames>
+	auto view() {
+		return view<reflect::index_of<FieldNames, T>()...>();
+	}
+	template<reflect::fixed_string... FieldNames>
+	auto view() const {
+		return view<reflect::index_of<FieldNames, T>()...>();
+	}
+	template<typename... U>
+	auto view() {
+		return view<detail::index_of_type<U, T>()...>();
+	}
+	template<typename... U>
+	auto view() const {
+		return view<detail::index_of_type<U, T>()...>();
+	}
+
+	reference front() {
+		return reference(this, 0);
+	}
+	const_reference front() const {
+		return const_reference(this, 0);
+	}
+
+	reference back() {
+		return reference(this, size() - 1);
+	}
+	const_reference back() const {
+		return const_reference(this, size() - 1);
+	}
+
+	// Iterators
+	iterator begin() {
+		return iterator(this, 0);
+	}
+	const_iterator begin() const {
+		return const_iterator(this, 0);
+	}
+	const_iterator cbegin() const {
+		return const_iterator(this, 0);
+	}
+
+	iterator end() {
+		return iterator(this, size());
+	}
+	const_iterator end() const {
+		return const_iterator(this, size());
+	}
+	const_iterator cend() const {
+		return const_iterator(this, size());
+	}
+
+	// Capacity
+	bool empty() const {
+		return size() == 0;
+	}
+
+	size_t size() const {
+		return columns.size();
+	}
+
+	size_t max_size() const {
+		return columns.max_size();
+	}
+
+	void reserve(size_t new_cap) {
+		columns.reserve(new_cap);
+	}
+#ifdef SOA_EXECUTION_POLICIES
+	template<detail::execution_policy ExecutionPolicy>
+	void reserve(ExecutionPolicy&& policy, size_t new_cap) {
+		columns.reserve(policy, new_cap);
+	}
+#endif
+
+	size_t capacity() const {
+		return columns.capacity();
+	}
+
+	/**
+	 * Memory allocated for each column, by field name, not counting memory owned by the values (like std::string buffers).
+	 * Columns may have more capacity than the container, like vectors of different types with `vector_storage`.
+	 *
+	 * @code
+	 * for (auto& column : soa.memory_usage()) {
+	 *     std::println("{}: {} bytes, {} wasted", column.name, column.allocated_bytes, column.wasted_bytes());
+	 * }
+	 * @endcode
+	 */
+	std::array<column_memory_usage, reflect::size<T>()> memory_usage() const {
+		std::array<column_memory_usage, reflect::size<T>()> usage;
+		reflect::for_each<T>([&](auto I) {
+			size_t column_capacity = capacity();
+			if constexpr (requires { columns.template column_capacity<I>(); }) {
+				column_capacity = columns.template column_capacity<I>();
+			}
+			usage[I] = { reflect::member_name<I, T>(), column_bytes<I>(size()), column_bytes<I>(column_capacity) };
+		});
+		return usage;
+	}
+
+	void shrink_to_fit() {
+		columns.shrink_to_fit();
+	}
+#ifdef SOA_EXECUTION_POLICIES
+	template<detail::execution_policy ExecutionPolicy>
+	void shrink_to_fit(ExecutionPolicy&& policy) {
+		columns.shrink_to_fit(policy);
+	}
+#endif
+
+	// Modifiers
+	void clear() {
+		columns.clear();
+	}
+#ifdef SOA_EXECUTION_POLICIES
+	template<detail::execution_policy ExecutionPolicy>
+	void clear(ExecutionPolicy&& policy) {
+		columns.clear(policy);
+	}
+#endif
+
+	iterator insert(const_iterator pos, const T& value) {
+		size_t index = pos.index;
+		columns.insert(index, value);
+		return iterator(this, index);
+	}
+	iterator insert(const_iterator pos, T&& value) {
+		size_t index = pos.index;
+		columns.insert(index, std::move(value));
+		return iterator(this, index);
+	}
+	iterator insert(const_iterator pos, size_t count, const T& value) {
+		size_t index = pos.index;
+		columns.insert(index, count, value);
+		return iterator(this, index);
+	}
+	/**
+	 * Insert the elements in range [`first`, `last`) before `pos`.
+	 * Forward ranges are inserted column by column, opening the gap only once in each column.
+	 * Single pass ranges are appended and then rotated into place.
+	 */
+	template<std::input_iterator InputIt>
+	iterator insert(const_iterator pos, InputIt first, InputIt last) {
+		size_t index = pos.index;
+		if constexpr (detail::forward_field_source<InputIt, T>) {
+			columns.insert(index, first, last, std::distance(first, last));
+		}
+		else {
+			size_t old_size = size();
+			for (; first != last; ++first) {
+				push_back(*first);
+			}
+			if (index != old_size) {
+				reflect::for_each<T>([&](auto I) {
+					auto column = field<I>();
+					std::rotate(column.begin() + index, column.begin() + old_size, column.end());
+				});
+			}
+		}
+		return iterator(this, index);
+	}
+	iterator insert(const_iterator pos, std::initializer_list<T> ilist) {
+		return insert(pos, ilist.begin(), ilist.end());
+	}
+
+	/**
+	 * Insert a new element at `pos`, constructing each field from the corresponding argument.
+	 * No temporary T is created, but since arguments may refer to elements that are shifted or reallocated,
+	 * storages may first build the fields in a tuple and then move them into their columns:
+	 * block storages only do so when inserting before the end, other storages always do.
+	 *
+	 * @code
+	 * soa.emplace(soa.begin(), x, y, z);
+	 * @endcode
+	 */
+	template<typename... Args> requires (sizeof...(Args) == reflect::size<T>())
+	iterator emplace(const_iterator pos, Args&&... args) {
+		size_t index = pos.index;
+		columns.emplace(index, std::forward<Args>(args)...);
+		return iterator(this, index);
+	}
+
+	iterator erase(const_iterator pos) {
+		columns.erase(pos.index, pos.index + 1);
+		return iterator(this, pos.index);
+	}
+	iterator erase(const_iterator first, const_iterator last) {
+		columns.erase(first.index, last.index);
+		return iterator(this, first.index);
+	}
+
+	/**
+	 * Erase the element at `pos` in O(1) by moving the last element into its place, field by field, and popping the back.
+	 * The order of elements is not preserved: the returned iterator, at the same position, points to the previously last element.
+	 *
+	 * @code
+	 * auto it = soa.erase_unordered(soa.begin() + i);
+	 * @endcode
+	 */
+	iterator erase_unordered(const_iterator pos) {
+		size_t index = pos.index;
+		size_t last = size() - 1;
+		if (index != last) {
+			reflect::for_each<T>([&](auto I) {
+				if (stores_column<I>()) {
+					auto column = field<I>();
+					column[index] = std::move(column[last]);
+				}
+			});
+		}
+		columns.pop_back();
+		return iterator(this, index);
+	}
+#ifdef SOA_EXECUTION_POLICIES
+	template<detail::execution_policy ExecutionPolicy>
+	iterator erase(ExecutionPolicy&& policy, const_iterator pos) {
+		columns.erase(policy, pos.index, pos.index + 1);
+		return iterator(this, pos.index);
+	}
+	template<detail::execution_policy ExecutionPolicy>
+	iterator erase(ExecutionPolicy&& policy, const_iterator first, const_iterator last) {
+		columns.erase(policy, first.index, last.index);
+		return iterator(this, first.index);
+	}
+#endif
+
+	void push_back(const T& value) {
+		columns.push_back(value);
+	}
+	void push_back(T&& value) {
+		columns.push_back(std::move(value));
+	}
+
+	/**
+	 * Append a new element, constructing each field in place from the corresponding argument.
+	 * No temporary T is created. But arguments may refer to elements that are reallocated, so when a column has to grow
+	 * vector storages first build the fields in a tuple and then move them into their columns, as `hot_cold_storage` always does.
+	 *
+	 * @code
+	 * soa.emplace_back(x, y, z);
+	 * @endcode
+	 */
+	template<typename... Args> requires (sizeof...(Args) == reflect::size<T>())
+	reference emplace_back(Args&&... args) {
+		columns.emplace_back(std::forward<Args>(args)...);
+		return back();
+	}
+
+	void pop_back() {
+		columns.pop_back();
+	}
+
+	void resize(size_t count) {
+		columns.resize(count);
+	}
+	void resize(size_t count, const T& value) {
+		columns.resize(count, value);
+	}
+	/**
+	 * Resize to `count` elements, default-initializing new elements instead of value-initializing them,
+	 * so new trivially default constructible fields are left uninitialized, to be overwritten by a bulk load.
+	 * Only block storages and `chunked_storage` skip initialization: `std::vector` columns are value-initialized.
+	 *
+	 * @code
+	 * soa.resize_for_overwrite(count);
+	 * in.read(reinterpret_cast<char *>(soa.field<"x">().data()), count * sizeof(float));
+	 * @endcode
+	 */
+	void resize_for_overwrite(size_t count) {
+		columns.resize_for_overwrite(count);
+	}
+#ifdef SOA_EXECUTION_POLICIES
+	template<detail::execution_policy ExecutionPolicy>
+	void resize(ExecutionPolicy&& policy, size_t count) {
+		columns.resize(policy, count);
+	}
+	template<detail::execution_policy ExecutionPolicy>
+	void resize(ExecutionPolicy&& policy, size_t count, const T& value) {
+		columns.resize(policy, count, value);
+	}
+#endif
+
+	void swap(soa& other) noexcept {
+		columns.swap(other.columns);
+	}
+
+	// Sorting
+	/**
+	 * Sort elements by the I-th field, comparing only the values in that column.
+	 * The sorting permutation is computed from the key column alone and then applied to each column in a single pass,
+	 * so no values of type T are constructed.
+	 * Like `std::sort`, the order of equal elements is not preserved.
+	 *
+	 * @code
+	 * soa.sort_by<"x">();
+	 * soa.sort_by<"x">(std::greater<>());
+	 * @endcode
+	 */
+	template<size_t I, typename Compare = std::less<>> requires (!detail::execution_policy<Compare>)
+	void sort_by(Compare comp = {}) {
+		apply_permutation(sorted_permutation<I>(comp, [](auto first, auto last, auto comp) {
+			std::sort(first, last, comp);
+		}));
+	}
+	template<reflect::fixed_string FieldName, typename Compare = std::less<>> requires (!detail::execution_policy<Compare>)
+	void sort_by(Compare comp = {}) {
+		constexpr size_t I = reflect::index_of<FieldName, T>();
+		sort_by<I>(comp);
+	}
+	template<typename U, typename Compare = std::less<>> requires (!detail::execution_policy<Compare>)
+	void sort_by(Compare comp = {}) {
+		constexpr size_t I = detail::index_of_type<U, T>();
+		sort_by<I>(comp);
+	}
+
+#ifdef SOA_EXECUTION_POLICIES
+	/**
+	 * Same as `sort_by`, but sorting the key column and applying the permutation to the columns concurrently, as allowed by `policy`.
+	 *
+	 * @code
+	 * soa.sort_by<"x">(std::execution::par);
+	 * @endcode
+	 */
+	template<size_t I, detail::execution_policy ExecutionPolicy, typename Compare = std::less<>>
+	void sort_by(ExecutionPolicy&& policy, Compare comp = {}) {
+		apply_permutation(policy, sorted_permutation<I>(comp, [&](auto first, auto last, auto comp) {
+			std::sort(policy, first, last, comp);
+		}));
+	}
+	template<reflect::fixed_string FieldName, detail::execution_policy ExecutionPolicy, typename Compare = std::less<>>
+	void sort_by(ExecutionPolicy&& policy, Compare comp = {}) {
+		constexpr size_t I = reflect::index_of<FieldName, T>();
+		sort_by<I>(policy, comp);
+	}
+	template<typename U, detail::execution_policy ExecutionPolicy, typename Compare = std::less<>>
+	void sort_by(ExecutionPolicy&& policy, Compare comp = {}) {
+		constexpr size_t I = detail::index_of_type<U, T>();
+		sort_by<I>(policy, comp);
+	}
+#endif
+
+	/**
+	 * Same as `sort_by`, but the order of equal elements is preserved, like `std::stable_sort`.
+	 */
+	template<size_t I, typename Compare = std::less<>> requires (!detail::execution_policy<Compare>)
+	void stable_sort_by(Compare comp = {}) {
+		apply_permutation(sorted_permutation<I>(comp, [](auto first, auto last, auto comp) {
+			std::stable_sort(first, last, comp);
+		}));
+	}
+	template<reflect::fixed_string FieldName, typename Compare = std::less<>> requires (!detail::execution_policy<Compare>)
+	void stable_sort_by(Compare comp = {}) {
+		constexpr size_t I = reflect::index_of<FieldName, T>();
+		stable_sort_by<I>(comp);
+	}
+	template<typename U, typename Compare = std::less<>> requires (!detail::execution_policy<Compare>)
+	void stable_sort_by(Compare comp = {}) {
+		constexpr size_t I = detail::index_of_type<U, T>();
+		stable_sort_by<I>(comp);
+	}
+#ifdef SOA_EXECUTION_POLICIES
+	template<size_t I, detail::execution_policy ExecutionPolicy, typename Compare = std::less<>>
+	void stable_sort_by(ExecutionPolicy&& policy, Compare comp = {}) {
+		apply_permutation(policy, sorted_permutation<I>(comp, [&](auto first, auto last, auto comp) {
+			std::stable_sort(policy, first, last, comp);
+		}));
+	}
+	template<reflect::fixed_string FieldName, detail::execution_policy ExecutionPolicy, typename Compare = std::less<>>
+	void stable_sort_by(ExecutionPolicy&& policy, Compare comp = {}) {
+		constexpr size_t I = reflect::index_of<FieldName, T>();
+		stable_sort_by<I>(policy, comp);
+	}
+	template<typename U, detail::execution_policy ExecutionPolicy, typename Compare = std::less<>>
+	void stable_sort_by(ExecutionPolicy&& policy, Compare comp = {}) {
+		constexpr size_t I = detail::index_of_type<U, T>();
+		stable_sort_by<I>(policy, comp);
+	}
+#endif
+
+	// Column kernels
+	/**
+	 * Call `fn` with the selected fields of each element, in a tight indexed loop over their field arrays.
+	 * No proxy objects are involved and field arrays are known not to alias, so compilers can vectorize the loop.
+	 * Fields are passed as references to `fn`, which may modify them.
+	 *
+	 * @code
+	 * soa.transform<"x", "vx">([](float& x, float vx) { x += vx; });
+	 * @endcode
+	 */
+	template<size_t... I, typename Fn>
+	void transform(Fn&& fn) {
+		static_assert(sizeof...(I) > 0 && detail::distinct_indices<I...>(), "Fields must be selected exactly once");
+		detail::for_each_contiguous([&](size_t count, auto *... columns) {
+			detail::for_each_index(count, fn, columns...);
+		}, field<I>()...);
+	}
+	template<size_t... I, typename Fn>
+	void transform(Fn&& fn) const {
+		static_assert(sizeof...(I) > 0 && detail::distinct_indices<I...>(), "Fields must be selected exactly once");
+		detail::for_each_contiguous([&](size_t count, auto *... columns) {
+			detail::for_each_index(count, fn, columns...);
+		}, field<I>()...);
+	}
+	template<reflect::fixed_string... FieldNames, typename Fn>
+	void transform(Fn&& fn) {
+		transform<reflect::index_of<FieldNames, T>()...>(fn);
+	}
+	template<reflect::fixed_string... FieldNames, typename Fn>
+	void transform(Fn&& fn) const {
+		transform<reflect::index_of<FieldNames, T>()...>(fn);
+	}
+	template<typename... U, typename Fn>
+	void transform(Fn&& fn) {
+		transform<detail::index_of_type<U, T>()...>(fn);
+	}
+	template<typename... U, typename Fn>
+	void transform(Fn&& fn) const {
+		transform<detail::index_of_type<U, T>()...>(fn);
+	}
+
+	/**
+	 * Reduce a field array with `op`, like `std::reduce`.
+	 * Elements may be combined in any order, so `op` must be associative and commutative.
+	 *
+	 * @code
+	 * float total_mass = soa.reduce<"mass">(0.0f);
+	 * @endcode
+	 */
+	template<size_t I, typename Init, typename BinaryOp = std::plus<>>
+	Init reduce(Init init, BinaryOp op = {}) const {
+		auto column = field<I>();
+		return std::reduce(column.begin(), column.end(), std::move(init), op);
+	}
+	template<reflect::fixed_string FieldName, typename Init, typename BinaryOp = std::plus<>>
+	Init reduce(Init init, BinaryOp op = {}) const {
+		constexpr size_t I = reflect::index_of<FieldName, T>();
+		return reduce<I>(std::move(init), op);
+	}
+	template<typename U, typename Init, typename BinaryOp = std::plus<>>
+	Init reduce(Init init, BinaryOp op = {}) const {
+		constexpr size_t I = detail::index_of_type<U, T>();
+		return reduce<I>(std::move(init), op);
+	}
+
+	/**
+	 * Accumulate `reduce_op(acc, transform_op(fields...))` over the selected fields of each element, in order.
+	 * Like `transform`, the loop runs directly over the field arrays.
+	 *
+	 * @code
+	 * float kinetic_energy = soa.transform_reduce<"mass", "v">(0.0f, std::plus<>(), [](float mass, float v) {
+	 *     return 0.5f * mass * v * v;
+	 * });
+	 * @endcode
+	 */
+	template<size_t... I, typename Init, typename Reduce, typename Transform>
+	Init transform_reduce(Init init, Reduce reduce_op, Transform transform_op) const {
+		static_assert(sizeof...(I) > 0, "At least one field must be selected");
+		detail::for_each_contiguous([&](size_t count, auto *... columns) {
+			init = detail::transform_reduce_index(count, std::move(init), reduce_op, transform_op, columns...);
+		}, field<I>()...);
+		return init;
+	}
+	template<reflect::fixed_string... FieldNames, typename Init, typename Reduce, typename Transform>
+	Init transform_reduce(Init init, Reduce reduce_op, Transform transform_op) const {
+		return transform_reduce<reflect::index_of<FieldNames, T>()...>(std::move(init), reduce_op, transform_op);
+	}
+	template<typename... U, typename Init, typename Reduce, typename Transform>
+	Init transform_reduce(Init init, Reduce reduce_op, Transform transform_op) const {
+		return transform_reduce<detail::index_of_type<U, T>()...>(std::move(init), reduce_op, transform_op);
+	}
+
+	/**
+	 * Call `fn(std::span<F>...)` with the selected fields of each contiguous chunk of elements, in order.
+	 * With contiguous columns there is a single chunk, while `tiled_storage` and `chunked_storage` have one per tile or chunk.
+	 * Not available for packed `bool` fields.
+	 *
+	 * @code
+	 * soa.for_each_chunk<"x", "vx">([](std::span<float> x, std::span<const float> vx) { ... });
+	 * @endcode
+	 */
+	template<size_t... I, typename Fn>
+	void for_each_chunk(Fn&& fn) {
+		static_assert(sizeof...(I) > 0, "At least one field must be selected");
+		detail::for_each_contiguous([&](size_t count, auto *... columns) {
+			fn(std::span(columns, count)...);
+		}, field<I>()...);
+	}
+	template<size_t... I, typename Fn>
+	void for_each_chunk(Fn&& fn) const {
+		static_assert(sizeof...(I) > 0, "At least one field must be selected");
+		detail::for_each_contiguous([&](size_t count, auto *... columns) {
+			fn(std::span(columns, count)...);
+		}, field<I>()...);
+	}
+	template<reflect::fixed_string... FieldNames, typename Fn>
+	void for_each_chunk(Fn&& fn) {
+		for_each_chunk<reflect::index_of<FieldNames, T>()...>(fn);
+	}
+	template<reflect::fixed_string... FieldNames, typename Fn>
+	void for_each_chunk(Fn&& fn) const {
+		for_each_chunk<reflect::index_of<FieldNames, T>()...>(fn);
+	}
+	template<typename... U, typename Fn>
+	void for_each_chunk(Fn&& fn) {
+		for_each_chunk<detail::index_of_type<U, T>()...>(fn);
+	}
+	template<typename... U, typename Fn>
+	void for_each_chunk(Fn&& fn) const {
+		for_each_chunk<detail::index_of_type<U, T>()...>(fn);
+	}
+
+#ifdef SOA_EXECUTION_POLICIES
+	/**
+	 * Call `fn(std::span<F>...)` with the selected fields of chunks of elements, as tasks scheduled by `policy`.
+	 * Chunks hold about `chunk_size` elements, or fit in an L1 data cache by default,
+	 * rounded to a multiple of 64 elements and of the tile size so that tasks don't share cache lines.
+	 * As with standard parallel algorithms, `std::terminate` is called if `fn` throws.
+	 * Not available for packed `bool` fields.
+	 *
+	 * @code
+	 * soa.parallel_for<"x", "vx">(std::execution::par, [](std::span<float> x, std::span<const float> vx) { ... });
+	 * @endcode
+	 */
+	template<size_t... I, detail::execution_policy ExecutionPolicy, typename Fn>
+	void parallel_for(ExecutionPolicy&& policy, Fn&& fn, size_t chunk_size = 0) {
+		static_assert(sizeof...(I) > 0 && detail::distinct_indices<I...>(), "Fields must be selected exactly once");
+		detail::parallel_for_chunks(policy, fn, chunk_size, field<I>()...);
+	}
+	template<size_t... I, detail::execution_policy ExecutionPolicy, typename Fn>
+	void parallel_for(ExecutionPolicy&& policy, Fn&& fn, size_t chunk_size = 0) const {
+		static_assert(sizeof...(I) > 0 && detail::distinct_indices<I...>(), "Fields must be selected exactly once");
+		detail::parallel_for_chunks(policy, fn, chunk_size, field<I>()...);
+	}
+	template<reflect::fixed_string... FieldNames, detail::execution_policy ExecutionPolicy, typename Fn>
+	void parallel_for(ExecutionPolicy&& policy, Fn&& fn, size_t chunk_size = 0) {
+		parallel_for<reflect::index_of<FieldNames, T>()...>(policy, fn, chunk_size);
+	}
+	template<reflect::fixed_string... FieldNames, detail::execution_policy ExecutionPolicy, typename Fn>
+	void parallel_for(ExecutionPolicy&& policy, Fn&& fn, size_t chunk_size = 0) const {
+		parallel_for<reflect::index_of<FieldNames, T>()...>(policy, fn, chunk_size);
+	}
+	template<typename... U, detail::execution_policy ExecutionPolicy, typename Fn>
+	void parallel_for(ExecutionPolicy&& policy, Fn&& fn, size_t chunk_size = 0) {
+		parallel_for<detail::index_of_type<U, T>()...>(policy, fn, chunk_size);
+	}
+	template<typename... U, detail::execution_policy ExecutionPolicy, typename Fn>
+	void parallel_for(ExecutionPolicy&& policy, Fn&& fn, size_t chunk_size = 0) const {
+		parallel_for<detail::index_of_type<U, T>()...>(policy, fn, chunk_size);
+	}
+#endif
+
+	/**
+	 * Find the first element whose I-th field equals `key`, scanning that column only, or return `end()`.
+	 *
+	 * @code
+	 * auto it = soa.find_by<"id">(42);
+	 * @endcode
+	 */
+	template<size_t I, typename Key>
+	iterator find_by(const Key& key) {
+		auto column = field<I>();
+		return begin() + (std::find(column.begin(), column.end(), key) - column.begin());
+	}
+	template<size_t I, typename Key>
+	const_iterator find_by(const Key& key) const {
+		auto column = field<I>();
+		return begin() + (std::find(column.begin(), column.end(), key) - column.begin());
+	}
+	template<reflect::fixed_string FieldName, typename Key>
+	iterator find_by(const Key& key) {
+		return find_by<reflect::index_of<FieldName, T>()>(key);
+	}
+	template<reflect::fixed_string FieldName, typename Key>
+	const_iterator find_by(const Key& key) const {
+		return find_by<reflect::index_of<FieldName, T>()>(key);
+	}
+	template<typename U, typename Key>
+	iterator find_by(const Key& key) {
+		return find_by<detail::index_of_type<U, T>()>(key);
+	}
+	template<typename U, typename Key>
+	const_iterator find_by(const Key& key) const {
+		return find_by<detail::index_of_type<U, T>()>(key);
+	}
+
+	/**
+	 * Erase all elements for which `pred` returns true, and return how many were erased.
+	 * `pred` is called with the selected fields of each element only, in a tight loop like `transform`, to build a mask.
+	 * Then each column is compacted in a single pass, keeping the order of the remaining elements.
+	 *
+	 * @code
+	 * soa.erase_if<"alive">([](bool alive) { return !alive; });
+	 * @endcode
+	 */
+	template<size_t... I, typename Predicate>
+	size_t erase_if(Predicate&& pred) {
+		std::vector<unsigned char> keep = keep_mask<I...>(pred);
+		size_t first = std::find(keep.begin(), keep.end(), 0) - keep.begin();
+		if (first == keep.size()) {
+			return 0;
+		}
+		size_t kept = first + std::count(keep.begin() + first, keep.end(), 1);
+		reflect::for_each<T>([&](auto J) {
+			compact_column<J>(keep, first);
+		});
+		size_t count = size();
+		columns.erase(kept, count);
+		return count - kept;
+	}
+	template<reflect::fixed_string... FieldNames, typename Predicate>
+	size_t erase_if(Predicate&& pred) {
+		return erase_if<reflect::index_of<FieldNames, T>()...>(pred);
+	}
+	template<typename... U, typename Predicate>
+	size_t erase_if(Predicate&& pred) {
+		return erase_if<detail::index_of_type<U, T>()...>(pred);
+	}
+#ifdef SOA_EXECUTION_POLICIES
+	/// Same as `erase_if`, but compacting columns concurrently, as allowed by `policy`
+	template<size_t... I, detail::execution_policy ExecutionPolicy, typename Predicate>
+	size_t erase_if(ExecutionPolicy&& policy, Predicate&& pred) {
+		std::vector<unsigned char> keep = keep_mask<I...>(pred);
+		size_t first = std::find(keep.begin(), keep.end(), 0) - keep.begin();
+		if (first == keep.size()) {
+			return 0;
+		}
+		size_t kept = first + std::count(keep.begin() + first, keep.end(), 1);
+		detail::for_each_field<T>(policy, [&](auto J) {
+			compact_column<J>(keep, first);
+		});
+		size_t count = size();
+		columns.erase(policy, kept, count);
+		return count - kept;
+	}
+	template<reflect::fixed_string... FieldNames, detail::execution_policy ExecutionPolicy, typename Predicate>
+	size_t erase_if(ExecutionPolicy&& policy, Predicate&& pred) {
+		return erase_if<reflect::index_of<FieldNames, T>()...>(policy, pred);
+	}
+	template<typename... U, detail::execution_policy ExecutionPolicy, typename Predicate>
+	size_t erase_if(ExecutionPolicy&& policy, Predicate&& pred) {
+		return erase_if<detail::index_of_type<U, T>()...>(policy, pred);
+	}
+#endif
+
+	/**
+	 * Encode the fields into a read-only `frozen_soa`, see the encodings for their requirements.
+	 * Fields not listed in `encode<"field", Encoding>` arguments are copied as is.
+	 *
+	 * @code
+	 * auto frozen = soa.freeze<soa::encode<"id", soa::frame_of_reference_encoding<>>, soa::encode<"kind", soa::run_length_encoding>>();
+	 * @endcode
+	 */
+	template<typename... Encodings>
+	frozen_soa<T, Encodings...> freeze() const {
+		return frozen_soa<T, Encodings...>(*this);
+	}
+
+	/**
+	 * Copy of the container, to be read while this one keeps changing, for example by another thread.
+	 * With `cow_storage`, the snapshot shares all columns and costs O(fields),
+	 * and this container only clones the columns it then modifies. Other storages copy every element.
+	 *
+	 * @code
+	 * soa::soa<Particle, std::allocator<Particle>, soa::cow_storage> particles;
+	 * auto snapshot = particles.snapshot();
+	 * std::thread reporter([snapshot = std::move(snapshot)] { report(snapshot); });
+	 * particles.field<"x">()[0] += 1.0f; // clones the "x" column only
+	 * @endcode
+	 */
+	soa snapshot() const {
+		return *this;
+	}
+
+private:
+	_columns columns;
+
+	/// Bytes taken by `count` elements of the I-th column, packed bits for `bit_span` columns
+	template<size_t I>
+	static size_t column_bytes(size_t count) {
+		if constexpr (std::is_same_v<decltype(std::declval<const _columns&>().template column<I>()), bit_span<const bool>>) {
+			return (count + 7) / 8;
+		}
+		else {
+			return count * sizeof(detail::field_type<I, T>);
+		}
+	}
+
+	/// Mask with 1 for the elements for which `pred(fields...)` returns false
+	template<size_t... I, typename Predicate>
+	std::vector<unsigned char> keep_mask(Predicate& pred) const {
+		static_assert(sizeof...(I) > 0 && detail::distinct_indices<I...>(), "Fields must be selected exactly once");
+		std::vector<unsigned char> keep(size());
+		if constexpr ((... && (detail::contiguous_column<decltype(field<I>())> || detail::tiled_column<decltype(field<I>())>))) {
+			size_t offset = 0;
+			auto test = [&](unsigned char& kept, const auto&... values) {
+				kept = !pred(values...);
+			};
+			detail::for_each_contiguous([&](size_t count, auto *... columns) {
+				detail::for_each_index(count, test, keep.data() + offset, columns...);
+				offset += count;
+			}, field<I>()...);
+		}
+		else {
+			// Bit columns have no array to vectorize over
+			[&](const auto&... columns) {
+				for (size_t index = 0; index < keep.size(); index++) {
+					keep[index] = !pred(columns[index]...);
+				}
+			}(field<I>()...);
+		}
+		return keep;
+	}
+
+	/**
+	 * Whether the I-th column stores any element.
+	 * Columns of `hot_cold_storage` that were never accessed store none, their elements being value-initialized,
+	 * so operations that move elements within columns skip them instead of materializing them.
+	 */
+	template<size_t I>
+	bool stores_column() const {
+		if constexpr (requires { columns.template stored_size<I>(); }) {
+			return columns.template stored_size<I>() > 0;
+		}
+		else {
+			return true;
+		}
+	}
+
+	/// Move the I-th field of kept elements after `first`, the first erased element, to the front of the column
+	template<size_t I>
+	void compact_column(const std::vector<unsigned char>& keep, size_t first) {
+		if (!stores_column<I>()) {
+			return;
+		}
+		auto column = field<I>();
+		size_t kept = first;
+		for (size_t index = first + 1; index < keep.size(); index++) {
+			if (keep[index]) {
+				column[kept++] = std::move(column[index]);
+			}
+		}
+	}
+
+	/// Indices of the elements sorted by the I-th field, using `sort(first, last, comp)` on the indices
+	template<size_t I, typename Compare, typename Sort>
+	std::vector<size_t> sorted_permutation(Compare& comp, Sort&& sort) const {
+		auto keys = field<I>();
+		std::vector<size_t> permutation(keys.size());
+		std::iota(permutation.begin(), permutation.end(), size_t(0));
+		sort(permutation.begin(), permutation.end(), [&](size_t a, size_t b) {
+			return comp(keys[a], keys[b]);
+		});
+		return permutation;
+	}
+
+	/// Reorder elements so that the i-th element becomes the element previously at `permutation[i]`, one column at a time
+	void apply_permutation(const std::vector<size_t>& permutation) {
+		reflect::for_each<T>([&](auto I) {
+			if (!stores_column<I>()) {
+				return;
+			}
+			auto column = field<I>();
+			using column_type = detail::bool_to_union<typename decltype(column)::value_type>;
+			std::vector<column_type> permuted;
+			permuted.reserve(permutation.size());
+			for (size_t index : permutation) {
+				permuted.emplace_back(std::move(column[index]));
+			}
+			std::move(permuted.begin(), permuted.end(), column.begin());
+		});
+	}
+#ifdef SOA_EXECUTION_POLICIES
+	template<typename ExecutionPolicy>
+	void apply_permutation(ExecutionPolicy&& policy, const std::vector<size_t>& permutation) {
+		detail::for_each_field<T>(policy, [&](auto I) {
+			if (!stores_column<I>()) {
+				return;
+			}
+			auto column = field<I>();
+			using column_type = detail::bool_to_union<typename decltype(column)::value_type>;
+			if constexpr (std::is_default_constructible_v<column_type>) {
+				// Gather in chunks too
+				std::vector<column_type> permuted(permutation.size());
+				std::transform(policy, permutation.begin(), permutation.end(), permuted.begin(), [&](size_t index) {
+					return column_type(std::move(column[index]));
+				});
+				if constexpr (std::is_reference_v<decltype(column[0])>) {
+					std::move(policy, permuted.begin(), permuted.end(), column.begin());
+				}
+				else {
+					// Packed bits share words, so they can't be written concurrently
+					std::move(permuted.begin(), permuted.end(), column.begin());
+				}
+			}
+			else {
+				std::vector<column_type> permuted;
+				permuted.reserve(permutation.size());
+				for (size_t index : permutation) {
+					permuted.emplace_back(std::move(column[index]));
+				}
+				std::move(permuted.begin(), permuted.end(), column.begin());
+			}
+		});
+	}
+#endif
+
+	// Tuple of references to the fields, holding proxies like bit_reference by value
+	auto fields(size_t index) {
+		return [&]<auto... Ns>(std::index_sequence<Ns...>) {
+			return std::tuple<decltype(field<Ns>()[index])...>(field<Ns>()[index]...);
+		}(std::make_index_sequence<reflect::size<std::remove_cvref_t<T>>()>{});
+	}
+	auto fields(size_t index) const {
+		return [&]<auto... Ns>(std::index_sequence<Ns...>) {
+			return std::tuple<decltype(field<Ns>()[index])...>(field<Ns>()[index]...);
+		}(std::make_index_sequence<reflect::size<std::remove_cvref_t<T>>()>{});
+	}
+
+	/**
+	 * Reference to an element of the SoA.
+	 * Accessing `field` return a reference to the original field in the SoA, so it can be modified directly.
+	 * Accessing `value` or `operator*` constructs a new value from all fields that are stored separately in the parent SoA.
+	 * It is possible to assign a new value to all underlying fields of the parent SoA at once using `soa[i] = value`.
+	 */
+	template<typename _soa>
+	struct _reference {
+		using value_type = T;
+
+		_reference(_soa *parent, size_t index) : parent(parent), index(index) {}
+		_reference(const _reference& other) = default;
+
+		/**
+		 * Access the underlying field of the element of the SoA by index.
+		 *
+		 * @code
+		 * auto x = soa[i].field<0>();
+		 * soa[i].field<0>() = x;
+		 * @endcode
+		 */
+		template<size_t I>
+		decltype(auto) field() {
+			return parent->template field<I>()[index];
+		}
+		template<size_t I>
+		decltype(auto) field() const {
+			return parent->template field<I>()[index];
+		}
+
+		/**
+		 * Access the underlying field of the element of the SoA by name.
+		 *
+		 * @code
+		 * auto x = soa[i].field<"x">();
+		 * soa[i].field<"x">() = x;
+		 * @endcode
+		 */
+		template<reflect::fixed_string FieldName>
+		decltype(auto) field() {
+			return parent->template field<FieldName>()[index];
+		}
+		template<reflect::fixed_string FieldName>
+		decltype(auto) field() const {
+			return parent->template field<FieldName>()[index];
+		}
+
+		/**
+		 * Access the underlying field of the element of the SoA by type.
+		 * Only works if the type is unique within the aggregate type T.
+		 *
+		 * @code
+		 * auto x = soa[i].field<int>();
+		 * soa[i].field<int>() = x;
+		 * @endcode
+		 */
+		template<typename U>
+		decltype(auto) field() {
+			return parent->template field<U>()[index];
+		}
+		template<typename U>
+		decltype(auto) field() const {
+			return parent->template field<U>()[index];
+		}
+
+		/**
+		 * Access all underlying fields of the element of the SoA as a tuple.
+		 *
+		 * @code
+		 * auto [x, y, z] = soa[i].fields();
+		 * std::tie(x, y, z) = soa[i].fields();
+		 * @endcode
+		 */
+		auto fields() {
+			return parent->fields(index);
+		}
+		auto fields() const {
+			return parent->fields(index);
+		}
+
+		/**
+		 * Construct a new value from all fields of the element of the SoA.
+		 */
+		T value() const {
+			T v = std::make_from_tuple<T>(fields());
+			return v;
+		}
+
+		bool operator==(const _reference& other) const {
+			if (parent == other.parent && index == other.index) {
+				// Fast path: same reference to the same index in the same parent SoA
+				return true;
+			}
+			else {
+				// Slow path: compare field by field
+				return equal_fields([&](auto I) -> decltype(auto) { return other.template field<I>(); });
+			}
+		}
+		/// Compare field by field, in order and without constructing a value, like a defaulted `operator==` of T
+		bool operator==(const T& other) const {
+			return equal_fields([&](auto I) -> decltype(auto) { return reflect::get<I>(other); });
+		}
+		bool operator!=(const _reference& other) const {
+			return !operator==(other);
+		}
+		bool operator!=(const T& other) const {
+			return !operator==(other);
+		}
+
+		/**
+		 * Compare field by field lexicographically, in order and without constructing a value, like a defaulted `operator<=>` of T.
+		 * The ordering type is deduced, so that references to fields without `<=>` can still be instantiated.
+		 */
+		auto operator<=>(const _reference& other) const requires detail::fields_three_way_comparable<T> {
+			return compare_fields([&](auto I) -> decltype(auto) { return other.template field<I>(); });
+		}
+		auto operator<=>(const T& other) const requires detail::fields_three_way_comparable<T> {
+			return compare_fields([&](auto I) -> decltype(auto) { return reflect::get<I>(other); });
+		}
+
+		/**
+		 * Assign `value`'s fields to an element of the SoA.
+		 *
+		 * @code
+		 * soa[i] = T{ ... };
+		 * @endcode
+		 */
+		_reference& operator=(const T& value) {
+			assign(value);
+			return *this;
+		}
+		_reference& operator=(T&& value) {
+			assign(std::move(value));
+			return *this;
+		}
+		const _reference& operator=(const T& value) const {
+			assign(value);
+			return *this;
+		}
+		const _reference& operator=(T&& value) const {
+			assign(std::move(value));
+			return *this;
+		}
+
+		/**
+		 * Assign `value`'s fields to an element of the SoA.
+		 *
+		 * @code
+		 * soa[i] = soa[j];
+		 * @endcode
+		 */
+		_reference& operator=(const _reference& value) {
+			assign(value);
+			return *this;
+		}
+		const _reference& operator=(const _reference& value) const {
+			assign(value);
+			return *this;
+		}
+
+		/**
+		 * Alias for `value`.
+		 */
+		T operator*() const {
+			return value();
+		}
+
+		/**
+		 * Alias for `value`.
+		 */
+		operator T() const {
+			return value();
+		}
+
+		/**
+		 * Swap field values of two wrappers.
+		 *
+		 * @code
+		 * soa[i].swap(soa[j]);
+		 * @endcode
+		 */
+		void swap(_reference other) const {
+			[&]<auto... Ns>(std::index_sequence<Ns...>) {
+				using std::swap;
+				(swap(field<Ns>(), other.field<Ns>()), ...);
+			}(std::make_index_sequence<reflect::size<T>()>{});
+		}
+
+	private:
+		_soa *parent;
+		size_t index;
+
+		/// Whether each field equals `get(I)`, stopping at the first difference
+		template<typename Get>
+		bool equal_fields(Get&& get) const {
+			return [&]<size_t... Ns>(std::index_sequence<Ns...>) {
+				// Binding to the field type converts proxies like `bit_reference`, while other fields are not copied
+				return (... && (static_cast<const detail::field_type<Ns, T>&>(field<Ns>()) == static_cast<const detail::field_type<Ns, T>&>(get(std::integral_constant<size_t, Ns>()))));
+			}(std::make_index_sequence<reflect::size<T>()>{});
+		}
+
+		/// Compare each field with `get(I)` until the first one that is not equivalent
+		template<typename Get>
+		auto compare_fields(Get&& get) const {
+			detail::fields_ordering<T> result = detail::fields_ordering<T>::equivalent;
+			[&]<size_t... Ns>(std::index_sequence<Ns...>) {
+				(... && ((result = std::compare_three_way()(static_cast<const detail::field_type<Ns, T>&>(field<Ns>()), static_cast<const detail::field_type<Ns, T>&>(get(std::integral_constant<size_t, Ns>())))) == 0));
+			}(std::make_index_sequence<reflect::size<T>()>{});
+			return result;
+		}
+
+		template<typename U>
+		void assign(U&& value) const {
+			reflect::for_each<T>([&](auto I) {
+				if constexpr (detail::field_proxy<U>) {
+					field<I>() = value.template field<I>();
+				}
+				else {
+					field<I>() = detail::forward_field<I>(std::forward<U>(value));
+				}
+			});
+		}
+	};
+
+	/**
+	 * Swap field values of two wrappers.
+	 *
+	 * @code
+	 * swap(soa[i], soa[j]);
+	 * @endcode
+	 */
+	template<typename _soa>
+	friend void swap(_reference<_soa> a, _reference<_soa> b) {
+		a.swap(b);
+	}
+
+	/**
+	 * Random access iterator over the elements of the SoA.
+	 * Dereferencing returns a proxy `_reference` to the element.
+	 * `iter_move` moves the fields out of the element and `iter_swap` swaps each field in place,
+	 * so that ranges algorithms never copy whole elements.
+	 */
+	template<typename _soa>
+	struct _iterator {
+		using _const_soa = const std::remove_const_t<_soa>;
+
+		using iterator_concept = std::random_access_iterator_tag;
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using reference = _reference<_soa>;
+		using pointer = void;
+
+		_iterator() = default;
+		_iterator(_soa *parent, size_t index) : parent(parent), index(index) {}
+
+		_iterator& operator++() {
+			++index;
+			return *this;
+		}
+		_iterator operator++(int) {
+			_iterator previous = *this;
+			++index;
+			return previous;
+		}
+
+		_iterator& operator+=(difference_type n) {
+			index += n;
+			return *this;
+		}
+
+		_iterator& operator--() {
+			--index;
+			return *this;
+		}
+		_iterator operator--(int) {
+			_iterator previous = *this;
+			--index;
+			return previous;
+		}
+
+		_iterator& operator-=(difference_type n) {
+			index -= n;
+			return *this;
+		}
+
+		_iterator operator+(difference_type n) const {
+			return _iterator(parent, index + n);
+		}
+		friend _iterator operator+(difference_type n, const _iterator& it) {
+			return it + n;
+		}
+		size_t operator+(const _iterator& other) const {
+			return index + other.index;
+		}
+
+		_iterator operator-(difference_type n) const {
+			return _iterator(parent, index - n);
+		}
+		difference_type operator-(const _iterator& other) const {
+			return difference_type(index) - difference_type(other.index);
+		}
+
+		bool operator==(const _iterator& other) const {
+			return parent == other.parent
+				&& index == other.index;
+		}
+		bool operator!=(const _iterator& other) const {
+			return !operator==(other);
+		}
+		std::strong_ordering operator<=>(const _iterator& other) const {
+			return index <=> other.index;
+		}
+
+		reference operator*() const {
+			return reference(parent, index);
+		}
+		reference operator[](difference_type n) const {
+			return reference(parent, index + n);
+		}
+
+		operator _iterator<_const_soa>() const {
+			return _iterator<_const_soa>(parent, index);
+		}
+
+		/**
+		 * Construct a value by moving all fields out of the pointed element.
+		 * Used by ranges algorithms, like `std::ranges::sort`.
+		 */
+		friend T iter_move(const _iterator& it) {
+			return [&]<auto... Ns>(std::index_sequence<Ns...>) {
+				return T(std::move((*it).template field<Ns>())...);
+			}(std::make_index_sequence<reflect::size<T>()>{});
+		}
+
+		/**
+		 * Swap the pointed elements field by field, without constructing temporary values.
+		 * Used by ranges algorithms, like `std::ranges::sort`.
+		 */
+		friend void iter_swap(const _iterator& a, const _iterator& b) requires (!std::is_const_v<_soa>) {
+			(*a).swap(*b);
+		}
+
+	private:
+		friend class soa;
+		_soa *parent = nullptr;
+		size_t index = 0;
+	};
+};
+
+/**
+ * Slot map over a dense SoA: elements are stored contiguously in a `soa<T, Allocator, Storage>`,
+ * while `handle`s returned on insertion keep referring to the same element when others are erased.
+ * Erasing moves the last element into the hole (see `soa::erase_unordered`), so all operations are O(1) and columns stay dense.
+ * Handles carry a generation, so handles to erased elements are detected even if their slot is reused.
+ *
+ * @code
+ * soa::slot_map<Entity> entities;
+ * auto handle = entities.insert(Entity{ ... });
+ * entities[handle].field<"x">() += 1;
+ * entities.erase(handle);
+ * assert(!entities.contains(handle));
+ * @endcode
+ */
+template<typename T, typename Allocator = std::allocator<T>, typename Storage = vector_storage>
+class slot_map {
+	using _soa = soa<T, Allocator, Storage>;
+
+	struct _slot {
+		std::uint32_t index;
+		std::uint32_t generation;
+	};
+
+public:
+	using value_type = T;
+	using size_type = size_t;
+	using reference = typename _soa::reference;
+	using const_reference = typename _soa::const_reference;
+	using iterator = typename _soa::const_iterator;
+	using allocator_type = Allocator;
+
+	/// Stable reference to an element of the slot map
+	struct handle {
+		std::uint32_t index = std::numeric_limits<std::uint32_t>::max();
+		std::uint32_t generation = 0;
+
+		bool operator==(const handle& other) const = default;
+	};
+
+	slot_map() = default;
+	explicit slot_map(const Allocator& alloc)
+		: elements(alloc)
+		, slots(alloc)
+		, element_slots(alloc)
+		, free_slots(alloc)
+	{
+	}
+
+	size_t size() const {
+		return elements.size();
+	}
+	bool empty() const {
+		return elements.empty();
+	}
+
+	void reserve(size_t new_cap) {
+		elements.reserve(new_cap);
+		slots.reserve(new_cap);
+		element_slots.reserve(new_cap);
+	}
+
+	void clear() {
+		for (std::uint32_t slot : element_slots) {
+			slots[slot].generation++;
+			free_slots.push_back(slot);
+		}
+		elements.clear();
+		element_slots.clear();
+	}
+
+	handle insert(const T& value) {
+		return insert_with([&] { elements.push_back(value); });
+	}
+	handle insert(T&& value) {
+		return insert_with([&] { elements.push_back(std::move(value)); });
+	}
+
+	/// Insert an element, constructing each field in place from the corresponding argument
+	template<typename... Args> requires (sizeof...(Args) == reflect::size<T>())
+	handle emplace(Args&&... args) {
+		return insert_with([&] { elements.emplace_back(std::forward<Args>(args)...); });
+	}
+
+	/// Erase the element referred to by `h`, moving the last element into its place. Returns whether `h` was valid.
+	bool erase(handle h) {
+		if (!contains(h)) {
+			return false;
+		}
+		std::uint32_t index = slots[h.index].index;
+		elements.erase_unordered(elements.begin() + index);
+		std::uint32_t moved_slot = element_slots.back();
+		element_slots[index] = moved_slot;
+		slots[moved_slot].index = index;
+		element_slots.pop_back();
+		// Invalidate handles to the erased element
+		slots[h.index].generation++;
+		free_slots.push_back(h.index);
+		return true;
+	}
+
+	/// Whether `h` refers to an element of the slot map
+	bool contains(handle h) const {
+		return h.index < slots.size()
+			&& slots[h.index].generation == h.generation
+			&& slots[h.index].index < element_slots.size()
+			&& element_slots[slots[h.index].index] == h.index;
+	}
+
+	/// Element referred to by `h`, which must be valid
+	reference operator[](handle h) {
+		return elements[slots[h.index].index];
+	}
+	const_reference operator[](handle h) const {
+		return elements[slots[h.index].index];
+	}
+
+	/// Element referred to by `h`. Throws std::out_of_range if `h` is not valid.
+	reference at(handle h) {
+		if (!contains(h)) {
+			throw std::out_of_range("Invalid slot map handle");
+		}
+		return operator[](h);
+	}
+	const_reference at(handle h) const {
+		if (!contains(h)) {
+			throw std::out_of_range("Invalid slot map handle");
+		}
+		return operator[](h);
+	}
+
+	/// Dense index of the element referred to by `h`, which must be valid
+	size_t index_of(handle h) const {
+		return slots[h.index].index;
+	}
+
+	/// Handle to the element at dense index `index`
+	handle handle_of(size_t index) const {
+		std::uint32_t slot = element_slots[index];
+		return handle { slot, slots[slot].generation };
+	}
+
+	/// Iterate over the dense elements, in no particular order
+	iterator begin() const {
+		return elements.begin();
+	}
+	iterator end() const {
+		return elements.end();
+	}
+
+	/// The dense SoA, to run column kernels over all elements
+	const _soa& values() const {
+		return elements;
+	}
+
+	/// Field array of the dense elements, whose values may be modified
+	template<size_t I>
+	auto field() {
+		return elements.template field<I>();
+	}
+	template<size_t I>
+	auto field() const {
+		return elements.template field<I>();
+	}
+	template<reflect::fixed_string FieldName>
+	auto field() {
+		return elements.template field<FieldName>();
+	}
+	template<reflect::fixed_string FieldName>
+	auto field() const {
+		return elements.template field<FieldName>();
+	}
+	template<typename U>
+	auto field() {
+		return elements.template field<U>();
+	}
+	template<typename U>
+	auto field() const {
+		return elements.template field<U>();
+	}
+
+private:
+	using _slot_vector = typename detail::rebound_vector<Allocator>::template type<_slot>;
+	using _index_vector = typename detail::rebound_vector<Allocator>::template type<std::uint32_t>;
+
+	_soa elements;
+	/// Index in `elements` of each slot, with its current generation
+	_slot_vector slots;
+	/// Slot of each element
+	_index_vector element_slots;
+	_index_vector free_slots;
+
+	template<typename Insert>
+	handle insert_with(Insert&& insert) {
+		if (elements.size() >= std::numeric_limits<std::uint32_t>::max()) {
+			throw std::length_error("Too many elements in slot map");
+		}
+		if (free_slots.empty()) {
+			slots.push_back(_slot { 0, 0 });
+			try {
+				free_slots.push_back(std::uint32_t(slots.size() - 1));
+			}
+			catch (...) {
+				slots.pop_back();
+				throw;
+			}
+		}
+		std::uint32_t slot = free_slots.back();
+		element_slots.push_back(slot);
+		try {
+			insert();
+		}
+		catch (...) {
+			element_slots.pop_back();
+			throw;
+		}
+		free_slots.pop_back();
+		slots[slot].index = std::uint32_t(elements.size() - 1);
+		return handle { slot, slots[slot].generation };
+	}
+};
+
+/**
+ * Hash index over the `FieldName` column of a SoA, mapping keys to row indices for O(1) lookups.
+ * The index only stores row indices, in an open addressing table with linear probing, and reads keys from the column itself.
+ * It stays in sync when the SoA is modified through it, with `push_back`, `erase`, `erase_unordered`, etc.
+ * After modifying the SoA directly, for example with `sort_by` or by assigning keys, call `rebuild`.
+ * If several elements have the same key, `find` returns any of them.
+ *
+ * @code
+ * soa::soa<Entity> entities;
+ * soa::soa_index<"id", soa::soa<Entity>> by_id(entities);
+ * by_id.push_back(Entity{ .id = 42 });
+ * auto it = by_id.find(42);
+ * @endcode
+ */
+template<
+	reflect::fixed_string FieldName,
+	typename SoA,
+	typename Hash = std::hash<detail::field_type<reflect::index_of<FieldName, typename SoA::value_type>(), typename SoA::value_type>>,
+	typename KeyEqual = std::equal_to<>
+>
+class soa_index {
+	using T = typename SoA::value_type;
+	static constexpr size_t key_index = reflect::index_of<FieldName, T>();
+	static constexpr size_t empty_slot = std::numeric_limits<size_t>::max();
+
+public:
+	using key_type = detail::field_type<key_index, T>;
+	using value_type = T;
+	using size_type = size_t;
+	using iterator = typename SoA::iterator;
+	using const_iterator = typename SoA::const_iterator;
+	using hasher = Hash;
+	using key_equal = KeyEqual;
+
+	/// Index the current elements of `elements`, which must outlive the index
+	explicit soa_index(SoA& elements, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual())
+		: elements(&elements)
+		, slots(elements.get_allocator())
+		, hash(hash)
+		, equal(equal)
+	{
+		rebuild();
+	}
+
+	size_t size() const {
+		return elements->size();
+	}
+	bool empty() const {
+		return elements->empty();
+	}
+
+	/// Number of slots of the hash table, which is kept at most 3/4 full
+	size_t bucket_count() const {
+		return slots.size();
+	}
+
+	/// Reindex all elements, after the SoA was modified without going through the index
+	void rebuild() {
+		std::fill(slots.begin(), slots.end(), empty_slot);
+		if (!fits(size())) {
+			rehash(size());
+		}
+		else {
+			for (size_t row = 0; row < size(); row++) {
+				insert_row(row);
+			}
+		}
+	}
+
+	/// Element whose key equals `key`, or `end()` of the SoA if there is none
+	template<typename Key>
+	iterator find(const Key& key) const {
+		if (!slots.empty()) {
+			auto keys = elements->template field<key_index>();
+			for (size_t slot = bucket(key); slots[slot] != empty_slot; slot = next(slot)) {
+				if (equal(keys[slots[slot]], key)) {
+					return elements->begin() + slots[slot];
+				}
+			}
+		}
+		return elements->end();
+	}
+	template<typename Key>
+	bool contains(const Key& key) const {
+		return find(key) != elements->end();
+	}
+
+	void reserve(size_t new_cap) {
+		elements->reserve(new_cap);
+		if (!fits(new_cap)) {
+			rehash(new_cap);
+		}
+	}
+
+	/// Replace the elements of the SoA with `soa::assign(args...)`, and reindex them in bulk
+	template<typename... Args>
+	void assign(Args&&... args) {
+		elements->assign(std::forward<Args>(args)...);
+		rebuild();
+	}
+	void assign(std::initializer_list<T> ilist) {
+		elements->assign(ilist);
+		rebuild();
+	}
+
+	void clear() {
+		elements->clear();
+		std::fill(slots.begin(), slots.end(), empty_slot);
+	}
+
+	void push_back(const T& value) {
+		append([&] { elements->push_back(value); });
+	}
+	void push_back(T&& value) {
+		append([&] { elements->push_back(std::move(value)); });
+	}
+	template<typename... Args>
+	void emplace_back(Args&&... args) {
+		append([&] { elements->emplace_back(std::forward<Args>(args)...); });
+	}
+
+	void pop_back() {
+		erase_row(size() - 1);
+		elements->pop_back();
+	}
+
+	/// Erase the element at `pos`, shifting the next ones like `soa::erase`, which updates all slots in O(size)
+	iterator erase(const_iterator pos) {
+		size_t row = pos - elements->cbegin();
+		erase_row(row);
+		for (size_t& slot : slots) {
+			if (slot != empty_slot && slot > row) {
+				slot--;
+			}
+		}
+		return elements->erase(pos);
+	}
+
+	/// Erase the element at `pos`, moving the last element into its place like `soa::erase_unordered`, in O(1)
+	iterator erase_unordered(const_iterator pos) {
+		size_t row = pos - elements->cbegin();
+		size_t last = size() - 1;
+		erase_row(row);
+		if (row != last) {
+			slots[find_slot(last)] = row;
+		}
+		return elements->erase_unordered(pos);
+	}
+
+private:
+	SoA *elements;
+	std::vector<size_t, detail::rebind_alloc<typename SoA::allocator_type, size_t>> slots;
+	// Fibonacci hashing keeps the top bits of the product, so that hashes like consecutive or aligned integers spread
+	int shift = 64;
+	[[no_unique_address]] Hash hash;
+	[[no_unique_address]] KeyEqual equal;
+
+	decltype(auto) key(size_t row) const {
+		return elements->template field<key_index>()[row];
+	}
+
+	template<typename Key>
+	size_t bucket(const Key& key) const {
+		return size_t((std::uint64_t(hash(key)) * 0x9e3779b97f4a7c15) >> shift);
+	}
+	size_t next(size_t slot) const {
+		return (slot + 1) & (slots.size() - 1);
+	}
+
+	bool fits(size_t count) const {
+		return count * 4 <= slots.size() * 3;
+	}
+
+	/// Grow the table to fit `count` elements, and reindex the rows of the SoA
+	void rehash(size_t count) {
+		size_t slot_count = std::bit_ceil(std::max<size_t>(8, count + count / 3 + 1));
+		slots.assign(slot_count, empty_slot);
+		shift = 64 - std::countr_zero(slot_count);
+		for (size_t row = 0; row < size(); row++) {
+			insert_row(row);
+		}
+	}
+
+	/// Add a row to the SoA with `insert`, growing the table first so that only the SoA can throw
+	template<typename Insert>
+	void append(Insert&& insert) {
+		if (!fits(size() + 1)) {
+			rehash(std::max(size() + 1, size() * 2));
+		}
+		insert();
+		insert_row(size() - 1);
+	}
+
+	void insert_row(size_t row) {
+		size_t slot = bucket(key(row));
+		while (slots[slot] != empty_slot) {
+			slot = next(slot);
+		}
+		slots[slot] = row;
+	}
+
+	size_t find_slot(size_t row) const {
+		size_t slot = bucket(key(row));
+		while (slots[slot] != row) {
+			slot = next(slot);
+		}
+		return slot;
+	}
+
+	/// Remove a row from the table, shifting back the next slots of its probe sequence so that no tombstones are needed
+	void erase_row(size_t row) {
+		size_t hole = find_slot(row);
+		for (size_t slot = next(hole); slots[slot] != empty_slot; slot = next(slot)) {
+			size_t mask = slots.size() - 1;
+			size_t home = bucket(key(slots[slot]));
+			if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+				slots[hole] = slots[slot];
+				hole = slot;
+			}
+		}
+		slots[hole] = empty_slot;
+	}
+};
+
+/**
+ * Append-only SoA for concurrent producers, where rows are written without locks.
+ * Producers claim row ranges with an atomic compare-and-swap, then construct their fields in place.
+ * Rows are stored in segments whose capacity doubles, so growing never moves existing rows.
+ * Rows are published in order: `size()` is a watermark below which all rows are fully written and can be read.
+ * A producer that finished writing waits for the producers of the previous rows before publishing its own.
+ * Segments are allocated and values that may throw while being copied are built before rows are claimed,
+ * so a failed append claims nothing. Fields must be nothrow move constructible.
+ *
+ * `push_back`, `emplace_back`, `append`, `reserve`, and reading published rows are safe from any thread, if the allocator is.
+ * `clear` and destruction must not run concurrently with other operations.
+ *
+ * @code
+ * soa::concurrent_soa<Sample> samples;
+ * // In each producer thread
+ * samples.push_back(Sample{ ... });
+ * // In a reader thread
+ * samples.for_each_chunk<"value">([&](std::span<const float> values) { ... });
+ * @endcode
+ */
+template<typename T, typename Allocator = std::allocator<T>>
+class concurrent_soa {
+	using Layout = detail::contiguous_layout<T>;
+	struct alignas(Layout::alignment) unit {
+		std::byte bytes[Layout::alignment];
+	};
+	using unit_allocator = detail::rebind_alloc<Allocator, unit>;
+	using unit_traits = std::allocator_traits<unit_allocator>;
+
+	/// Segment k > 0 holds rows [first_segment_capacity << (k - 1), first_segment_capacity << k)
+	static constexpr size_t first_segment_bits = 10;
+	static constexpr size_t first_segment_capacity = size_t(1) << first_segment_bits;
+	static constexpr size_t max_segments = std::numeric_limits<size_t>::digits - first_segment_bits + 1;
+
+	static_assert([]<auto... Ns>(std::index_sequence<Ns...>) {
+		return (std::is_nothrow_move_constructible_v<detail::field_type<Ns, T>> && ...);
+	}(std::make_index_sequence<reflect::size<T>()>{}), "Fields must be nothrow move constructible");
+
+	/// Whether the fields can be constructed from `get(I)` without throwing, so directly in claimed rows
+	template<typename Get>
+	static constexpr bool nothrow_construct = []<auto... Ns>(std::index_sequence<Ns...>) {
+		return (std::is_nothrow_constructible_v<detail::field_type<Ns, T>, std::invoke_result_t<Get&, std::integral_constant<size_t, Ns>>> && ...);
+	}(std::make_index_sequence<reflect::size<T>()>{});
+
+public:
+	using value_type = T;
+	using size_type = size_t;
+	using allocator_type = Allocator;
+
+	concurrent_soa() = default;
+	explicit concurrent_soa(const Allocator& alloc)
+		: allocator(alloc)
+	{
+	}
+	concurrent_soa(const concurrent_soa&) = delete;
+	concurrent_soa& operator=(const concurrent_soa&) = delete;
+	~concurrent_soa() {
+		clear();
+		for (size_t k = 0; k < max_segments; k++) {
+			deallocate(segments[k].load(std::memory_order_relaxed), k);
+		}
+	}
+
+	allocator_type get_allocator() const {
+		return Allocator(allocator);
+	}
+
+	/// Number of published rows, that can be read
+	size_t size() const {
+		return published.load(std::memory_order_acquire);
+	}
+	bool empty() const {
+		return size() == 0;
+	}
+
+	/// Allocate the segments needed to hold `new_cap` rows, so that producers don't allocate before them
+	void reserve(size_t new_cap) {
+		for (size_t k = 0; k < max_segments && segment_first(k) < new_cap; k++) {
+			segment(k);
+		}
+	}
+
+	/// Destroy all rows, keeping the segments allocated
+	void clear() {
+		size_t count = size();
+		for (size_t row = 0; row < count; row++) {
+			reflect::for_each<T>([&](auto I) {
+				std::destroy_at(&field<I>(row));
+			});
+		}
+		claimed.store(0, std::memory_order_relaxed);
+		published.store(0, std::memory_order_release);
+	}
+
+	/**
+	 * Append an element and return its index.
+	 * The element is readable once `size()` is greater than its index.
+	 */
+	size_t push_back(const T& value) {
+		auto get = [&](auto I) -> decltype(auto) { return reflect::get<I>(value); };
+		if constexpr (nothrow_construct<decltype(get)>) {
+			return append_rows(1, [&](size_t row) {
+				construct_row(row, get);
+			});
+		}
+		else {
+			// Copying may throw, so it happens before claiming a row
+			return push_back(T(value));
+		}
+	}
+	size_t push_back(T&& value) {
+		return append_rows(1, [&](size_t row) {
+			construct_row(row, [&](auto I) -> decltype(auto) { return std::move(reflect::get<I>(value)); });
+		});
+	}
+
+	/// Append an element, constructing each field from the corresponding argument, and return its index
+	template<typename... Args> requires (sizeof...(Args) == reflect::size<T>())
+	size_t emplace_back(Args&&... args) {
+		auto arguments = std::forward_as_tuple(std::forward<Args>(args)...);
+		auto get = [&](auto I) -> decltype(auto) { return std::get<I>(std::move(arguments)); };
+		if constexpr (nothrow_construct<decltype(get)>) {
+			return append_rows(1, [&](size_t row) {
+				construct_row(row, get);
+			});
+		}
+		else {
+			// Fields are constructed before claiming a row, then moved into it
+			detail::field_types<T> values(std::forward<Args>(args)...);
+			return append_rows(1, [&](size_t row) {
+				construct_row(row, [&](auto I) -> decltype(auto) { return std::get<I>(std::move(values)); });
+			});
+		}
+	}
+
+	/**
+	 * Append the elements of [first, last) as consecutive rows, claimed at once, and return the index of the first one.
+	 * If copying elements may throw, or the iterator returns elements by value, they are first copied into a temporary vector.
+	 */
+	template<std::forward_iterator InputIt>
+	size_t append(InputIt first, InputIt last) {
+		using reference = std::iter_reference_t<InputIt>;
+		auto get = [&](auto I) -> decltype(auto) { return detail::iterator_field<I, T>(first); };
+		// Dereferencing an iterator that returns values computes them, which may throw
+		if constexpr ((std::is_reference_v<reference> || detail::field_proxy<reference>) && nothrow_construct<decltype(get)>) {
+			return append_rows(std::distance(first, last), [&](size_t row) {
+				construct_row(row, get);
+				++first;
+			});
+		}
+		else {
+			std::vector<T, detail::rebind_alloc<Allocator, T>> values(first, last, get_allocator());
+			auto value = values.begin();
+			return append_rows(values.size(), [&](size_t row) {
+				construct_row(row, [&](auto I) -> decltype(auto) { return std::move(reflect::get<I>(*value)); });
+				++value;
+			});
+		}
+	}
+
+	/// I-th field of the published row `index`
+	template<size_t I>
+	detail::field_type<I, T>& field(size_t index) {
+		size_t k = segment_of(index);
+		return column<I>(segments[k].load(std::memory_order_acquire), k)[index - segment_first(k)];
+	}
+	template<size_t I>
+	const detail::field_type<I, T>& field(size_t index) const {
+		size_t k = segment_of(index);
+		return column<I>(segments[k].load(std::memory_order_acquire), k)[index - segment_first(k)];
+	}
+	template<reflect::fixed_string FieldName>
+	decltype(auto) field(size_t index) {
+		return field<reflect::index_of<FieldName, T>()>(index);
+	}
+	template<reflect::fixed_string FieldName>
+	decltype(auto) field(size_t index) const {
+		return field<reflect::index_of<FieldName, T>()>(index);
+	}
+	template<typename U>
+	decltype(auto) field(size_t index) {
+		return field<detail::index_of_type<U, T>()>(index);
+	}
+	template<typename U>
+	decltype(auto) field(size_t index) const {
+		return field<detail::index_of_type<U, T>()>(index);
+	}
+
+	/// Construct a new value from all fields of the published row `index`
+	T value(size_t index) const {
+		return [&]<auto... Ns>(std::index_sequence<Ns...>) {
+			return T { field<Ns>(index)... };
+		}(std::make_index_sequence<reflect::size<T>()>{});
+	}
+
+	/**
+	 * Call `fn(std::span<F>...)` with the selected fields of each segment of published rows, in order.
+	 * Rows published while iterating may be skipped.
+	 *
+	 * @code
+	 * samples.for_each_chunk<"value">([&](std::span<const float> values) { ... });
+	 * @endcode
+	 */
+	template<size_t... I, typename Fn>
+	void for_each_chunk(Fn&& fn) {
+		size_t count = size();
+		for (size_t k = 0; k < max_segments && segment_first(k) < count; k++) {
+			unit *block = segments[k].load(std::memory_order_acquire);
+			size_t chunk_size = std::min(count, segment_first(k + 1)) - segment_first(k);
+			fn(std::span<detail::field_type<I, T>>(column<I>(block, k), chunk_size)...);
+		}
+	}
+	template<size_t... I, typename Fn>
+	void for_each_chunk(Fn&& fn) const {
+		size_t count = size();
+		for (size_t k = 0; k < max_segments && segment_first(k) < count; k++) {
+			unit *block = segments[k].load(std::memory_order_acquire);
+			size_t chunk_size = std::min(count, segment_first(k + 1)) - segment_first(k);
+			fn(std::span<const detail::field_type<I, T>>(column<I>(block, k), chunk_size)...);
+		}
+	}
+	template<reflect::fixed_string... FieldNames, typename Fn>
+	void for_each_chunk(Fn&& fn) {
+		for_each_chunk<reflect::index_of<FieldNames, T>()...>(fn);
+	}
+	template<reflect::fixed_string... FieldNames, typename Fn>
+	void for_each_chunk(Fn&& fn) const {
+		for_each_chunk<reflect::index_of<FieldNames, T>()...>(fn);
+	}
+	template<typename... U, typename Fn>
+	void for_each_chunk(Fn&& fn) {
+		for_each_chunk<detail::index_of_type<U, T>()...>(fn);
+	}
+	template<typename... U, typename Fn>
+	void for_each_chunk(Fn&& fn) const {
+		for_each_chunk<detail::index_of_type<U, T>()...>(fn);
+	}
+
+	/// Copy the published rows into a `soa`
+	template<typename Storage = vector_storage>
+	soa<T, Allocator, Storage> to_soa() const {
+		soa<T, Allocator, Storage> result(get_allocator());
+		size_t count = size();
+		result.reserve(count);
+		for (size_t row = 0; row < count; row++) {
+			result.push_back(value(row));
+		}
+		return result;
+	}
+
+private:
+	[[no_unique_address]] unit_allocator allocator;
+	std::array<std::atomic<unit *>, max_segments> segments {};
+	// Producers update both counters, which are on separate cache lines to avoid false sharing with the segments
+	alignas(64) std::atomic<size_t> claimed = 0;
+	alignas(64) std::atomic<size_t> published = 0;
+
+	static size_t segment_of(size_t index) {
+		return std::bit_width(index >> first_segment_bits);
+	}
+	static size_t segment_first(size_t k) {
+		return k == 0 ? 0 : first_segment_capacity << (k - 1);
+	}
+	static size_t segment_capacity(size_t k) {
+		return k == 0 ? first_segment_capacity : first_segment_capacity << (k - 1);
+	}
+
+	template<size_t I>
+	static detail::field_type<I, T> *column(unit *block, size_t k) {
+		return Layout::template column_begin<I>(reinterpret_cast<std::byte *>(block), segment_capacity(k));
+	}
+
+	unit *allocate(size_t k) {
+		return unit_traits::allocate(allocator, Layout::block_size(segment_capacity(k)) / sizeof(unit));
+	}
+	void deallocate(unit *block, size_t k) {
+		if (block) {
+			unit_traits::deallocate(allocator, block, Layout::block_size(segment_capacity(k)) / sizeof(unit));
+		}
+	}
+
+	/// Segment k, allocated by the first thread that needs it
+	unit *segment(size_t k) {
+		unit *block = segments[k].load(std::memory_order_acquire);
+		if (!block) {
+			unit *new_block = allocate(k);
+			if (segments[k].compare_exchange_strong(block, new_block, std::memory_order_acq_rel)) {
+				block = new_block;
+			}
+			else {
+				// Another thread allocated the segment first
+				deallocate(new_block, k);
+			}
+		}
+		return block;
+	}
+
+	/// Construct each field of the claimed `row`, whose segment is allocated, from `get(I)`, which must not throw
+	template<typename Get>
+	void construct_row(size_t row, Get&& get) noexcept {
+		static_assert(nothrow_construct<Get>, "Fields of claimed rows must be constructed without throwing");
+		size_t k = segment_of(row);
+		unit *block = segments[k].load(std::memory_order_acquire);
+		size_t offset = row - segment_first(k);
+		reflect::for_each<T>([&](auto I) {
+			std::construct_at(column<I>(block, k) + offset, get(I));
+		});
+	}
+
+	/**
+	 * Claim `count` rows, allocating their segments first, so that nothing is claimed if allocating throws.
+	 * Rows once claimed must be published for the next producers to publish theirs.
+	 */
+	size_t claim(size_t count) {
+		size_t first = claimed.load(std::memory_order_relaxed);
+		do {
+			if (count > 0) {
+				for (size_t k = segment_of(first); k <= segment_of(first + count - 1); k++) {
+					segment(k);
+				}
+			}
+		} while (!claimed.compare_exchange_weak(first, first + count, std::memory_order_relaxed));
+		return first;
+	}
+
+	/// Claim `count` rows, construct each of them with `construct(row)`, which must not throw, then publish them and return the first one
+	template<typename Construct>
+	size_t append_rows(size_t count, Construct&& construct) {
+		size_t first = claim(count);
+		for (size_t row = first; row < first + count; row++) {
+			construct(row);
+		}
+		publish(first, count);
+		return first;
+	}
+
+	/// Publish the rows [first, first + count) once all previous rows are published
+	void publish(size_t first, size_t count) {
+		for (size_t current = published.load(std::memory_order_acquire); current != first; current = published.load(std::memory_order_acquire)) {
+			published.wait(current, std::memory_order_acquire);
+		}
+		published.store(first + count, std::memory_order_release);
+		published.notify_all();
+	}
+};
+
+/**
+ * SoA that records which rows of each column were modified, for incremental synchronization with a GPU or network peers.
+ * Rows are tracked in chunks of `ChunkSize` rows, one bit per chunk and column, and `dirty_ranges` returns the modified ranges of a column.
+ *
+ * Modifying operations mark the rows they change: `push_back`, `insert` and `erase` mark all columns from the first changed row,
+ * while `write<"field">(first, count)` marks a single column. The mutable `operator[]` conservatively marks the row in all columns.
+ * Changes made through the mutable `elements()` are not tracked, and must be recorded with `mark_dirty`.
+ * Rows removed from the end are not reported, peers are expected to compare sizes.
+ *
+ * @code
+ * soa::tracked_soa<Particle> particles;
+ * for (float& x : particles.write<"x">(0, particles.size())) { ... }
+ * for (auto [first, last] : particles.dirty_ranges<"x">()) { upload(particles.field<"x">().subspan(first, last - first)); }
+ * particles.clear_dirty();
+ * @endcode
+ */
+template<typename T, typename Allocator = std::allocator<T>, typename Storage = vector_storage, size_t ChunkSize = 1024>
+class tracked_soa {
+	static_assert(ChunkSize > 0, "Chunks must hold at least one row");
+
+	using _soa = soa<T, Allocator, Storage>;
+	static constexpr size_t field_count = reflect::size<T>();
+
+public:
+	using value_type = T;
+	using size_type = size_t;
+	using reference = typename _soa::reference;
+	using const_reference = typename _soa::const_reference;
+	using iterator = typename _soa::const_iterator;
+	using allocator_type = Allocator;
+
+	static constexpr size_t chunk_size = ChunkSize;
+
+	/// Rows [first, last) of a column
+	struct row_range {
+		size_t first = 0;
+		size_t last = 0;
+
+		bool operator==(const row_range& other) const = default;
+	};
+
+	tracked_soa() = default;
+	explicit tracked_soa(const Allocator& alloc)
+		: values(alloc)
+		, dirty(make_dirty(alloc))
+	{
+	}
+
+	size_t size() const {
+		return values.size();
+	}
+	bool empty() const {
+		return values.empty();
+	}
+	void reserve(size_t new_cap) {
+		values.reserve(new_cap);
+	}
+
+	iterator begin() const {
+		return values.begin();
+	}
+	iterator end() const {
+		return values.end();
+	}
+
+	/// Underlying SoA, whose changes must be recorded with `mark_dirty`
+	_soa& elements() {
+		return values;
+	}
+	const _soa& elements() const {
+		return values;
+	}
+
+	/// Element at `index`, which is marked as modified in all columns
+	reference operator[](size_t index) {
+		mark_dirty(index, index + 1);
+		return values[index];
+	}
+	const_reference operator[](size_t index) const {
+		return values[index];
+	}
+
+	/// Read-only column of the I-th field
+	template<size_t I>
+	auto field() const {
+		return values.template field<I>();
+	}
+	template<reflect::fixed_string FieldName>
+	auto field() const {
+		return values.template field<FieldName>();
+	}
+	template<typename U>
+	auto field() const {
+		return values.template field<U>();
+	}
+
+	/**
+	 * Mark rows [first, first + count) of the I-th field as modified, and return them to be written.
+	 *
+	 * @code
+	 * for (float& x : particles.write<"x">(first, count)) { ... }
+	 * @endcode
+	 */
+	template<size_t I>
+	auto write(size_t first, size_t count) {
+		mark_dirty<I>(first, first + count);
+		auto column = values.template field<I>();
+		return std::ranges::subrange(column.begin() + first, column.begin() + (first + count));
+	}
+	template<reflect::fixed_string FieldName>
+	auto write(size_t first, size_t count) {
+		return write<reflect::index_of<FieldName, T>()>(first, count);
+	}
+	template<typename U>
+	auto write(size_t first, size_t count) {
+		return write<detail::index_of_type<U, T>()>(first, count);
+	}
+
+	void push_back(const T& value) {
+		values.push_back(value);
+		mark_dirty(size() - 1, size());
+	}
+	void push_back(T&& value) {
+		values.push_back(std::move(value));
+		mark_dirty(size() - 1, size());
+	}
+	template<typename... Args>
+	void emplace_back(Args&&... args) {
+		values.emplace_back(std::forward<Args>(args)...);
+		mark_dirty(size() - 1, size());
+	}
+	void pop_back() {
+		values.pop_back();
+	}
+
+	/// Insert elements before `pos` like `soa::insert`, marking all rows from `pos` in all columns since they shift
+	template<typename... Args>
+	iterator insert(iterator pos, Args&&... args) {
+		size_t index = pos - begin();
+		values.insert(pos, std::forward<Args>(args)...);
+		mark_dirty(index, size());
+		return begin() + index;
+	}
+	iterator insert(iterator pos, std::initializer_list<T> ilist) {
+		return insert<std::initializer_list<T>>(pos, std::move(ilist));
+	}
+
+	/// Erase elements like `soa::erase`, marking all rows from `first` in all columns since they shift
+	iterator erase(iterator pos) {
+		return erase(pos, pos + 1);
+	}
+	iterator erase(iterator first, iterator last) {
+		size_t index = first - begin();
+		values.erase(first, last);
+		mark_dirty(index, size());
+		return begin() + index;
+	}
+
+	/// Erase the element at `pos` like `soa::erase_unordered`, marking only the row that is replaced by the last one
+	iterator erase_unordered(iterator pos) {
+		size_t index = pos - begin();
+		values.erase_unordered(pos);
+		if (index < size()) {
+			mark_dirty(index, index + 1);
+		}
+		return begin() + index;
+	}
+
+	void resize(size_t count) {
+		size_t old_size = size();
+		values.resize(count);
+		if (count > old_size) {
+			mark_dirty(old_size, count);
+		}
+	}
+	void resize(size_t count, const T& value) {
+		size_t old_size = size();
+		values.resize(count, value);
+		if (count > old_size) {
+			mark_dirty(old_size, count);
+		}
+	}
+	void resize_for_overwrite(size_t count) {
+		size_t old_size = size();
+		values.resize_for_overwrite(count);
+		if (count > old_size) {
+			mark_dirty(old_size, count);
+		}
+	}
+
+	void clear() {
+		values.clear();
+	}
+
+	/// Mark rows [first, last) of the selected fields as modified
+	template<size_t... I>
+	void mark_dirty(size_t first, size_t last) {
+		(mark_column(I, first, last), ...);
+	}
+	template<reflect::fixed_string... FieldNames>
+	void mark_dirty(size_t first, size_t last) {
+		mark_dirty<reflect::index_of<FieldNames, T>()...>(first, last);
+	}
+	template<typename... U>
+	void mark_dirty(size_t first, size_t last) {
+		mark_dirty<detail::index_of_type<U, T>()...>(first, last);
+	}
+	/// Mark rows [first, last) of all fields as modified
+	void mark_dirty(size_t first, size_t last) {
+		for (size_t i = 0; i < field_count; i++) {
+			mark_column(i, first, last);
+		}
+	}
+
+	/**
+	 * Ranges of rows of the I-th field marked as modified since the last `clear_dirty`, in order and merged.
+	 * Ranges are rounded to whole chunks, and clipped to `size()`.
+	 */
+	template<size_t I>
+	std::vector<row_range> dirty_ranges() const {
+		std::vector<row_range> ranges;
+		bit_span<const bool> chunks = std::get<I>(dirty).span();
+		std::span<const std::uint64_t> words = chunks.words();
+		for (size_t w = 0; w < words.size(); w++) {
+			for (std::uint64_t word = words[w]; word != 0; word &= word - 1) {
+				size_t first = (w * bit_span<bool>::word_bits + std::countr_zero(word)) * ChunkSize;
+				if (first >= size()) {
+					return ranges;
+				}
+				size_t last = std::min(first + ChunkSize, size());
+				if (!ranges.empty() && ranges.back().last == first) {
+					ranges.back().last = last;
+				}
+				else {
+					ranges.push_back(row_range { first, last });
+				}
+			}
+		}
+		return ranges;
+	}
+	template<reflect::fixed_string FieldName>
+	std::vector<row_range> dirty_ranges() const {
+		return dirty_ranges<reflect::index_of<FieldName, T>()>();
+	}
+	template<typename U>
+	std::vector<row_range> dirty_ranges() const {
+		return dirty_ranges<detail::index_of_type<U, T>()>();
+	}
+
+	/// Whether the chunk of `row` is marked as modified in the I-th field
+	template<size_t I>
+	bool is_dirty(size_t row) const {
+		const auto& chunks = std::get<I>(dirty);
+		return row / ChunkSize < chunks.size() && chunks.span()[row / ChunkSize];
+	}
+	template<reflect::fixed_string FieldName>
+	bool is_dirty(size_t row) const {
+		return is_dirty<reflect::index_of<FieldName, T>()>(row);
+	}
+	template<typename U>
+	bool is_dirty(size_t row) const {
+		return is_dirty<detail::index_of_type<U, T>()>(row);
+	}
+
+	/// Forget the modifications of the selected fields, typically after synchronizing them
+	template<size_t... I>
+	void clear_dirty() {
+		(std::get<I>(dirty).clear(), ...);
+	}
+	template<reflect::fixed_string... FieldNames>
+	void clear_dirty() {
+		clear_dirty<reflect::index_of<FieldNames, T>()...>();
+	}
+	template<typename... U>
+	void clear_dirty() {
+		clear_dirty<detail::index_of_type<U, T>()...>();
+	}
+	/// Forget the modifications of all fields
+	void clear_dirty() {
+		for (auto& chunks : dirty) {
+			chunks.clear();
+		}
+	}
+
+private:
+	using dirty_bits = detail::bit_vector<Allocator>;
+
+	_soa values;
+	// One bit per chunk of rows for each field, grown on demand
+	std::array<dirty_bits, field_count> dirty;
+
+	static std::array<dirty_bits, field_count> make_dirty(const Allocator& alloc) {
+		return [&]<auto... Ns>(std::index_sequence<Ns...>) {
+			return std::array<dirty_bits, field_count> { ((void) Ns, dirty_bits(typename dirty_bits::allocator_type(alloc)))... };
+		}(std::make_index_sequence<field_count>{});
+	}
+
+	void mark_column(size_t index, size_t first, size_t last) {
+		if (first >= last) {
+			return;
+		}
+		dirty_bits& chunks = dirty[index];
+		size_t first_chunk = first / ChunkSize;
+		size_t last_chunk = (last - 1) / ChunkSize + 1;
+		if (chunks.size() < last_chunk) {
+			chunks.resize(last_chunk);
+		}
+		std::fill(chunks.begin() + first_chunk, chunks.begin() + last_chunk, true);
+	}
+};
+
+namespace detail {
+	/// Encoding of the I-th field of T among `encode<...>` selectors, `plain_encoding` by default
+	template<size_t I, typename T, typename... Encodings>
+	struct field_encoding {
+		using type = plain_encoding;
+	};
+	template<size_t I, typename T, typename Encoding, typename... Encodings>
+	struct field_encoding<I, T, Encoding, Encodings...> {
+		using type = std::conditional_t<
+			Encoding::template index<T> == I,
+			typename Encoding::encoding,
+			typename field_encoding<I, T, Encodings...>::type
+		>;
+	};
+}
+
+/**
+ * Read-only SoA whose fields are encoded to use less memory, as returned by `soa::freeze`.
+ * Each field uses the encoding selected by an `encode<"field", Encoding>` argument, or `plain_encoding`.
+ * Use `for_each_block` to scan fields, decoding them in blocks of `block_size` elements.
+ *
+ * @code
+ * auto frozen = soa.freeze<soa::encode<"time", soa::frame_of_reference_encoding<>>, soa::encode<"name", soa::dictionary_encoding<>>>();
+ * frozen.for_each_block<"time">([&](std::span<const int64_t> times) { ... });
+ * @endcode
+ */
+template<typename T, typename... Encodings>
+class frozen_soa {
+	static_assert(detail::distinct_indices<Encodings::template index<T>...>(), "Fields must be encoded at most once");
+
+	template<size_t I>
+	using _column = typename detail::field_encoding<I, T, Encodings...>::type::template column<detail::field_type<I, T>>;
+
+	using _columns = decltype([]<auto... Ns>(std::index_sequence<Ns...>) {
+		return std::type_identity<std::tuple<_column<Ns>...>>();
+	}(std::make_index_sequence<reflect::size<T>()>{}))::type;
+
+public:
+	using value_type = T;
+	using size_type = size_t;
+
+	/// Number of elements decoded at once by `for_each_block`
+	static constexpr size_t block_size = 1024;
+
+	/// Encode the fields of `source`, a SoA of T
+	template<typename Source>
+	explicit frozen_soa(const Source& source)
+		: columns([&]<auto... Ns>(std::index_sequence<Ns...>) {
+			return _columns(_column<Ns>(source.template field<Ns>())...);
+		}(std::make_index_sequence<reflect::size<T>()>{}))
+		, count(source.size())
+	{
+	}
+
+	size_t size() const {
+		return count;
+	}
+	bool empty() const {
+		return count == 0;
+	}
+
+	/// Decode the element at `index`
+	T operator[](size_t index) const {
+		return [&]<auto... Ns>(std::index_sequence<Ns...>) {
+			return T(field<Ns>()[index]...);
+		}(std::make_index_sequence<reflect::size<T>()>{});
+	}
+
+	/// Encoded column of a field, see its encoding
+	template<size_t I>
+	const _column<I>& field() const {
+		return std::get<I>(columns);
+	}
+	template<reflect::fixed_string FieldName>
+	const auto& field() const {
+		return field<reflect::index_of<FieldName, T>()>();
+	}
+	template<typename U>
+	const auto& field() const {
+		return field<detail::index_of_type<U, T>()>();
+	}
+
+	/**
+	 * Call `fn` with a span of decoded values for each selected field, for each block of up to `block_size` elements.
+	 * Spans are only valid during the call.
+	 *
+	 * @code
+	 * frozen.for_each_block<"x", "y">([&](std::span<const float> x, std::span<const float> y) { ... });
+	 * @endcode
+	 */
+	template<size_t... I, typename Fn>
+	void for_each_block(Fn&& fn) const {
+		static_assert(sizeof...(I) > 0, "At least one field must be selected");
+		std::tuple<std::vector<detail::bool_to_union<detail::field_type<I, T>>>...> buffers;
+		for (size_t first = 0; first < count; first += block_size) {
+			size_t n = std::min(block_size, count - first);
+			[&]<auto... Ns>(std::index_sequence<Ns...>) {
+				(std::get<Ns>(buffers).resize(n), ...);
+				fn(std::span<const detail::field_type<I, T>>(
+					field<I>().decode(first, n, (detail::field_type<I, T> *) std::get<Ns>(buffers).data()), n
+				)...);
+			}(std::index_sequence_for<std::integral_constant<size_t, I>...>{});
+		}
+	}
+	template<reflect::fixed_string... FieldNames, typename Fn>
+	void for_each_block(Fn&& fn) const {
+		for_each_block<reflect::index_of<FieldNames, T>()...>(fn);
+	}
+	template<typename... U, typename Fn>
+	void for_each_block(Fn&& fn) const {
+		for_each_block<detail::index_of_type<U, T>()...>(fn);
+	}
+
+	/// Decode all elements into a new SoA
+	template<typename Allocator = std::allocator<T>, typename Storage = vector_storage>
+	soa<T, Allocator, Storage> thaw(const Allocator& alloc = Allocator()) const {
+		soa<T, Allocator, Storage> result(alloc);
+		result.reserve(count);
+		[&]<auto... Ns>(std::index_sequence<Ns...>) {
+			for_each_block<Ns...>([&](auto first_values, auto... values) {
+				for (size_t i = 0; i < first_values.size(); i++) {
+					result.emplace_back(first_values[i], values[i]...);
+				}
+			});
+		}(std::make_index_sequence<reflect::size<T>()>{});
+		return result;
+	}
+
+	/// Bytes allocated by the encoded columns, not counting memory owned by the values themselves
+	size_t memory_usage() const {
+		return std::apply([](const auto&... column) {
+			return (column.memory_usage() + ...);
+		}, columns);
+	}
+
+private:
+	_columns columns;
+	size_t count = 0;
+};
+
+namespace pmr {
+	/// SoA that allocates memory from a std::pmr::memory_resource
+	template<typename T, typename Storage = vector_storage>
+	using soa = ::soa::soa<T, std::pmr::polymorphic_allocator<T>, Storage>;
+}
+
+namespace detail {
+	/// Whether `R` is a proxy reference to an element of a SoA
+	template<typename R>
+	concept soa_reference = field_proxy<R> && requires {
+		typename R::value_type;
+	};
+}
+
+}
+
+/**
+ * Common reference between SoA proxies and their value type.
+ * Required for SoA iterators to model `std::random_access_iterator`, like other proxy iterators.
+ */
+template<typename R, typename U, template<typename> typename RQual, template<typename> typename UQual>
+	requires soa::detail::soa_reference<R> && std::same_as<std::remove_cv_t<U>, typename R::value_type>
+struct std::basic_common_reference<R, U, RQual, UQual> {
+	using type = typename R::value_type;
+};
+template<typename U, typename R, template<typename> typename UQual, template<typename> typename RQual>
+	requires soa::detail::soa_reference<R> && std::same_as<std::remove_cv_t<U>, typename R::value_type>
+struct std::basic_common_reference<U, R, UQual, RQual> {
+	using type = typename R::value_type;
+};
+template<typename R1, typename R2, template<typename> typename R1Qual, template<typename> typename R2Qual>
+	requires soa::detail::soa_reference<R1> && soa::detail::soa_reference<R2> && std::same_as<typename R1::value_type, typename R2::value_type>
+struct std::basic_common_reference<R1, R2, R1Qual, R2Qual> {
+	using type = typename R1::value_type;
+};
+
+/**
+ * Common reference between the proxy references yielded by field views and their value type.
+ * Required for field view iterators to model `std::random_access_iterator`.
+ */
+template<typename... U, typename... V, template<typename> typename RQual, template<typename> typename VQual>
+	requires std::same_as<typename soa::field_reference<U...>::value_type, soa::field_tuple<V...>>
+struct std::basic_common_reference<soa::field_reference<U...>, soa::field_tuple<V...>, RQual, VQual> {
+	using type = soa::field_tuple<V...>;
+};
+template<typename... V, typename... U, template<typename> typename VQual, template<typename> typename RQual>
+	requires std::same_as<typename soa::field_reference<U...>::value_type, soa::field_tuple<V...>>
+struct std::basic_common_reference<soa::field_tuple<V...>, soa::field_reference<U...>, VQual, RQual> {
+	using type = soa::field_tuple<V...>;
+};
+
+template<typename... U>
+struct std::tuple_size<soa::field_tuple<U...>> : std::tuple_size<std::tuple<U...>> {};
+template<size_t I, typename... U>
+struct std::tuple_element<I, soa::field_tuple<U...>> : std::tuple_element<I, std::tuple<U...>> {};
+template<typename... U>
+struct std::tuple_size<soa::field_reference<U...>> : std::tuple_size<std::tuple<U&...>> {};
+template<size_t I, typename... U>
+struct std::tuple_element<I, soa::field_reference<U...>> : std::tuple_element<I, std::tuple<U&...>> {};
+
+/// Field views don't own the field arrays, so their iterators can outlive them
+template<typename... U>
+inline constexpr bool std::ranges::enable_borrowed_range<soa::field_view<U...>> = true;
 
 #endif // __SOA_HPP__
@@ -0,0 +1,411 @@
+#ifndef __SOA_ARROW_HPP__
+#define __SOA_ARROW_HPP__
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "soa.hpp"
+
+// Apache Arrow C Data Interface, as defined by its specification
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+	// Array type description
+	const char *format;
+	const char *name;
+	const char *metadata;
+	int64_t flags;
+	int64_t n_children;
+	struct ArrowSchema **children;
+	struct ArrowSchema *dictionary;
+
+	// Release callback
+	void (*release)(struct ArrowSchema *);
+	// Opaque producer-specific data
+	void *private_data;
+};
+
+struct ArrowArray {
+	// Array data description
+	int64_t length;
+	int64_t null_count;
+	int64_t offset;
+	int64_t n_buffers;
+	int64_t n_children;
+	const void **buffers;
+	struct ArrowArray **children;
+	struct ArrowArray *dictionary;
+
+	// Release callback
+	void (*release)(struct ArrowArray *);
+	// Opaque producer-specific data
+	void *private_data;
+};
+
+#endif // ARROW_C_DATA_INTERFACE
+
+namespace soa {
+
+namespace detail {
+	/// Arrow format string of a primitive field type, or nullptr if it has none
+	template<typename U>
+	constexpr const char *arrow_primitive_format() {
+		if constexpr (std::is_same_v<U, float>) return "f";
+		else if constexpr (std::is_same_v<U, double>) return "g";
+		else if constexpr (std::is_same_v<U, bool> || !std::is_integral_v<U>) return nullptr;
+		else if constexpr (sizeof(U) == 1) return std::is_signed_v<U> ? "c" : "C";
+		else if constexpr (sizeof(U) == 2) return std::is_signed_v<U> ? "s" : "S";
+		else if constexpr (sizeof(U) == 4) return std::is_signed_v<U> ? "i" : "I";
+		else if constexpr (sizeof(U) == 8) return std::is_signed_v<U> ? "l" : "L";
+		else return nullptr;
+	}
+
+	/// Whether fields of type U can be exported to and imported from Arrow
+	template<typename U>
+	constexpr bool arrow_field = arrow_primitive_format<U>() != nullptr
+		|| std::is_same_v<U, bool>
+		|| std::is_same_v<U, std::string>;
+
+	/// Data owned by an exported ArrowSchema, freed by its release callback
+	struct arrow_schema_data {
+		std::string format;
+		std::string name;
+		std::vector<ArrowSchema> children;
+		std::vector<ArrowSchema *> child_pointers;
+	};
+
+	/// Data owned by an exported ArrowArray, freed by its release callback
+	struct arrow_array_data {
+		std::vector<std::vector<std::byte>> owned_buffers;
+		std::vector<const void *> buffers;
+		std::vector<ArrowArray> children;
+		std::vector<ArrowArray *> child_pointers;
+	};
+
+	inline void release_arrow_schema(ArrowSchema *schema) {
+		auto *data = static_cast<arrow_schema_data *>(schema->private_data);
+		for (ArrowSchema& child : data->children) {
+			// Consumers may have moved children out, marking them released
+			if (child.release != nullptr) {
+				child.release(&child);
+			}
+		}
+		delete data;
+		schema->release = nullptr;
+	}
+
+	inline void release_arrow_array(ArrowArray *array) {
+		auto *data = static_cast<arrow_array_data *>(array->private_data);
+		for (ArrowArray& child : data->children) {
+			if (child.release != nullptr) {
+				child.release(&child);
+			}
+		}
+		delete data;
+		array->release = nullptr;
+	}
+
+	/// Fill `schema` with its private data, taking ownership of it
+	inline void make_arrow_schema(ArrowSchema *schema, std::unique_ptr<arrow_schema_data> data, int64_t flags) {
+		for (ArrowSchema& child : data->children) {
+			data->child_pointers.push_back(&child);
+		}
+		*schema = ArrowSchema {
+			.format = data->format.c_str(),
+			.name = data->name.c_str(),
+			.metadata = nullptr,
+			.flags = flags,
+			.n_children = int64_t(data->children.size()),
+			.children = data->child_pointers.data(),
+			.dictionary = nullptr,
+			.release = release_arrow_schema,
+			.private_data = data.release(),
+		};
+	}
+
+	/// Fill `array` with its private data, taking ownership of it
+	inline void make_arrow_array(ArrowArray *array, std::unique_ptr<arrow_array_data> data, size_t length) {
+		for (ArrowArray& child : data->children) {
+			data->child_pointers.push_back(&child);
+		}
+		*array = ArrowArray {
+			.length = int64_t(length),
+			.null_count = 0,
+			.offset = 0,
+			.n_buffers = int64_t(data->buffers.size()),
+			.n_children = int64_t(data->children.size()),
+			.buffers = data->buffers.data(),
+			.children = data->child_pointers.data(),
+			.dictionary = nullptr,
+			.release = release_arrow_array,
+			.private_data = data.release(),
+		};
+	}
+
+	/// Pack a range of bools in an Arrow bitmap, least significant bit first
+	template<typename Column>
+	std::vector<std::byte> make_arrow_bitmap(const Column& column) {
+		std::vector<std::byte> bitmap((column.size() + 7) / 8);
+		for (size_t i = 0; i < column.size(); i++) {
+			if (column[i]) {
+				bitmap[i / 8] |= std::byte(1 << (i % 8));
+			}
+		}
+		return bitmap;
+	}
+
+	/**
+	 * Export a column of U as an Arrow array and its schema.
+	 * Contiguous primitive columns and packed bool columns (on little-endian targets) are shared without copying,
+	 * other columns are converted into buffers owned by the array.
+	 */
+	template<typename U, typename Column>
+	void export_arrow_column(const Column& column, std::string_view name, ArrowArray *array, ArrowSchema *schema) {
+		auto schema_data = std::make_unique<arrow_schema_data>();
+		schema_data->name = name;
+		auto array_data = std::make_unique<arrow_array_data>();
+		// No validity bitmap, all values are valid
+		array_data->buffers.push_back(nullptr);
+
+		if constexpr (std::is_same_v<U, std::string>) {
+			size_t total_size = 0;
+			for (const std::string& value : column) {
+				total_size += value.size();
+			}
+			array_data->owned_buffers.reserve(2);
+			auto& data = array_data->owned_buffers.emplace_back(total_size);
+			auto write_offsets = [&]<typename Offset>(Offset) {
+				auto& offsets = array_data->owned_buffers.emplace_back((column.size() + 1) * sizeof(Offset));
+				Offset offset = 0;
+				for (size_t i = 0; i < column.size(); i++) {
+					std::memcpy(offsets.data() + i * sizeof(Offset), &offset, sizeof(Offset));
+					std::copy(column[i].begin(), column[i].end(), (char *) data.data() + offset);
+					offset += Offset(column[i].size());
+				}
+				std::memcpy(offsets.data() + column.size() * sizeof(Offset), &offset, sizeof(Offset));
+			};
+			if (total_size <= size_t(std::numeric_limits<int32_t>::max())) {
+				schema_data->format = "u";
+				write_offsets(int32_t());
+			}
+			else {
+				schema_data->format = "U";
+				write_offsets(int64_t());
+			}
+			array_data->buffers.push_back(array_data->owned_buffers[1].data());
+			array_data->buffers.push_back(array_data->owned_buffers[0].data());
+		}
+		else if constexpr (std::is_same_v<U, bool>) {
+			schema_data->format = "b";
+			if constexpr (requires { column.words(); } && std::endian::native == std::endian::little) {
+				// Packed bits already have the layout of an Arrow bitmap
+				array_data->buffers.push_back(column.words().data());
+			}
+			else {
+				array_data->buffers.push_back(array_data->owned_buffers.emplace_back(make_arrow_bitmap(column)).data());
+			}
+		}
+		else {
+			schema_data->format = arrow_primitive_format<U>();
+			if constexpr (contiguous_column<Column>) {
+				array_data->buffers.push_back(column.data());
+			}
+			else {
+				auto& values = array_data->owned_buffers.emplace_back(column.size() * sizeof(U));
+				std::copy(column.begin(), column.end(), reinterpret_cast<U *>(values.data()));
+				array_data->buffers.push_back(values.data());
+			}
+		}
+
+		make_arrow_schema(schema, std::move(schema_data), 0);
+		make_arrow_array(array, std::move(array_data), column.size());
+	}
+
+	/// Whether the value at `index` of an Arrow array is null, taking its offset into account
+	inline bool arrow_is_null(const ArrowArray *array, size_t index) {
+		if (array->null_count == 0 || array->n_buffers == 0 || array->buffers[0] == nullptr) {
+			return false;
+		}
+		size_t bit = size_t(array->offset) + index;
+		auto *validity = static_cast<const std::uint8_t *>(array->buffers[0]);
+		return (validity[bit / 8] & (1 << (bit % 8))) == 0;
+	}
+
+	/**
+	 * Copy `count` values from an Arrow array into a column of U from index `first` of the array, checking its format.
+	 * Null values are imported as value-initialized values.
+	 */
+	template<typename U, typename Column>
+	void import_arrow_column(const ArrowArray *array, const ArrowSchema *schema, size_t first, const Column& column, std::string_view name) {
+		std::string_view format = schema->format;
+		size_t count = column.size();
+		size_t start = size_t(array->offset) + first;
+		if (size_t(array->length) < first + count) {
+			throw std::runtime_error("Arrow array for field '" + std::string(name) + "' is too short");
+		}
+
+		if constexpr (std::is_same_v<U, std::string>) {
+			auto read_values = [&]<typename Offset>(Offset) {
+				auto *offsets = static_cast<const Offset *>(array->buffers[1]);
+				auto *data = static_cast<const char *>(array->buffers[2]);
+				for (size_t i = 0; i < count; i++) {
+					if (arrow_is_null(array, first + i)) {
+						column[i] = std::string();
+					}
+					else {
+						column[i].assign(data + offsets[start + i], size_t(offsets[start + i + 1] - offsets[start + i]));
+					}
+				}
+			};
+			if (format == "u") {
+				read_values(int32_t());
+			}
+			else if (format == "U") {
+				read_values(int64_t());
+			}
+			else {
+				throw std::runtime_error("Arrow array for field '" + std::string(name) + "' is not a string array");
+			}
+		}
+		else {
+			const char *expected_format = std::is_same_v<U, bool> ? "b" : arrow_primitive_format<U>();
+			if (format != expected_format) {
+				throw std::runtime_error("Arrow array for field '" + std::string(name) + "' has format '" + std::string(format) + "', expected '" + expected_format + "'");
+			}
+			if constexpr (std::is_same_v<U, bool>) {
+				auto *bitmap = static_cast<const std::uint8_t *>(array->buffers[1]);
+				for (size_t i = 0; i < count; i++) {
+					size_t bit = start + i;
+					column[i] = !arrow_is_null(array, first + i) && (bitmap[bit / 8] & (1 << (bit % 8))) != 0;
+				}
+			}
+			else {
+				auto *values = static_cast<const U *>(array->buffers[1]) + start;
+				if constexpr (contiguous_column<Column>) {
+					// Empty arrays may have null buffers, that memcpy must not be given
+					if (count > 0) {
+						std::memcpy(column.data(), values, count * sizeof(U));
+					}
+				}
+				else {
+					std::copy_n(values, count, column.begin());
+				}
+				if (array->null_count != 0) {
+					for (size_t i = 0; i < count; i++) {
+						if (arrow_is_null(array, first + i)) {
+							column[i] = U();
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Export a SoA as an Arrow struct array (a record batch) with one child array per field, named after the fields,
+ * through the Arrow C Data Interface. Fields must be arithmetic types, `bool` or `std::string`.
+ *
+ * Contiguous numeric field arrays are shared without copying, so `source` must outlive the exported array
+ * and its field arrays must not be reallocated until the array is released.
+ * Packed bool fields (see `packed_bool_storage`) are shared too on little-endian targets,
+ * other bool fields and strings are converted into buffers owned by the array.
+ *
+ * @code
+ * ArrowArray array;
+ * ArrowSchema schema;
+ * soa::to_arrow(particles, &array, &schema);
+ * auto batch = arrow::ImportRecordBatch(&array, &schema);
+ * @endcode
+ */
+template<typename T, typename Allocator, typename Storage>
+void to_arrow(const soa<T, Allocator, Storage>& source, ArrowArray *out_array, ArrowSchema *out_schema) {
+	auto schema_data = std::make_unique<detail::arrow_schema_data>();
+	schema_data->format = "+s";
+	schema_data->children.resize(reflect::size<T>());
+	auto array_data = std::make_unique<detail::arrow_array_data>();
+	// No validity bitmap for the struct array
+	array_data->buffers.push_back(nullptr);
+	array_data->children.resize(reflect::size<T>());
+	try {
+		reflect::for_each<T>([&](auto I) {
+			using U = detail::field_type<I, T>;
+			static_assert(detail::arrow_field<U>, "Only arithmetic, bool and std::string fields can be exported to Arrow");
+			schema_data->children[I].release = nullptr;
+			array_data->children[I].release = nullptr;
+			detail::export_arrow_column<U>(source.template field<I>(), reflect::member_name<I, T>(), &array_data->children[I], &schema_data->children[I]);
+		});
+	}
+	catch (...) {
+		// Release the children exported so far
+		for (size_t i = 0; i < reflect::size<T>(); i++) {
+			if (schema_data->children[i].release != nullptr) {
+				schema_data->children[i].release(&schema_data->children[i]);
+			}
+			if (array_data->children[i].release != nullptr) {
+				array_data->children[i].release(&array_data->children[i]);
+			}
+		}
+		throw;
+	}
+	detail::make_arrow_schema(out_schema, std::move(schema_data), 0);
+	detail::make_arrow_array(out_array, std::move(array_data), source.size());
+}
+
+/**
+ * Import an Arrow struct array (a record batch) into a new SoA, matching child arrays to fields by name.
+ * Child arrays not matching any field are ignored, and null values are imported as value-initialized values.
+ * The array is only read, it must still be released by the caller.
+ * Throws std::runtime_error if a field is missing or has a different type.
+ *
+ * @code
+ * ArrowArray array;
+ * ArrowSchema schema;
+ * arrow::ExportRecordBatch(*batch, &array, &schema);
+ * auto particles = soa::from_arrow<soa::soa<Particle>>(&array, &schema);
+ * @endcode
+ */
+template<typename SoA>
+SoA from_arrow(const ArrowArray *array, const ArrowSchema *schema, const typename SoA::allocator_type& alloc = typename SoA::allocator_type()) {
+	using T = typename SoA::value_type;
+	if (std::string_view(schema->format) != "+s" || array->n_children != schema->n_children) {
+		throw std::runtime_error("Arrow array is not a struct array");
+	}
+	SoA result(alloc);
+	result.resize(size_t(array->length));
+	reflect::for_each<T>([&](auto I) {
+		using U = detail::field_type<I, T>;
+		static_assert(detail::arrow_field<U>, "Only arithmetic, bool and std::string fields can be imported from Arrow");
+		std::string_view name = reflect::member_name<I, T>();
+		auto children = std::span(schema->children, size_t(schema->n_children));
+		auto child = std::find_if(children.begin(), children.end(), [&](const ArrowSchema *child) {
+			return child->name != nullptr && child->name == name;
+		});
+		if (child == children.end()) {
+			throw std::runtime_error("Arrow array has no field named '" + std::string(name) + "'");
+		}
+		size_t index = child - children.begin();
+		detail::import_arrow_column<U>(array->children[index], *child, size_t(array->offset), result.template field<I>(), name);
+	});
+	return result;
+}
+
+}
+
+#endif // __SOA_ARROW_HPP__
@@ -0,0 +1,327 @@
+#ifndef __SOA_DEVICE_HPP__
+#define __SOA_DEVICE_HPP__
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#ifdef SOA_CUDA
+#include <cuda_runtime_api.h>
+#endif
+
+#if __has_include(<sys/mman.h>) && __has_include(<unistd.h>)
+#include <sys/mman.h>
+#include <unistd.h>
+#define SOA_HAS_MLOCK 1
+#endif
+
+#include "soa.hpp"
+
+namespace soa {
+
+namespace detail {
+#ifdef SOA_CUDA
+	/// Throw std::runtime_error if a CUDA runtime call failed
+	inline void check_cuda(cudaError_t error, const char *call) {
+		if (error != cudaSuccess) {
+			throw std::runtime_error(std::string(call) + " failed: " + cudaGetErrorString(error));
+		}
+	}
+#endif
+
+	/// Size of a memory page, the granularity of page locking
+	inline size_t page_size() {
+#ifdef SOA_HAS_MLOCK
+		static const size_t size = size_t(sysconf(_SC_PAGESIZE));
+		return size;
+#else
+		return 4096;
+#endif
+	}
+}
+
+/**
+ * Allocator of page-locked (pinned) host memory, that devices can read by DMA without going through a staging buffer.
+ * With SOA_CUDA defined, memory comes from `cudaMallocHost`.
+ * Otherwise, allocations are page aligned and locked with `mlock` on POSIX systems, on a best effort basis:
+ * if locking fails, for example past RLIMIT_MEMLOCK, the memory is still returned, unlocked.
+ *
+ * Columns of a `soa` using it are pinned, in one allocation per field, or a single one with `block_storage`.
+ *
+ * @code
+ * soa::soa<Particle, soa::pinned_allocator<Particle>> particles;
+ * @endcode
+ */
+template<typename T>
+struct pinned_allocator {
+	using value_type = T;
+
+	pinned_allocator() = default;
+	template<typename U>
+	pinned_allocator(const pinned_allocator<U>&) noexcept {}
+
+	T *allocate(size_t n) {
+		if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+			throw std::bad_array_new_length();
+		}
+#ifdef SOA_CUDA
+		void *pointer = nullptr;
+		if (cudaMallocHost(&pointer, n * sizeof(T)) != cudaSuccess) {
+			throw std::bad_alloc();
+		}
+#else
+		void *pointer = ::operator new(n * sizeof(T), alignment());
+#ifdef SOA_HAS_MLOCK
+		mlock(pointer, n * sizeof(T));
+#endif
+#endif
+		return static_cast<T *>(pointer);
+	}
+
+	void deallocate(T *pointer, size_t n) noexcept {
+#ifdef SOA_CUDA
+		(void) n;
+		cudaFreeHost(pointer);
+#else
+#ifdef SOA_HAS_MLOCK
+		munlock(pointer, n * sizeof(T));
+#else
+		(void) n;
+#endif
+		::operator delete(pointer, alignment());
+#endif
+	}
+
+	template<typename U>
+	bool operator==(const pinned_allocator<U>&) const noexcept {
+		return true;
+	}
+
+private:
+	static std::align_val_t alignment() {
+		return std::align_val_t(std::max(alignof(T), detail::page_size()));
+	}
+};
+
+/**
+ * Device of `device_mirror` whose memory is ordinary host memory, copied synchronously.
+ * It can keep a snapshot of some columns, and defines the members that other devices provide:
+ * - `allocate(bytes)` and `deallocate(pointer, bytes)`, for device memory;
+ * - `copy(destination, source, bytes)`, that starts copying host memory to device memory;
+ * - `synchronize()`, that waits for all started copies.
+ */
+struct host_device {
+	void *allocate(size_t bytes) {
+		return ::operator new(bytes, std::align_val_t(alignment));
+	}
+	void deallocate(void *pointer, size_t) noexcept {
+		::operator delete(pointer, std::align_val_t(alignment));
+	}
+	void copy(void *destination, const void *source, size_t bytes) {
+		std::memcpy(destination, source, bytes);
+	}
+	void synchronize() {}
+
+private:
+	static constexpr size_t alignment = 64;
+};
+
+#ifdef SOA_CUDA
+/**
+ * Device of `device_mirror` that is the current CUDA device, with asynchronous copies on `stream`.
+ * Copies only overlap with host work when source columns are in pinned memory, see `pinned_allocator`.
+ */
+class cuda_device {
+public:
+	explicit cuda_device(cudaStream_t stream = nullptr) : stream(stream) {}
+
+	cudaStream_t get_stream() const {
+		return stream;
+	}
+
+	void *allocate(size_t bytes) {
+		void *pointer = nullptr;
+		detail::check_cuda(cudaMalloc(&pointer, bytes), "cudaMalloc");
+		return pointer;
+	}
+	void deallocate(void *pointer, size_t) noexcept {
+		cudaFree(pointer);
+	}
+	void copy(void *destination, const void *source, size_t bytes) {
+		detail::check_cuda(cudaMemcpyAsync(destination, source, bytes, cudaMemcpyHostToDevice, stream), "cudaMemcpyAsync");
+	}
+	void synchronize() {
+		detail::check_cuda(cudaStreamSynchronize(stream), "cudaStreamSynchronize");
+	}
+
+private:
+	cudaStream_t stream;
+};
+#endif
+
+/**
+ * Copy of some fields of a SoA of T in the memory of `Device`, updated column by column straight from the SoA storage.
+ * Uploading a `soa` copies whole columns, while uploading a `tracked_soa` only copies its dirty ranges of the mirrored fields, then clears them.
+ * Copies may be asynchronous, like with `cuda_device`: the source must not be modified until `synchronize` returns.
+ * Mirrored fields must be trivially copyable and stored in contiguous arrays.
+ *
+ * @code
+ * soa::device_mirror<Particle, soa::cuda_device, "x", "y"> mirror(soa::cuda_device(stream));
+ * mirror.upload(particles);
+ * kernel<<<blocks, threads, 0, stream>>>(mirror.data<"x">(), mirror.data<"y">(), mirror.size());
+ * @endcode
+ */
+template<typename T, typename Device, reflect::fixed_string... FieldNames>
+class device_mirror {
+	static_assert(sizeof...(FieldNames) > 0, "At least one field must be mirrored");
+
+	static constexpr size_t field_count = sizeof...(FieldNames);
+	static constexpr std::array<size_t, field_count> indices { reflect::index_of<FieldNames, T>()... };
+	static_assert(detail::distinct_indices<reflect::index_of<FieldNames, T>()...>(), "Fields must be mirrored exactly once");
+
+	template<size_t K>
+	using column_type = detail::field_type<indices[K], T>;
+
+public:
+	explicit device_mirror(Device device = Device()) : device(std::move(device)) {}
+	device_mirror(const device_mirror&) = delete;
+	device_mirror& operator=(const device_mirror&) = delete;
+	~device_mirror() {
+		release();
+	}
+
+	Device& get_device() {
+		return device;
+	}
+
+	/// Number of rows uploaded
+	size_t size() const {
+		return count;
+	}
+	/// Number of rows that fit in the device buffers
+	size_t capacity() const {
+		return row_capacity;
+	}
+
+	/// Device pointer to the column of the mirrored field `FieldName`
+	template<reflect::fixed_string FieldName>
+	auto *data() const {
+		constexpr size_t K = mirror_index<FieldName>();
+		return static_cast<column_type<K> *>(buffers[K]);
+	}
+
+	/// Copy the mirrored columns of `source` to the device
+	template<typename Allocator, typename Storage>
+	void upload(const soa<T, Allocator, Storage>& source) {
+		reserve(source.size());
+		count = source.size();
+		for_each_column([&](auto K) {
+			upload_rows<K>(source.template field<indices[K]>(), 0, count);
+		});
+	}
+
+	/// Copy the dirty ranges of the mirrored columns of `source` to the device, and clear them
+	template<typename Allocator, typename Storage, size_t ChunkSize>
+	void upload(tracked_soa<T, Allocator, Storage, ChunkSize>& source) {
+		bool reallocated = reserve(source.size());
+		count = source.size();
+		for_each_column([&](auto K) {
+			auto column = source.template field<indices[K]>();
+			if (reallocated) {
+				// Device buffers are new, so all rows are uploaded
+				upload_rows<K>(column, 0, count);
+			}
+			else {
+				for (auto range : source.template dirty_ranges<indices[K]>()) {
+					upload_rows<K>(column, range.first, range.last);
+				}
+			}
+			source.template clear_dirty<indices[K]>();
+		});
+	}
+
+	/// Wait for all uploads to complete
+	void synchronize() {
+		device.synchronize();
+	}
+
+private:
+	Device device;
+	std::array<void *, field_count> buffers {};
+	size_t row_capacity = 0;
+	size_t count = 0;
+
+	template<reflect::fixed_string FieldName>
+	static constexpr size_t mirror_index() {
+		constexpr size_t index = reflect::index_of<FieldName, T>();
+		static_assert(std::find(indices.begin(), indices.end(), index) != indices.end(), "Field is not mirrored");
+		return std::find(indices.begin(), indices.end(), index) - indices.begin();
+	}
+
+	template<typename Fn>
+	static void for_each_column(Fn&& fn) {
+		[&]<size_t... K>(std::index_sequence<K...>) {
+			(fn(std::integral_constant<size_t, K>()), ...);
+		}(std::make_index_sequence<field_count>{});
+	}
+
+	/**
+	 * Grow device buffers to fit `rows`, losing their contents, and return whether they were reallocated.
+	 * If an allocation throws, the buffers allocated so far are freed and the mirror is left empty.
+	 */
+	bool reserve(size_t rows) {
+		if (rows <= row_capacity) {
+			return false;
+		}
+		size_t new_capacity = std::max(rows, row_capacity * 2);
+		release();
+		std::array<void *, field_count> allocated {};
+		try {
+			for_each_column([&](auto K) {
+				allocated[K] = device.allocate(new_capacity * sizeof(column_type<K>));
+			});
+		}
+		catch (...) {
+			for_each_column([&](auto K) {
+				if (allocated[K]) {
+					device.deallocate(allocated[K], new_capacity * sizeof(column_type<K>));
+				}
+			});
+			throw;
+		}
+		buffers = allocated;
+		row_capacity = new_capacity;
+		return true;
+	}
+
+	void release() {
+		for_each_column([&](auto K) {
+			if (buffers[K]) {
+				device.deallocate(buffers[K], row_capacity * sizeof(column_type<K>));
+				buffers[K] = nullptr;
+			}
+		});
+		row_capacity = 0;
+		count = 0;
+	}
+
+	template<size_t K, typename Column>
+	void upload_rows(const Column& column, size_t first, size_t last) {
+		static_assert(std::is_trivially_copyable_v<column_type<K>>, "Mirrored fields must be trivially copyable");
+		static_assert(detail::contiguous_column<Column>, "Mirrored fields must be stored in contiguous arrays");
+		if (first < last) {
+			device.copy(static_cast<column_type<K> *>(buffers[K]) + first, column.data() + first, (last - first) * sizeof(column_type<K>));
+		}
+	}
+};
+
+}
+
+#endif // __SOA_DEVICE_HPP__
@@ -0,0 +1,603 @@
+#ifndef __SOA_IO_HPP__
+#define __SOA_IO_HPP__
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if __has_include(<sys/mman.h>)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#define SOA_HAS_MMAP 1
+#endif
+
+#include "soa.hpp"
+
+namespace soa {
+
+namespace detail {
+	/**
+	 * Column-oriented binary format written by `soa::write`:
+	 * a `file_header`, one `column_header` per field, the field names, then the field arrays.
+	 * Each array starts at a `file_alignment` byte boundary, so that mapped files can be used in place.
+	 * Values are stored with the native byte order, checked by `file_header::byte_order`.
+	 */
+	inline constexpr char file_magic[8] = { 's', 'o', 'a', '.', 'h', 'p', 'p', '\0' };
+	/// Streams written by `soa_writer` start with their own magic, followed by headers without array offsets and by row groups
+	inline constexpr char stream_magic[8] = { 's', 'o', 'a', '.', 'h', 'p', 'p', '>' };
+	inline constexpr std::uint32_t file_version = 1;
+	inline constexpr std::uint32_t file_byte_order = 0x01020304;
+	inline constexpr size_t file_alignment = 64;
+
+	struct file_header {
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t byte_order;
+		std::uint64_t size;
+		std::uint64_t column_count;
+	};
+
+	struct column_header {
+		std::uint64_t offset;
+		std::uint64_t element_size;
+		std::uint64_t name_offset;
+		std::uint64_t name_size;
+	};
+
+	/// Read the I-th column header from the headers at the start of a file
+	inline column_header get_column_header(std::span<const std::byte> headers, size_t index) {
+		column_header column;
+		std::memcpy(&column, headers.data() + sizeof(file_header) + index * sizeof(column), sizeof(column));
+		return column;
+	}
+
+	/// Whether all fields of T can be stored as raw bytes
+	template<typename T>
+	constexpr bool trivially_copyable_fields = []<auto... Ns>(std::index_sequence<Ns...>) {
+		return (std::is_trivially_copyable_v<field_type<Ns, T>> && ...);
+	}(std::make_index_sequence<reflect::size<T>()>{});
+
+	/// Size of the headers and names of the file for T
+	template<typename T>
+	constexpr size_t file_header_size() {
+		size_t result = sizeof(file_header) + reflect::size<T>() * sizeof(column_header);
+		reflect::for_each<T>([&](auto I) {
+			result += reflect::member_name<I, T>().size();
+		});
+		return result;
+	}
+
+	/// Headers of the file for a SoA of T with `size` elements
+	template<typename T>
+	std::pair<file_header, std::array<column_header, reflect::size<T>()>> make_file_headers(size_t size) {
+		file_header header {};
+		std::copy(std::begin(file_magic), std::end(file_magic), header.magic);
+		header.version = file_version;
+		header.byte_order = file_byte_order;
+		header.size = size;
+		header.column_count = reflect::size<T>();
+
+		std::array<column_header, reflect::size<T>()> columns {};
+		size_t name_offset = sizeof(file_header) + columns.size() * sizeof(column_header);
+		size_t offset = file_header_size<T>();
+		reflect::for_each<T>([&](auto I) {
+			offset = align_up(offset, file_alignment);
+			columns[I].offset = offset;
+			columns[I].element_size = sizeof(field_type<I, T>);
+			columns[I].name_offset = name_offset;
+			columns[I].name_size = reflect::member_name<I, T>().size();
+			offset += size * sizeof(field_type<I, T>);
+			name_offset += columns[I].name_size;
+		});
+		return { header, columns };
+	}
+
+	/**
+	 * Check that headers read from a file or stream describe a SoA of T, with field names matching T's, and return the file header.
+	 * `headers` holds the data from its start up to at least the end of the field names.
+	 * Throws std::runtime_error if they don't match.
+	 */
+	template<typename T>
+	file_header check_field_headers(std::span<const std::byte> headers, const char (&magic)[8]) {
+		file_header header;
+		if (headers.size() < sizeof(header)) {
+			throw std::runtime_error("Truncated SoA file header");
+		}
+		std::memcpy(&header, headers.data(), sizeof(header));
+		if (!std::equal(std::begin(magic), std::end(magic), header.magic)) {
+			throw std::runtime_error("Not a SoA file");
+		}
+		if (header.version != file_version || header.byte_order != file_byte_order) {
+			throw std::runtime_error("Unsupported SoA file version or byte order");
+		}
+		if (header.column_count != reflect::size<T>() || headers.size() < file_header_size<T>()) {
+			throw std::runtime_error("SoA file has a different number of fields");
+		}
+		reflect::for_each<T>([&](auto I) {
+			column_header column = get_column_header(headers, I);
+			std::string_view name = reflect::member_name<I, T>();
+			if (column.element_size != sizeof(field_type<I, T>)
+				|| column.name_size != name.size()
+				|| column.name_offset > headers.size() - name.size()
+				|| std::string_view((const char *) headers.data() + column.name_offset, name.size()) != name)
+			{
+				throw std::runtime_error("SoA file field " + std::to_string(I) + " doesn't match '" + std::string(name) + "'");
+			}
+		});
+		return header;
+	}
+
+	/// Like `check_field_headers`, also checking that the field arrays are in order, aligned and end before `file_size`
+	template<typename T>
+	file_header check_file_headers(std::span<const std::byte> headers, std::uint64_t file_size) {
+		file_header header = check_field_headers<T>(headers, file_magic);
+		std::uint64_t end = file_header_size<T>();
+		reflect::for_each<T>([&](auto I) {
+			column_header column = get_column_header(headers, I);
+			if (column.offset < end || column.offset % file_alignment != 0 || column.offset > file_size
+				|| header.size > (file_size - column.offset) / column.element_size)
+			{
+				throw std::runtime_error("SoA file field '" + std::string(reflect::member_name<I, T>()) + "' is out of bounds");
+			}
+			end = column.offset + header.size * column.element_size;
+		});
+		return header;
+	}
+
+	inline void write_padding(std::ostream& out, size_t count) {
+		static constexpr char zeros[file_alignment] = {};
+		out.write(zeros, std::streamsize(count));
+	}
+
+	/// Write `count` values of a column from `first` as raw bytes, copying non-contiguous columns through a buffer
+	template<typename U, typename Column>
+	void write_column(std::ostream& out, const Column& column, size_t first, size_t count) {
+		if constexpr (contiguous_column<Column>) {
+			out.write((const char *) (column.data() + first), std::streamsize(count * sizeof(U)));
+		}
+		else if constexpr (tiled_column<Column>) {
+			constexpr size_t N = Column::tile_size;
+			for (size_t index = first; index < first + count; index = (index / N + 1) * N) {
+				size_t tile_end = std::min(first + count, (index / N + 1) * N);
+				write_column<U>(out, column.tile(index / N), index % N, tile_end - index);
+			}
+		}
+		else {
+			std::array<U, 1024> buffer;
+			for (size_t index = first; index < first + count; index += buffer.size()) {
+				size_t n = std::min(buffer.size(), first + count - index);
+				std::copy_n(column.begin() + index, n, buffer.begin());
+				out.write((const char *) buffer.data(), std::streamsize(n * sizeof(U)));
+			}
+		}
+	}
+
+	/// Read raw bytes into `count` values of a column from `first`, the counterpart of `write_column`
+	template<typename U, typename Column>
+	void read_column(std::istream& in, const Column& column, size_t first, size_t count) {
+		if constexpr (contiguous_column<Column>) {
+			in.read((char *) (column.data() + first), std::streamsize(count * sizeof(U)));
+		}
+		else if constexpr (tiled_column<Column>) {
+			constexpr size_t N = Column::tile_size;
+			for (size_t index = first; index < first + count; index = (index / N + 1) * N) {
+				size_t tile_end = std::min(first + count, (index / N + 1) * N);
+				read_column<U>(in, column.tile(index / N), index % N, tile_end - index);
+			}
+		}
+		else {
+			std::array<U, 1024> buffer;
+			for (size_t index = first; index < first + count; index += buffer.size()) {
+				size_t n = std::min(buffer.size(), first + count - index);
+				in.read((char *) buffer.data(), std::streamsize(n * sizeof(U)));
+				std::copy_n(buffer.begin(), n, column.begin() + index);
+			}
+		}
+	}
+}
+
+/**
+ * Write the fields of a SoA of T to `out`, one array after the other, in the format read by `soa::read` and `soa_mapped`.
+ * All fields must be trivially copyable. The stream should be opened in binary mode.
+ *
+ * @code
+ * std::ofstream out("particles.soa", std::ios::binary);
+ * soa::write(out, particles);
+ * @endcode
+ */
+template<typename T, typename Allocator, typename Storage>
+void write(std::ostream& out, const soa<T, Allocator, Storage>& source) {
+	static_assert(detail::trivially_copyable_fields<T>, "Only SoAs with trivially copyable fields can be written");
+	auto [header, columns] = detail::make_file_headers<T>(source.size());
+	out.write((const char *) &header, sizeof(header));
+	out.write((const char *) columns.data(), std::streamsize(columns.size() * sizeof(detail::column_header)));
+	size_t offset = detail::file_header_size<T>();
+	reflect::for_each<T>([&](auto I) {
+		std::string_view name = reflect::member_name<I, T>();
+		out.write(name.data(), std::streamsize(name.size()));
+	});
+	reflect::for_each<T>([&](auto I) {
+		detail::write_padding(out, columns[I].offset - offset);
+		detail::write_column<detail::field_type<I, T>>(out, source.template field<I>(), 0, source.size());
+		offset = columns[I].offset + source.size() * columns[I].element_size;
+	});
+}
+
+/**
+ * Read a SoA written by `soa::write` from `in`, copying each field array at once.
+ * Rows are added in bounded steps while reading the first field array, so a corrupted size in the header
+ * fails once the stream ends instead of allocating the rows it claims up front.
+ * Throws std::runtime_error if the data doesn't describe a SoA of the same type, with the same field names,
+ * or if the stream ends early.
+ *
+ * @code
+ * std::ifstream in("particles.soa", std::ios::binary);
+ * auto particles = soa::read<soa::soa<Particle>>(in);
+ * @endcode
+ */
+template<typename SoA>
+SoA read(std::istream& in, const typename SoA::allocator_type& alloc = typename SoA::allocator_type()) {
+	using T = typename SoA::value_type;
+	static_assert(detail::trivially_copyable_fields<T>, "Only SoAs with trivially copyable fields can be read");
+	std::vector<std::byte> headers(detail::file_header_size<T>());
+	in.read((char *) headers.data(), std::streamsize(headers.size()));
+	if (!in) {
+		throw std::runtime_error("Truncated SoA file header");
+	}
+	detail::file_header header = detail::check_file_headers<T>(headers, std::numeric_limits<std::uint64_t>::max());
+	SoA result(alloc);
+	std::uint64_t offset = headers.size();
+	reflect::for_each<T>([&](auto I) {
+		detail::column_header column = detail::get_column_header(headers, I);
+		in.ignore(std::streamsize(column.offset - offset));
+		if constexpr (I == 0) {
+			constexpr size_t read_step = size_t(1) << 16;
+			for (size_t first = 0; first < header.size; first += read_step) {
+				size_t count = std::min<std::uint64_t>(read_step, header.size - first);
+				result.resize(first + count);
+				detail::read_column<detail::field_type<I, T>>(in, result.template field<I>(), first, count);
+				if (!in) {
+					throw std::runtime_error("Truncated SoA file");
+				}
+			}
+		}
+		else {
+			detail::read_column<detail::field_type<I, T>>(in, result.template field<I>(), 0, header.size);
+		}
+		offset = column.offset + header.size * column.element_size;
+	});
+	if (!in) {
+		throw std::runtime_error("Truncated SoA file");
+	}
+	return result;
+}
+
+/**
+ * Streaming writer of SoAs of T, in row groups of up to `row_group_size` elements read by `soa_reader`.
+ * The stream starts with the field names and sizes, then each row group holds its row count and the values of each field, one after the other.
+ * Rows are buffered until a row group is full, `flush` writes a partial row group and `close` writes the end of the stream.
+ * All fields must be trivially copyable.
+ *
+ * @code
+ * soa::soa_writer<Sample> writer(socket_stream);
+ * writer.write(samples);
+ * writer.push_back(sample);
+ * writer.close();
+ * @endcode
+ */
+template<typename T>
+class soa_writer {
+	static_assert(detail::trivially_copyable_fields<T>, "Only SoAs with trivially copyable fields can be written");
+
+public:
+	explicit soa_writer(std::ostream& out, size_t row_group_size = 65536)
+		: out(out)
+		, row_group_size(std::max<size_t>(row_group_size, 1))
+	{
+		auto [header, columns] = detail::make_file_headers<T>(this->row_group_size);
+		std::copy(std::begin(detail::stream_magic), std::end(detail::stream_magic), header.magic);
+		for (auto& column : columns) {
+			column.offset = 0;
+		}
+		out.write((const char *) &header, sizeof(header));
+		out.write((const char *) columns.data(), std::streamsize(columns.size() * sizeof(detail::column_header)));
+		reflect::for_each<T>([&](auto I) {
+			std::string_view name = reflect::member_name<I, T>();
+			out.write(name.data(), std::streamsize(name.size()));
+		});
+	}
+	soa_writer(const soa_writer&) = delete;
+	soa_writer& operator=(const soa_writer&) = delete;
+	/// Calls `close`, ignoring exceptions
+	~soa_writer() {
+		try {
+			close();
+		}
+		catch (...) {
+		}
+	}
+
+	/// Buffer `value`, writing a row group when full
+	void push_back(const T& value) {
+		pending.push_back(value);
+		if (pending.size() == row_group_size) {
+			write_row_group(pending, 0, pending.size());
+			pending.clear();
+		}
+	}
+
+	/// Write the elements of `rows`, full row groups being written straight from its field arrays
+	template<typename Allocator, typename Storage>
+	void write(const soa<T, Allocator, Storage>& rows) {
+		size_t first = 0;
+		if (!pending.empty()) {
+			first = std::min(row_group_size - pending.size(), rows.size());
+			pending.insert(pending.end(), rows.begin(), rows.begin() + first);
+			if (pending.size() == row_group_size) {
+				write_row_group(pending, 0, pending.size());
+				pending.clear();
+			}
+		}
+		for ( ; rows.size() - first >= row_group_size; first += row_group_size) {
+			write_row_group(rows, first, row_group_size);
+		}
+		pending.insert(pending.end(), rows.begin() + first, rows.end());
+	}
+
+	/// Write the buffered elements as a row group, if any, and flush the stream
+	void flush() {
+		if (!pending.empty()) {
+			write_row_group(pending, 0, pending.size());
+			pending.clear();
+		}
+		out.flush();
+	}
+
+	/// Flush and write the end of the stream. Nothing may be written afterwards.
+	void close() {
+		if (!closed) {
+			closed = true;
+			std::uint64_t end = 0;
+			if (!pending.empty()) {
+				write_row_group(pending, 0, pending.size());
+				pending.clear();
+			}
+			out.write((const char *) &end, sizeof(end));
+			out.flush();
+		}
+	}
+
+private:
+	std::ostream& out;
+	size_t row_group_size;
+	soa<T> pending;
+	bool closed = false;
+
+	template<typename Rows>
+	void write_row_group(const Rows& rows, size_t first, size_t count) {
+		std::uint64_t rows_count = count;
+		out.write((const char *) &rows_count, sizeof(rows_count));
+		reflect::for_each<T>([&](auto I) {
+			detail::write_column<detail::field_type<I, T>>(out, rows.template field<I>(), first, count);
+		});
+	}
+};
+
+/**
+ * Streaming reader of SoAs of T written by `soa_writer`.
+ * Each `read` appends the next row group to a SoA, one whole field array at a time,
+ * so that memory use is bounded by the row group size.
+ *
+ * @code
+ * soa::soa_reader<Sample> reader(socket_stream);
+ * while (reader.read(samples) > 0) {
+ *     process(samples);
+ * }
+ * @endcode
+ */
+template<typename T>
+class soa_reader {
+	static_assert(detail::trivially_copyable_fields<T>, "Only SoAs with trivially copyable fields can be read");
+
+public:
+	/// Read the stream header. Throws std::runtime_error if it doesn't describe a SoA of T.
+	explicit soa_reader(std::istream& in)
+		: in(in)
+	{
+		std::vector<std::byte> headers(detail::file_header_size<T>());
+		in.read((char *) headers.data(), std::streamsize(headers.size()));
+		if (!in) {
+			throw std::runtime_error("Truncated SoA stream header");
+		}
+		row_group_size = detail::check_field_headers<T>(headers, detail::stream_magic).size;
+	}
+
+	/// Maximum number of elements in a row group, as given to the writer
+	size_t max_row_group_size() const {
+		return row_group_size;
+	}
+
+	/// Whether the end of the stream was read
+	bool done() const {
+		return finished;
+	}
+
+	/**
+	 * Append the next row group to `target` and return its number of elements, 0 at the end of the stream.
+	 * Throws std::runtime_error if the stream ends early, leaving `target` unchanged.
+	 */
+	template<typename Allocator, typename Storage>
+	size_t read(soa<T, Allocator, Storage>& target) {
+		if (finished) {
+			return 0;
+		}
+		std::uint64_t count = 0;
+		in.read((char *) &count, sizeof(count));
+		if (!in || count > row_group_size) {
+			throw std::runtime_error("Invalid SoA stream row group");
+		}
+		if (count == 0) {
+			finished = true;
+			return 0;
+		}
+		size_t first = target.size();
+		target.resize(first + count);
+		reflect::for_each<T>([&](auto I) {
+			detail::read_column<detail::field_type<I, T>>(in, target.template field<I>(), first, count);
+		});
+		if (!in) {
+			target.resize(first);
+			throw std::runtime_error("Truncated SoA stream row group");
+		}
+		return count;
+	}
+
+private:
+	std::istream& in;
+	size_t row_group_size = 0;
+	bool finished = false;
+};
+
+#ifdef SOA_HAS_MMAP
+/**
+ * Read-only SoA of T backed by a memory mapped file written by `soa::write`.
+ * The file is validated when opened, then `field` returns spans straight into the mapping,
+ * so no field array is parsed nor copied. Only available on POSIX systems.
+ *
+ * @code
+ * soa::soa_mapped<Particle> particles("particles.soa");
+ * std::span<const float> x = particles.field<"x">();
+ * @endcode
+ */
+template<typename T>
+class soa_mapped {
+	static_assert(detail::trivially_copyable_fields<T>, "Only SoAs with trivially copyable fields can be mapped");
+
+public:
+	using value_type = T;
+	using size_type = size_t;
+
+	soa_mapped() = default;
+	/// Map the file at `path`. Throws std::system_error if it can't be mapped, std::runtime_error if it's not valid.
+	explicit soa_mapped(const std::string& path) {
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw std::system_error(errno, std::generic_category(), "Could not open " + path);
+		}
+		struct stat status;
+		if (::fstat(fd, &status) != 0) {
+			int error = errno;
+			::close(fd);
+			throw std::system_error(error, std::generic_category(), "Could not stat " + path);
+		}
+		mapping_size = size_t(status.st_size);
+		if (mapping_size > 0) {
+			void *address = ::mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+			if (address == MAP_FAILED) {
+				int error = errno;
+				::close(fd);
+				throw std::system_error(error, std::generic_category(), "Could not map " + path);
+			}
+			mapping = (const std::byte *) address;
+		}
+		::close(fd);
+		auto bytes = std::span<const std::byte>(mapping, mapping_size);
+		auto headers = bytes.first(std::min(bytes.size(), detail::file_header_size<T>()));
+		try {
+			count = detail::check_file_headers<T>(headers, mapping_size).size;
+		}
+		catch (...) {
+			unmap();
+			throw;
+		}
+		reflect::for_each<T>([&](auto I) {
+			offsets[I] = detail::get_column_header(headers, I).offset;
+		});
+	}
+	soa_mapped(soa_mapped&& other) noexcept
+		: mapping(std::exchange(other.mapping, nullptr))
+		, mapping_size(std::exchange(other.mapping_size, 0))
+		, count(std::exchange(other.count, 0))
+		, offsets(other.offsets)
+	{
+	}
+	soa_mapped& operator=(soa_mapped&& other) noexcept {
+		if (this != &other) {
+			unmap();
+			mapping = std::exchange(other.mapping, nullptr);
+			mapping_size = std::exchange(other.mapping_size, 0);
+			count = std::exchange(other.count, 0);
+			offsets = other.offsets;
+		}
+		return *this;
+	}
+	~soa_mapped() {
+		unmap();
+	}
+
+	size_t size() const {
+		return count;
+	}
+	bool empty() const {
+		return count == 0;
+	}
+
+	/// Construct a value from the fields of the element at `index`
+	T operator[](size_t index) const {
+		return [&]<auto... Ns>(std::index_sequence<Ns...>) {
+			return T(field<Ns>()[index]...);
+		}(std::make_index_sequence<reflect::size<T>()>{});
+	}
+
+	/// Field array inside the mapping, aligned to 64 bytes
+	template<size_t I>
+	std::span<const detail::field_type<I, T>> field() const {
+		using U = detail::field_type<I, T>;
+		if (mapping == nullptr) {
+			return {};
+		}
+		return std::span<const U>(reinterpret_cast<const U *>(mapping + offsets[I]), count);
+	}
+	template<reflect::fixed_string FieldName>
+	auto field() const {
+		return field<reflect::index_of<FieldName, T>()>();
+	}
+	template<typename U>
+	auto field() const {
+		return field<detail::index_of_type<U, T>()>();
+	}
+
+private:
+	const std::byte *mapping = nullptr;
+	size_t mapping_size = 0;
+	size_t count = 0;
+	std::array<std::uint64_t, reflect::size<T>()> offsets {};
+
+	void unmap() {
+		if (mapping != nullptr) {
+			::munmap((void *) mapping, mapping_size);
+			mapping = nullptr;
+		}
+	}
+};
+#endif
+
+}
+
+#endif // __SOA_IO_HPP__
@@ -0,0 +1,115 @@
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <catch2/catch_test_macros.hpp>
+#include <soa_arrow.hpp>
+
+struct Row {
+	std::int32_t id = 0;
+	double value = 0;
+	bool flag = false;
+	std::string name;
+
+	bool operator==(const Row& other) const = default;
+};
+
+template<typename Iterable1, typename Iterable2>
+void REQUIRE_IT_EQUALS(const Iterable1& iterable1, const Iterable2& iterable2) {
+	auto it1 = iterable1.begin();
+	auto it2 = iterable2.begin();
+	for ( ; it1 != iterable1.end() && it2 != iterable2.end(); ++it1, ++it2) {
+		REQUIRE(*it1 == *it2);
+	}
+	REQUIRE(it1 == iterable1.end());
+	REQUIRE(it2 == iterable2.end());
+}
+
+TEST_CASE("to_arrow and from_arrow") {
+	soa::soa<Row> rows;
+	for (int i = 0; i < 100; i++) {
+		rows.push_back(Row(i, i * 0.25, i % 2 == 0, "row " + std::to_string(i)));
+	}
+	ArrowArray array;
+	ArrowSchema schema;
+	soa::to_arrow(rows, &array, &schema);
+
+	SECTION("export") {
+		REQUIRE(std::string_view(schema.format) == "+s");
+		REQUIRE(schema.n_children == 4);
+		REQUIRE(std::string_view(schema.children[0]->name) == "id");
+		REQUIRE(std::string_view(schema.children[0]->format) == "i");
+		REQUIRE(std::string_view(schema.children[1]->format) == "g");
+		REQUIRE(std::string_view(schema.children[2]->format) == "b");
+		REQUIRE(std::string_view(schema.children[3]->format) == "u");
+		REQUIRE(array.length == 100);
+		// Numeric fields are shared without copying
+		REQUIRE(array.children[0]->buffers[1] == rows.field<"id">().data());
+		REQUIRE(array.children[1]->buffers[1] == rows.field<"value">().data());
+		REQUIRE(static_cast<const std::uint8_t *>(array.children[2]->buffers[1])[0] == 0x55);
+		auto *offsets = static_cast<const std::int32_t *>(array.children[3]->buffers[1]);
+		auto *data = static_cast<const char *>(array.children[3]->buffers[2]);
+		REQUIRE(std::string_view(data + offsets[12], offsets[13] - offsets[12]) == "row 12");
+	}
+
+	SECTION("import") {
+		REQUIRE_IT_EQUALS(soa::from_arrow<soa::soa<Row>>(&array, &schema), rows);
+		auto tiled = soa::from_arrow<soa::soa<Row, std::allocator<Row>, soa::tiled_storage<8>>>(&array, &schema);
+		REQUIRE_IT_EQUALS(tiled, rows);
+	}
+
+	SECTION("import with offsets and nulls") {
+		array.offset = 10;
+		array.length = 5;
+		// Element 10 of the id array is null
+		std::uint8_t validity[13] = { 0xff, 0xfb, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+		ArrowArray *id_array = array.children[0];
+		const void *id_buffers[] = { validity, id_array->buffers[1] };
+		const void **original_buffers = std::exchange(id_array->buffers, id_buffers);
+		id_array->null_count = 1;
+		auto imported = soa::from_arrow<soa::soa<Row>>(&array, &schema);
+		id_array->buffers = original_buffers;
+		REQUIRE(imported.size() == 5);
+		REQUIRE(imported[0] == Row(0, 2.5, true, "row 10"));
+		REQUIRE(imported[4] == Row(14, 3.5, true, "row 14"));
+	}
+
+	SECTION("packed bools") {
+		soa::soa<Row, std::allocator<Row>, soa::packed_bool_storage> packed(rows.begin(), rows.end());
+		ArrowArray packed_array;
+		ArrowSchema packed_schema;
+		soa::to_arrow(packed, &packed_array, &packed_schema);
+		if constexpr (std::endian::native == std::endian::little) {
+			REQUIRE(packed_array.children[2]->buffers[1] == packed.field<"flag">().words().data());
+		}
+		REQUIRE_IT_EQUALS(soa::from_arrow<decltype(packed)>(&packed_array, &packed_schema), rows);
+		packed_array.release(&packed_array);
+		packed_schema.release(&packed_schema);
+	}
+
+	SECTION("empty") {
+		soa::soa<Row> empty;
+		ArrowArray empty_array;
+		ArrowSchema empty_schema;
+		soa::to_arrow(empty, &empty_array, &empty_schema);
+		REQUIRE(empty_array.length == 0);
+		REQUIRE(soa::from_arrow<soa::soa<Row>>(&empty_array, &empty_schema).empty());
+		empty_array.release(&empty_array);
+		empty_schema.release(&empty_schema);
+	}
+
+	SECTION("missing fields") {
+		schema.children[3]->name = "other";
+		REQUIRE_THROWS_AS(soa::from_arrow<soa::soa<Row>>(&array, &schema), std::runtime_error);
+		schema.children[3]->name = "name";
+		schema.children[0]->format = "l";
+		REQUIRE_THROWS_AS(soa::from_arrow<soa::soa<Row>>(&array, &schema), std::runtime_error);
+		schema.children[0]->format = "i";
+	}
+
+	array.release(&array);
+	schema.release(&schema);
+	REQUIRE(array.release == nullptr);
+	REQUIRE(schema.release == nullptr);
+}
@@ -0,0 +1,119 @@
+#include <cstdint>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <soa_device.hpp>
+
+struct Particle {
+	float x = 0;
+	float y = 0;
+	std::int32_t id = 0;
+	std::string name;
+};
+
+/// Device failing to allocate once `allocations` buffers were allocated
+struct limited_device : soa::host_device {
+	size_t allocations = 0;
+	size_t allocated = 0;
+
+	void *allocate(size_t bytes) {
+		if (allocations == 0) {
+			throw std::bad_alloc();
+		}
+		allocations--;
+		allocated++;
+		return soa::host_device::allocate(bytes);
+	}
+	void deallocate(void *pointer, size_t bytes) noexcept {
+		allocated--;
+		soa::host_device::deallocate(pointer, bytes);
+	}
+};
+
+/// Device that records the copies made by `device_mirror`
+struct recording_device : soa::host_device {
+	std::vector<size_t> copied_bytes;
+
+	void copy(void *destination, const void *source, size_t bytes) {
+		copied_bytes.push_back(bytes);
+		soa::host_device::copy(destination, source, bytes);
+	}
+};
+
+TEST_CASE("pinned_allocator") {
+	soa::soa<Particle, soa::pinned_allocator<Particle>> particles;
+	for (int i = 0; i < 1000; i++) {
+		particles.push_back(Particle(float(i), float(-i), i, std::to_string(i)));
+	}
+	REQUIRE(reinterpret_cast<std::uintptr_t>(particles.field<"x">().data()) % soa::detail::page_size() == 0);
+	REQUIRE(particles[999].field<"name">() == "999");
+	soa::soa<Particle, soa::pinned_allocator<Particle>> copy(particles);
+	REQUIRE(copy[500].field<"x">() == 500);
+}
+
+TEST_CASE("device_mirror") {
+	soa::soa<Particle> particles;
+	for (int i = 0; i < 100; i++) {
+		particles.push_back(Particle(float(i), float(-i), i, ""));
+	}
+
+	SECTION("upload") {
+		soa::device_mirror<Particle, soa::host_device, "x", "id"> mirror;
+		mirror.upload(particles);
+		mirror.synchronize();
+		REQUIRE(mirror.size() == 100);
+		REQUIRE(mirror.data<"x">()[42] == 42);
+		REQUIRE(mirror.data<"id">()[99] == 99);
+		particles.resize(10);
+		mirror.upload(particles);
+		REQUIRE(mirror.size() == 10);
+		REQUIRE(mirror.capacity() == 100);
+	}
+
+	SECTION("capacity grows geometrically") {
+		soa::device_mirror<Particle, soa::host_device, "x"> mirror;
+		mirror.upload(particles);
+		REQUIRE(mirror.capacity() == 100);
+		particles.push_back(Particle());
+		mirror.upload(particles);
+		REQUIRE(mirror.size() == 101);
+		REQUIRE(mirror.capacity() == 200);
+	}
+
+	SECTION("failed allocation") {
+		limited_device device;
+		device.allocations = 1;
+		soa::device_mirror<Particle, limited_device, "x", "id"> mirror(device);
+		REQUIRE_THROWS_AS(mirror.upload(particles), std::bad_alloc);
+		REQUIRE(mirror.get_device().allocated == 0);
+		REQUIRE(mirror.capacity() == 0);
+		REQUIRE(mirror.size() == 0);
+		mirror.get_device().allocations = 2;
+		mirror.upload(particles);
+		REQUIRE(mirror.data<"id">()[99] == 99);
+	}
+
+	SECTION("upload dirty ranges") {
+		soa::tracked_soa<Particle, std::allocator<Particle>, soa::vector_storage, 16> tracked;
+		for (int i = 0; i < 100; i++) {
+			tracked.push_back(Particle(float(i), float(-i), i, ""));
+		}
+		soa::device_mirror<Particle, recording_device, "x", "y"> mirror;
+		mirror.upload(tracked);
+		REQUIRE(mirror.get_device().copied_bytes == std::vector<size_t>{ 400, 400 });
+		REQUIRE(tracked.dirty_ranges<"x">().empty());
+		// Only mirrored fields are cleared
+		REQUIRE(!tracked.dirty_ranges<"id">().empty());
+
+		mirror.get_device().copied_bytes.clear();
+		for (float& x : tracked.write<"x">(20, 1)) {
+			x = -1;
+		}
+		mirror.upload(tracked);
+		REQUIRE(mirror.get_device().copied_bytes == std::vector<size_t>{ 16 * sizeof(float) });
+		REQUIRE(mirror.data<"x">()[20] == -1);
+		REQUIRE(mirror.data<"y">()[20] == -20);
+	}
+}
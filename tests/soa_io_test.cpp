@@ -0,0 +1,184 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <soa_io.hpp>
+
+struct Particle {
+	float x = 0;
+	double mass = 0;
+	bool alive = false;
+	std::uint16_t id = 0;
+
+	bool operator==(const Particle& other) const = default;
+};
+
+struct Counter {
+	std::uint64_t value = 0;
+};
+
+struct Renamed {
+	float x = 0;
+	double weight = 0;
+	bool alive = false;
+	std::uint16_t id = 0;
+};
+
+static soa::soa<Particle> make_particles(size_t count) {
+	soa::soa<Particle> particles;
+	for (size_t i = 0; i < count; i++) {
+		particles.push_back(Particle(float(i), i * 0.5, i % 3 == 0, std::uint16_t(i)));
+	}
+	return particles;
+}
+
+template<typename Iterable1, typename Iterable2>
+void REQUIRE_IT_EQUALS(const Iterable1& iterable1, const Iterable2& iterable2) {
+	auto it1 = iterable1.begin();
+	auto it2 = iterable2.begin();
+	for ( ; it1 != iterable1.end() && it2 != iterable2.end(); ++it1, ++it2) {
+		REQUIRE(*it1 == *it2);
+	}
+	REQUIRE(it1 == iterable1.end());
+	REQUIRE(it2 == iterable2.end());
+}
+
+TEST_CASE("write and read") {
+	auto particles = make_particles(1000);
+	std::stringstream stream;
+	soa::write(stream, particles);
+
+	SECTION("same storage") {
+		REQUIRE_IT_EQUALS(soa::read<soa::soa<Particle>>(stream), particles);
+	}
+
+	SECTION("other storages") {
+		auto tiled = soa::read<soa::soa<Particle, std::allocator<Particle>, soa::tiled_storage<16>>>(stream);
+		REQUIRE_IT_EQUALS(tiled, particles);
+		std::stringstream packed_stream;
+		soa::write(packed_stream, soa::soa<Particle, std::allocator<Particle>, soa::packed_bool_storage>(particles.begin(), particles.end()));
+		REQUIRE(packed_stream.str() == stream.str());
+	}
+
+	SECTION("mismatching files") {
+		REQUIRE_THROWS_AS(soa::read<soa::soa<Renamed>>(stream), std::runtime_error);
+		std::string truncated = stream.str();
+		truncated.resize(truncated.size() - 1);
+		std::stringstream truncated_stream(truncated);
+		REQUIRE_THROWS_AS(soa::read<soa::soa<Particle>>(truncated_stream), std::runtime_error);
+	}
+
+	SECTION("corrupted size") {
+		// Reading stops at the end of the stream, without first allocating the rows claimed by the header
+		std::stringstream counter_stream;
+		soa::write(counter_stream, soa::soa<Counter>({ Counter(1), Counter(2) }));
+		std::string corrupted = counter_stream.str();
+		std::uint64_t size = std::uint64_t(1) << 50;
+		std::memcpy(corrupted.data() + offsetof(soa::detail::file_header, size), &size, sizeof(size));
+		std::stringstream corrupted_stream(corrupted);
+		REQUIRE_THROWS_AS(soa::read<soa::soa<Counter>>(corrupted_stream), std::runtime_error);
+	}
+}
+
+TEST_CASE("soa_writer and soa_reader") {
+	auto particles = make_particles(1000);
+	std::stringstream stream;
+	{
+		soa::soa_writer<Particle> writer(stream, 256);
+		writer.push_back(particles[0]);
+		writer.write(soa::soa<Particle>(particles.begin() + 1, particles.begin() + 600));
+		writer.flush();
+		writer.write(soa::soa<Particle>(particles.begin() + 600, particles.end()));
+	}
+
+	SECTION("row groups") {
+		soa::soa_reader<Particle> reader(stream);
+		REQUIRE(reader.max_row_group_size() == 256);
+		soa::soa<Particle, std::allocator<Particle>, soa::block_storage> result;
+		std::vector<size_t> row_groups;
+		while (size_t count = reader.read(result)) {
+			row_groups.push_back(count);
+		}
+		REQUIRE(reader.done());
+		REQUIRE(row_groups == std::vector<size_t>{ 256, 256, 88, 256, 144 });
+		REQUIRE_IT_EQUALS(result, particles);
+	}
+
+	SECTION("truncated stream") {
+		std::string truncated = stream.str();
+		truncated.resize(truncated.size() - 100);
+		std::stringstream truncated_stream(truncated);
+		soa::soa_reader<Particle> reader(truncated_stream);
+		soa::soa<Particle> result;
+		for (int i = 0; i < 4; i++) {
+			reader.read(result);
+		}
+		REQUIRE_THROWS_AS(reader.read(result), std::runtime_error);
+		REQUIRE(result.size() == 856);
+	}
+
+	SECTION("row groups of at least one row") {
+		std::stringstream single_stream;
+		{
+			soa::soa_writer<Particle> writer(single_stream, 0);
+			writer.write(soa::soa<Particle>(particles.begin(), particles.begin() + 3));
+		}
+		soa::soa_reader<Particle> reader(single_stream);
+		REQUIRE(reader.max_row_group_size() == 1);
+		soa::soa<Particle> result;
+		while (reader.read(result)) {}
+		REQUIRE(reader.done());
+		REQUIRE_IT_EQUALS(result, soa::soa<Particle>(particles.begin(), particles.begin() + 3));
+	}
+}
+
+#ifdef SOA_HAS_MMAP
+TEST_CASE("soa_mapped") {
+	auto particles = make_particles(1000);
+	auto path = (std::filesystem::temp_directory_path() / "soa_io_test.soa").string();
+	{
+		std::ofstream out(path, std::ios::binary);
+		soa::write(out, particles);
+	}
+
+	SECTION("fields") {
+		soa::soa_mapped<Particle> mapped(path);
+		REQUIRE(mapped.size() == 1000);
+		REQUIRE_IT_EQUALS(mapped.field<"mass">(), particles.field<"mass">());
+		REQUIRE_IT_EQUALS(mapped.field<bool>(), particles.field<bool>());
+		REQUIRE(reinterpret_cast<std::uintptr_t>(mapped.field<3>().data()) % 64 == 0);
+		REQUIRE(mapped[10] == particles[10]);
+	}
+
+	SECTION("move") {
+		soa::soa_mapped<Particle> mapped(path);
+		soa::soa_mapped<Particle> moved(std::move(mapped));
+		REQUIRE(mapped.empty());
+		REQUIRE(moved.field<"x">()[999] == 999);
+	}
+
+	SECTION("errors") {
+		REQUIRE_THROWS_AS(soa::soa_mapped<Renamed>(path), std::runtime_error);
+		REQUIRE_THROWS_AS(soa::soa_mapped<Particle>(path + ".missing"), std::system_error);
+	}
+
+	SECTION("corrupted offset") {
+		{
+			std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+			std::uint64_t offset = std::uint64_t(1) << 40;
+			// The last field, so that no following field is checked against its end
+			file.seekp(sizeof(soa::detail::file_header) + 3 * sizeof(soa::detail::column_header));
+			file.write((const char *) &offset, sizeof(offset));
+		}
+		REQUIRE_THROWS_AS(soa::soa_mapped<Particle>(path), std::runtime_error);
+	}
+
+	std::filesystem::remove(path);
+}
+#endif
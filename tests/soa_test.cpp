@@ -1,5 +1,19 @@
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cstdint>
+#ifdef SOA_EXECUTION_POLICIES
+#include <execution>
+#endif
 #include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <numeric>
+#include <ranges>
+#include <stdexcept>
+#include <thread>
 
 #include <catch2/catch_test_macros.hpp>
 #include <soa.hpp>
@@ -16,6 +30,133 @@ struct Foo {
 };
 using FooSoA = soa::soa<Foo>;
 
+struct Flags {
+	int id = 0;
+	bool alive = false;
+	bool visible = false;
+
+	bool operator==(const Flags& other) const = default;
+};
+
+struct MoveOnly {
+	int i = 0;
+	std::unique_ptr<int> p;
+};
+
+struct RecordingInstrumentation {
+	static inline std::vector<soa::reallocation_event> reallocations;
+	static inline std::vector<soa::operation_event> operations;
+
+	static void on_reallocation(const soa::reallocation_event& event) {
+		reallocations.push_back(event);
+	}
+	static void on_operation(const soa::operation_event& event) {
+		operations.push_back(event);
+	}
+};
+
+struct ThrowingCopy {
+	static inline bool throws = false;
+	int value = 0;
+
+	ThrowingCopy(int value = 0) : value(value) {}
+	ThrowingCopy(const ThrowingCopy& other) : value(other.value) {
+		if (throws) {
+			throw std::runtime_error("copy");
+		}
+	}
+	ThrowingCopy(ThrowingCopy&&) noexcept = default;
+	ThrowingCopy& operator=(const ThrowingCopy&) = default;
+	ThrowingCopy& operator=(ThrowingCopy&&) noexcept = default;
+};
+
+struct Counted {
+	/// Field counting how many times values of it were moved, without comparison operators
+	struct Field {
+		static inline int moves = 0;
+		int value = 0;
+
+		Field(int value = 0) : value(value) {}
+		Field(Field&& other) noexcept : value(other.value) {
+			moves++;
+		}
+		Field& operator=(Field&& other) noexcept {
+			value = other.value;
+			moves++;
+			return *this;
+		}
+	};
+
+	int a = 0;
+	Field b;
+};
+
+struct Sample {
+	int id = 0;
+	ThrowingCopy payload;
+};
+
+struct AllocationLimit {
+	static inline size_t limit = std::numeric_limits<size_t>::max();
+};
+
+/// Allocator failing once `limit` allocations were made, for all types it is rebound to
+template<typename T>
+struct LimitedAllocator : AllocationLimit {
+	using value_type = T;
+
+	LimitedAllocator() = default;
+	template<typename U>
+	LimitedAllocator(const LimitedAllocator<U>&) noexcept {}
+
+	T *allocate(size_t n) {
+		if (limit == 0) {
+			throw std::bad_alloc();
+		}
+		limit--;
+		return std::allocator<T>().allocate(n);
+	}
+	void deallocate(T *pointer, size_t n) noexcept {
+		std::allocator<T>().deallocate(pointer, n);
+	}
+
+	template<typename U>
+	bool operator==(const LimitedAllocator<U>&) const noexcept {
+		return true;
+	}
+};
+
+struct ArenaCounts {
+	static inline std::array<size_t, 3> allocations {};
+};
+
+/// Allocator propagated on copy assignment, counting the allocations made from each of a few arenas
+template<typename T>
+struct ArenaAllocator : ArenaCounts {
+	using value_type = T;
+	using propagate_on_container_copy_assignment = std::true_type;
+	using propagate_on_container_move_assignment = std::true_type;
+
+	int arena = 0;
+
+	ArenaAllocator(int arena = 0) : arena(arena) {}
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena(other.arena) {}
+
+	T *allocate(size_t n) {
+		allocations[arena]++;
+		return std::allocator<T>().allocate(n);
+	}
+	void deallocate(T *pointer, size_t n) noexcept {
+		std::allocator<T>().deallocate(pointer, n);
+	}
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U>& other) const noexcept {
+		return arena == other.arena;
+	}
+};
+
 template<typename Iterable1, typename Iterable2>
 void REQUIRE_IT_EQUALS(const Iterable1& iterable1, const Iterable2& iterable2) {
 	auto it1 = iterable1.begin();
@@ -102,6 +243,37 @@ TEST_CASE("soa<Foo>") {
 		REQUIRE(!soa.empty());
 	}
 
+	SECTION("push_back(T&&)") {
+		FooSoA soa;
+		Foo value(1, "a string long enough to be allocated on the heap");
+		soa.push_back(std::move(value));
+		REQUIRE(soa[0] == Foo(1, "a string long enough to be allocated on the heap"));
+		REQUIRE(value.s.empty());
+	}
+
+	SECTION("emplace_back") {
+		FooSoA soa;
+		auto ref = soa.emplace_back(1, "hello 1");
+		REQUIRE(ref == foo1);
+		soa.emplace_back(2, std::string("hello 2"));
+		REQUIRE(soa.size() == 2);
+		REQUIRE(soa[1] == foo2);
+
+		// Arguments referring to the SoA stay valid when columns grow
+		soa.shrink_to_fit();
+		soa.emplace_back(soa.field<"i">()[0], soa.field<"s">()[1]);
+		REQUIRE(soa[2] == Foo(1, "hello 2"));
+
+		// Fields are constructed in place when no column grows
+		soa::soa<Counted> counted;
+		counted.reserve(2);
+		counted.emplace_back(1, 2);
+		REQUIRE(Counted::Field::moves == 0);
+		counted.emplace_back(3, 4);
+		counted.emplace_back(5, 6);
+		REQUIRE(counted[2].field<"b">().value == 6);
+	}
+
 	SECTION("pop_back") {
 		FooSoA soa(foo_ilist);
 		REQUIRE(soa.size() == 3);
@@ -109,6 +281,33 @@ TEST_CASE("soa<Foo>") {
 		REQUIRE(soa.size() == 2);
 	}
 
+	SECTION("insert(count, T)") {
+		FooSoA soa({ foo1, foo3 });
+		soa.insert(soa.begin() + 1, 2, foo2);
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo1, foo2, foo2, foo3 });
+	}
+
+	SECTION("insert(InputIt, InputIt)") {
+		FooSoA soa({ foo1, foo1 });
+		soa.insert(soa.begin() + 1, foo_array.begin(), foo_array.end());
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo1, foo1, foo2, foo3, foo1 });
+
+		std::vector<Foo> foo_vector(foo_array.begin(), foo_array.end());
+		soa.insert(soa.begin(), std::make_move_iterator(foo_vector.begin()), std::make_move_iterator(foo_vector.end()));
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo1, foo2, foo3, foo1, foo1, foo2, foo3, foo1 });
+		REQUIRE(foo_vector[0].s.empty());
+
+		FooSoA other(foo_ilist);
+		other.insert(other.begin() + 1, soa.begin(), soa.begin() + 2);
+		REQUIRE_IT_EQUALS(other, std::initializer_list<Foo>{ foo1, foo1, foo2, foo2, foo3 });
+	}
+
+	SECTION("assign(InputIt, InputIt)") {
+		FooSoA soa({ foo3 });
+		soa.assign(foo_array.begin(), foo_array.end());
+		REQUIRE_IT_EQUALS(soa, foo_array);
+	}
+
 	SECTION("erase") {
 		FooSoA soa(foo_ilist);
 		REQUIRE(soa.size() == 3);
@@ -118,11 +317,58 @@ TEST_CASE("soa<Foo>") {
 		REQUIRE(soa[1] == foo3);
 	}
 
+	SECTION("erase_unordered") {
+		FooSoA soa(foo_ilist);
+		auto it = soa.erase_unordered(soa.begin());
+		REQUIRE(*it == foo3);
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo3, foo2 });
+		it = soa.erase_unordered(soa.begin() + 1);
+		REQUIRE(it == soa.end());
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo3 });
+	}
+
+	SECTION("erase_if") {
+		FooSoA soa({ foo1, foo2, foo3, foo2, foo1 });
+		REQUIRE(soa.erase_if<"i">([](int i) { return i == 2; }) == 2);
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo1, foo3, foo1 });
+		REQUIRE(soa.erase_if<int, std::string>([](int i, const std::string& s) { return i == 3 && s == "hello 3"; }) == 1);
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo1, foo1 });
+		REQUIRE(soa.erase_if<0>([](int i) { return i == 2; }) == 0);
+		REQUIRE(soa.size() == 2);
+		REQUIRE(soa.erase_if<"s">([](const std::string&) { return true; }) == 2);
+		REQUIRE(soa.empty());
+	}
+
+	SECTION("for_each_chunk") {
+		FooSoA soa(foo_ilist);
+		size_t chunk_count = 0;
+		soa.for_each_chunk<"i", "s">([&](std::span<int> i, std::span<std::string> s) {
+			chunk_count++;
+			REQUIRE(i.data() == soa.field<"i">().data());
+			REQUIRE(s.size() == 3);
+		});
+		REQUIRE(chunk_count == 1);
+		std::as_const(soa).for_each_chunk<int>([](std::span<const int> i) {
+			REQUIRE(i[2] == 3);
+		});
+	}
+
+	SECTION("find_by") {
+		FooSoA soa(foo_ilist);
+		REQUIRE(soa.find_by<"i">(2) == soa.begin() + 1);
+		REQUIRE(soa.find_by<std::string>("hello 3") == soa.begin() + 2);
+		REQUIRE(soa.find_by<0>(4) == soa.end());
+		const FooSoA& const_soa = soa;
+		REQUIRE(*const_soa.find_by<"s">("hello 1") == foo1);
+	}
+
 	SECTION("resize") {
 		FooSoA soa(foo_ilist);
 		REQUIRE(soa.size() == 3);
 		soa.resize(1);
 		REQUIRE(soa.size() == 1);
+		soa.resize_for_overwrite(3);
+		REQUIRE(soa[2] == Foo());
 	}
 
 	SECTION("swap") {
@@ -156,6 +402,123 @@ TEST_CASE("soa<Foo>") {
 		REQUIRE_IT_EQUALS(soa, foo_ilist);
 	}
 
+	SECTION("random access iterator") {
+		STATIC_REQUIRE(std::random_access_iterator<FooSoA::iterator>);
+		STATIC_REQUIRE(std::random_access_iterator<FooSoA::const_iterator>);
+		STATIC_REQUIRE(std::permutable<FooSoA::iterator>);
+
+		FooSoA soa(foo_ilist);
+		auto it = soa.begin();
+		REQUIRE(it[2] == foo3);
+		REQUIRE(it < it + 1);
+		REQUIRE(soa.end() - soa.begin() == 3);
+		REQUIRE(soa.begin() - soa.end() == -3);
+		REQUIRE(2 + it == soa.end() - 1);
+
+		auto by_i_descending = [](const Foo& a, const Foo& b) { return a.i > b.i; };
+		std::ranges::sort(soa, by_i_descending);
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo3, foo2, foo1 });
+		std::sort(soa.begin(), soa.end(), [](const Foo& a, const Foo& b) { return a.i < b.i; });
+		REQUIRE_IT_EQUALS(soa, foo_ilist);
+		REQUIRE(std::lower_bound(soa.begin(), soa.end(), foo2, [](const Foo& a, const Foo& b) { return a.i < b.i; }) == soa.begin() + 1);
+
+		std::ranges::iter_swap(soa.begin(), soa.begin() + 2);
+		REQUIRE(soa[0] == foo3);
+		REQUIRE(soa[2] == foo1);
+
+		Foo moved = std::ranges::iter_move(soa.begin());
+		REQUIRE(moved == foo3);
+		REQUIRE(soa[0].field<"s">().empty());
+	}
+
+	SECTION("sort_by") {
+		FooSoA soa({ foo2, foo3, foo1 });
+		soa.sort_by<"i">();
+		REQUIRE_IT_EQUALS(soa, foo_ilist);
+		soa.sort_by<"s">(std::greater<>());
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo3, foo2, foo1 });
+		soa.sort_by<0>();
+		REQUIRE_IT_EQUALS(soa, foo_ilist);
+		soa.sort_by<std::string>(std::greater<>());
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo3, foo2, foo1 });
+	}
+
+	SECTION("stable_sort_by") {
+		Foo foo1b(1, "hello 1b");
+		FooSoA soa({ foo2, foo1b, foo3, foo1 });
+		soa.stable_sort_by<"i">();
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo1b, foo1, foo2, foo3 });
+	}
+
+	SECTION("transform") {
+		FooSoA soa(foo_ilist);
+		soa.transform<"i">([](int& i) { i *= 10; });
+		REQUIRE(soa[2].field<"i">() == 30);
+		soa.transform<"i", "s">([](int i, std::string& s) { s += std::to_string(i); });
+		REQUIRE(soa[0].field<"s">() == "hello 110");
+		soa.transform<1, 0>([](std::string& s, int& i) { i = (int) s.size(); });
+		REQUIRE(soa[1].field<"i">() == 9);
+		const FooSoA& const_soa = soa;
+		int count = 0;
+		const_soa.transform<std::string>([&](const std::string&) { count++; });
+		REQUIRE(count == 3);
+	}
+
+	SECTION("view") {
+		FooSoA soa(foo_ilist);
+		auto view = soa.view<"s", "i">();
+		static_assert(std::ranges::random_access_range<decltype(view)>);
+		static_assert(std::ranges::borrowed_range<decltype(view)>);
+		REQUIRE(view.size() == 3);
+		REQUIRE(view[1] == std::tuple(foo2.s, foo2.i));
+		for (auto [s, i] : view) {
+			i += (int) s.size();
+		}
+		REQUIRE(soa[0].field<"i">() == 8);
+		REQUIRE(view.field<1>().data() == soa.field<"i">().data());
+		std::ranges::range_value_t<decltype(view)> copy = view[0];
+		auto [copy_s, copy_i] = copy;
+		REQUIRE(copy_s == foo1.s);
+		REQUIRE(copy_i == 8);
+
+		auto it = std::ranges::find_if(view, [&](const auto& fields) {
+			return std::get<0>(fields) == foo3.s;
+		});
+		REQUIRE(it - view.begin() == 2);
+		REQUIRE(std::get<1>(*it) == 10);
+
+		const FooSoA& const_soa = soa;
+		auto const_view = const_soa.view<0>();
+		static_assert(std::is_same_v<std::ranges::range_reference_t<decltype(const_view)>, soa::field_reference<const int>>);
+		static_assert(!std::indirectly_writable<std::ranges::iterator_t<decltype(const_view)>, std::tuple<int>>);
+		REQUIRE(std::ranges::count_if(const_view, [](auto fields) { return std::get<0>(fields) > 8; }) == 2);
+		REQUIRE(soa.view<std::string>().size() == 3);
+	}
+
+	SECTION("sort view") {
+		FooSoA soa(foo_ilist);
+		auto view = soa.view<"i", "s">();
+		static_assert(std::sortable<std::ranges::iterator_t<decltype(view)>>);
+		std::ranges::sort(view, std::greater{}, [](const auto& fields) { return std::get<0>(fields); });
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo3, foo2, foo1 });
+
+		view[0] = view[2];
+		REQUIRE(soa.field<"i">()[0] == 1);
+		REQUIRE(soa.field<"s">()[0] == foo1.s);
+	}
+
+	SECTION("reduce") {
+		FooSoA soa(foo_ilist);
+		REQUIRE(soa.reduce<"i">(0) == 6);
+		REQUIRE(soa.reduce<0>(1, std::multiplies<>()) == 6);
+		REQUIRE(soa.reduce<int>(10) == 16);
+		size_t length = soa.transform_reduce<"i", "s">(size_t(0), std::plus<>(), [](int i, const std::string& s) {
+			return i * s.size();
+		});
+		REQUIRE(length == 6 * 7);
+		REQUIRE(FooSoA().reduce<"i">(0) == 0);
+	}
+
 	SECTION("wrapper") {
 		SECTION("comparison") {
 			FooSoA soa1(foo_ilist);
@@ -172,6 +535,18 @@ TEST_CASE("soa<Foo>") {
 			REQUIRE(soa_same[0] == soa_same[1]);
 		}
 
+		SECTION("ordering") {
+			FooSoA soa({ foo1, foo2, Foo(2, "hello 1") });
+			REQUIRE(soa[0] < soa[1]);
+			REQUIRE(soa[2] < soa[1]);
+			REQUIRE(soa[1] >= soa[2]);
+			REQUIRE((soa[0] <=> foo1) == std::strong_ordering::equal);
+			REQUIRE(soa[2] > foo1);
+			REQUIRE(soa[2] != foo2);
+			std::ranges::sort(soa, std::greater<>());
+			REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo2, Foo(2, "hello 1"), foo1 });
+		}
+
 		SECTION("assignment(T)") {
 			FooSoA soa(foo_ilist);
 
@@ -219,3 +594,1151 @@ TEST_CASE("soa<Foo>") {
 		REQUIRE(soa[1] == foo1);
 	}
 }
+
+TEST_CASE("soa<Foo, block_storage>") {
+	using BlockSoA = soa::soa<Foo, std::allocator<Foo>, soa::block_storage>;
+	Foo foo1(1, "hello 1");
+	Foo foo2(2, "hello 2");
+	Foo foo3(3, "hello 3");
+
+	SECTION("shared capacity") {
+		BlockSoA soa;
+		REQUIRE(soa.capacity() == 0);
+		soa.reserve(10);
+		REQUIRE(soa.capacity() == 10);
+		REQUIRE(soa.field<"i">().data() != nullptr);
+		REQUIRE(soa.field<"s">().data() != nullptr);
+		REQUIRE((void *) (soa.field<"i">().data() + soa.capacity()) <= (void *) soa.field<"s">().data());
+	}
+
+	SECTION("growth keeps values") {
+		BlockSoA soa;
+		for (int i = 0; i < 100; i++) {
+			soa.push_back(Foo(i, std::to_string(i)));
+		}
+		REQUIRE(soa.size() == 100);
+		REQUIRE(soa.capacity() >= 100);
+		for (int i = 0; i < 100; i++) {
+			REQUIRE(soa[i] == Foo(i, std::to_string(i)));
+		}
+		soa.shrink_to_fit();
+		REQUIRE(soa.capacity() == 100);
+		REQUIRE(soa[99] == Foo(99, "99"));
+	}
+
+	SECTION("insert and erase in the middle") {
+		BlockSoA soa({ foo1, foo3 });
+		soa.insert(soa.begin() + 1, foo2);
+		REQUIRE(soa.size() == 3);
+		REQUIRE(soa[0] == foo1);
+		REQUIRE(soa[1] == foo2);
+		REQUIRE(soa[2] == foo3);
+
+		soa.erase(soa.begin(), soa.begin() + 2);
+		REQUIRE(soa.size() == 1);
+		REQUIRE(soa[0] == foo3);
+	}
+
+	SECTION("emplace from own elements") {
+		BlockSoA soa({ foo1, foo2, foo3 });
+		soa.shrink_to_fit();
+		soa.emplace_back(soa.field<"i">()[0], soa.field<"s">()[0]);
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo1, foo2, foo3, foo1 });
+		soa.shrink_to_fit();
+		soa.emplace(soa.begin(), soa.field<"i">()[3], soa.field<"s">()[3]);
+		soa.reserve(10);
+		soa.emplace(soa.begin() + 1, soa.field<"i">()[2], std::move(soa.field<"s">()[2]));
+		soa.emplace_back(soa.field<"i">()[1], soa.field<"s">()[1]);
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo1, Foo(2, "hello 2"), foo1, Foo(2, ""), foo3, foo1, Foo(2, "hello 2") });
+	}
+
+	SECTION("failed copy frees the block") {
+		using SampleSoA = soa::soa<Sample, std::allocator<Sample>, soa::block_storage>;
+		SampleSoA samples;
+		samples.push_back(Sample(1, ThrowingCopy(2)));
+		ThrowingCopy::throws = true;
+		REQUIRE_THROWS_AS(SampleSoA(samples), std::runtime_error);
+		REQUIRE_THROWS_AS(SampleSoA(samples, samples.get_allocator()), std::runtime_error);
+		SampleSoA assigned;
+		REQUIRE_THROWS_AS(assigned = samples, std::runtime_error);
+		ThrowingCopy::throws = false;
+		REQUIRE(assigned.empty());
+		REQUIRE(assigned.capacity() == 0);
+	}
+
+	SECTION("bulk insert in the middle") {
+		BlockSoA soa({ foo1, foo1 });
+		soa.insert(soa.begin() + 1, 2, foo3);
+		std::array<Foo, 2> foo_array({ foo2, foo2 });
+		soa.insert(soa.begin() + 1, foo_array.begin(), foo_array.end());
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo1, foo2, foo2, foo3, foo3, foo1 });
+	}
+
+	SECTION("resize") {
+		BlockSoA soa({ foo1 });
+		soa.resize(3, foo2);
+		REQUIRE(soa.size() == 3);
+		REQUIRE(soa[2] == foo2);
+		soa.resize(5);
+		REQUIRE(soa[4] == Foo());
+		soa.resize_for_overwrite(7);
+		REQUIRE(soa.size() == 7);
+		REQUIRE(soa[6].field<"s">() == "");
+		std::ranges::fill(soa.field<"i">().subspan(5), 6);
+		REQUIRE(soa[6] == Foo(6, ""));
+		soa.resize_for_overwrite(2);
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo1, foo2 });
+	}
+
+	SECTION("trivially copyable fields") {
+		soa::soa<Flags, std::allocator<Flags>, soa::block_storage> flags;
+		std::vector<Flags> expected;
+		for (int i = 0; i < 50; i++) {
+			flags.push_back(Flags(i, i % 2 == 0, true));
+			expected.push_back(Flags(i, i % 2 == 0, true));
+		}
+		flags.insert(flags.begin() + 10, 3, Flags(-1, false, false));
+		expected.insert(expected.begin() + 10, 3, Flags(-1, false, false));
+		flags.erase(flags.begin() + 2, flags.begin() + 12);
+		expected.erase(expected.begin() + 2, expected.begin() + 12);
+		flags.reserve(200);
+		REQUIRE_IT_EQUALS(flags, expected);
+		auto copy = flags;
+		REQUIRE_IT_EQUALS(copy, expected);
+	}
+
+	SECTION("copy") {
+		BlockSoA soa({ foo1, foo2, foo3 });
+		BlockSoA soa_copy(soa);
+		REQUIRE_IT_EQUALS(soa, soa_copy);
+		soa_copy = BlockSoA({ foo3 });
+		REQUIRE(soa_copy.size() == 1);
+		REQUIRE(soa_copy[0] == foo3);
+	}
+}
+
+TEST_CASE("soa<Foo, aligned_block_storage>") {
+	using AlignedSoA = soa::soa<Foo, std::allocator<Foo>, soa::aligned_block_storage<64>>;
+	Foo foo1(1, "hello 1");
+
+	SECTION("aligned columns") {
+		AlignedSoA soa;
+		soa.reserve(3);
+		REQUIRE(soa.capacity() == 16);
+		REQUIRE((uintptr_t) soa.field<"i">().data() % 64 == 0);
+		REQUIRE((uintptr_t) soa.field<"s">().data() % 64 == 0);
+
+		soa.resize(17, foo1);
+		REQUIRE(soa.capacity() % 16 == 0);
+		REQUIRE((uintptr_t) soa.field<"i">().data() % 64 == 0);
+		REQUIRE((uintptr_t) soa.field<"s">().data() % 64 == 0);
+		REQUIRE(soa[16] == foo1);
+	}
+
+	SECTION("aligned_field") {
+		AlignedSoA soa(17, foo1);
+		soa::aligned_span<int, 64> i_values = soa.aligned_field<"i">();
+		REQUIRE(i_values.size() == 17);
+		REQUIRE(i_values.padded_size() == 32);
+		REQUIRE(i_values.padded_size() <= soa.capacity());
+		REQUIRE(i_values.data() == soa.field<"i">().data());
+		REQUIRE(soa.aligned_field<0>().data() == i_values.data());
+		REQUIRE(soa.aligned_field<std::string>().size() == 17);
+	}
+}
+
+TEST_CASE("soa<Foo, tiled_storage>") {
+	using TiledSoA = soa::soa<Foo, std::allocator<Foo>, soa::tiled_storage<4>>;
+	Foo foo1(1, "hello 1");
+	Foo foo2(2, "hello 2");
+	Foo foo3(3, "hello 3");
+
+	SECTION("tiles") {
+		TiledSoA soa;
+		soa.reserve(5);
+		REQUIRE(soa.capacity() == 8);
+		for (int i = 0; i < 6; i++) {
+			soa.push_back(Foo(i, std::to_string(i)));
+		}
+		auto i_values = soa.field<"i">();
+		REQUIRE(i_values.size() == 6);
+		REQUIRE(i_values.tile_count() == 2);
+		REQUIRE(i_values.tile(0).size() == 4);
+		REQUIRE(i_values.tile(1).size() == 2);
+		REQUIRE(&i_values[3] == &i_values.tile(0)[3]);
+		REQUIRE(&i_values[4] == &i_values.tile(1)[0]);
+		// The fields of an element are in the same tile
+		REQUIRE((void *) &soa.field<"s">()[0] > (void *) &i_values[3]);
+		REQUIRE((void *) &soa.field<"s">()[0] < (void *) &i_values[4]);
+		REQUIRE_IT_EQUALS(soa.field<1>(), std::initializer_list<std::string>{ "0", "1", "2", "3", "4", "5" });
+	}
+
+	SECTION("insert and erase in the middle") {
+		TiledSoA soa({ foo1, foo1, foo1, foo3 });
+		soa.insert(soa.begin() + 3, 2, foo2);
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo1, foo1, foo1, foo2, foo2, foo3 });
+		soa.erase(soa.begin(), soa.begin() + 3);
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo2, foo2, foo3 });
+		soa.shrink_to_fit();
+		REQUIRE(soa.capacity() == 4);
+	}
+
+	SECTION("kernels and sorting") {
+		TiledSoA soa;
+		for (int i = 0; i < 10; i++) {
+			soa.push_back(Foo(9 - i, std::to_string(i)));
+		}
+		soa.transform<"i">([](int& i) { i *= 2; });
+		REQUIRE(soa.reduce<"i">(0) == 90);
+		REQUIRE(soa.transform_reduce<"i", "s">(0, std::plus<>(), [](int i, const std::string& s) { return i + (int) s.size(); }) == 100);
+		soa.sort_by<"i">();
+		REQUIRE(soa[0] == Foo(0, "9"));
+		REQUIRE(soa[9] == Foo(18, "0"));
+		REQUIRE(soa.erase_if<"i">([](int i) { return i % 4 != 0; }) == 5);
+		REQUIRE_IT_EQUALS(soa.field<"s">(), std::initializer_list<std::string>{ "9", "7", "5", "3", "1" });
+	}
+}
+
+TEST_CASE("soa<Foo, chunked_storage>") {
+	using ChunkedSoA = soa::soa<Foo, std::allocator<Foo>, soa::chunked_storage<4>>;
+	Foo foo1(1, "hello 1");
+	Foo foo2(2, "hello 2");
+	Foo foo3(3, "hello 3");
+
+	SECTION("chunks") {
+		ChunkedSoA soa;
+		soa.reserve(5);
+		REQUIRE(soa.capacity() == 8);
+		for (int i = 0; i < 6; i++) {
+			soa.push_back(Foo(i, std::to_string(i)));
+		}
+		auto i_values = soa.field<"i">();
+		REQUIRE(i_values.size() == 6);
+		REQUIRE(i_values.tile_count() == 2);
+		REQUIRE(i_values.tile(1).size() == 2);
+		REQUIRE(&i_values[4] == &i_values.tile(1)[0]);
+		REQUIRE_IT_EQUALS(soa.field<1>(), std::initializer_list<std::string>{ "0", "1", "2", "3", "4", "5" });
+		std::vector<size_t> chunk_sizes;
+		soa.for_each_chunk<"i", "s">([&](std::span<int> i, std::span<std::string> s) {
+			chunk_sizes.push_back(i.size());
+			REQUIRE(s[0] == std::to_string(i[0]));
+		});
+		REQUIRE_IT_EQUALS(chunk_sizes, std::initializer_list<size_t>{ 4, 2 });
+	}
+
+	SECTION("growth keeps addresses") {
+		ChunkedSoA soa({ foo1, foo2 });
+		const std::string *address = &soa.field<"s">()[1];
+		for (int i = 0; i < 100; i++) {
+			soa.push_back(foo3);
+		}
+		REQUIRE(&soa.field<"s">()[1] == address);
+		REQUIRE(*address == "hello 2");
+		soa.resize(2);
+		soa.shrink_to_fit();
+		REQUIRE(soa.capacity() == 4);
+		REQUIRE(&soa.field<"s">()[1] == address);
+		soa.resize_for_overwrite(9);
+		REQUIRE(soa.capacity() == 12);
+		REQUIRE(soa[8].field<"s">() == "");
+	}
+
+	SECTION("insert and erase in the middle") {
+		ChunkedSoA soa({ foo1, foo1, foo1, foo3 });
+		soa.insert(soa.begin() + 3, 2, foo2);
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo1, foo1, foo1, foo2, foo2, foo3 });
+		soa.insert(soa.begin(), soa[5]);
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo3, foo1, foo1, foo1, foo2, foo2, foo3 });
+		soa.erase(soa.begin(), soa.begin() + 4);
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo2, foo2, foo3 });
+	}
+
+	SECTION("copy and swap") {
+		ChunkedSoA soa1({ foo1, foo2 });
+		ChunkedSoA soa2(soa1);
+		soa1.resize(5, foo3);
+		soa1.swap(soa2);
+		REQUIRE_IT_EQUALS(soa1, std::initializer_list<Foo>{ foo1, foo2 });
+		REQUIRE(soa2.size() == 5);
+		soa1 = soa2;
+		REQUIRE(soa1[4] == foo3);
+		ChunkedSoA soa3(std::move(soa1));
+		REQUIRE(soa3.size() == 5);
+	}
+
+	SECTION("kernels and sorting") {
+		ChunkedSoA soa;
+		for (int i = 0; i < 10; i++) {
+			soa.push_back(Foo(9 - i, std::to_string(i)));
+		}
+		soa.transform<"i">([](int& i) { i *= 2; });
+		REQUIRE(soa.reduce<"i">(0) == 90);
+		soa.sort_by<"i">();
+		REQUIRE(soa[0] == Foo(0, "9"));
+		REQUIRE(soa[9] == Foo(18, "0"));
+		REQUIRE(soa.erase_if<"i">([](int i) { return i % 4 != 0; }) == 5);
+		REQUIRE_IT_EQUALS(soa.field<"s">(), std::initializer_list<std::string>{ "9", "7", "5", "3", "1" });
+	}
+}
+
+TEST_CASE("soa<Foo, hot_cold_storage>") {
+	using HotColdSoA = soa::soa<Foo, std::allocator<Foo>, soa::hot_cold_storage<"i">>;
+	Foo foo1(1, "hello 1");
+	Foo foo2(2, "hello 2");
+	Foo foo3(3, "hello 3");
+
+	SECTION("cold columns are materialized lazily") {
+		HotColdSoA soa;
+		soa.resize(3);
+		soa.erase(soa.begin());
+		REQUIRE(soa.size() == 2);
+		soa.push_back(foo1);
+		REQUIRE_IT_EQUALS(soa.field<"s">(), std::initializer_list<std::string>{ "", "", "hello 1" });
+		soa.resize(4);
+		const HotColdSoA& const_soa = soa;
+		REQUIRE(const_soa.field<"s">().size() == 4);
+		REQUIRE(const_soa[3] == Foo(0, ""));
+	}
+
+	SECTION("reordering skips unaccessed cold columns") {
+		HotColdSoA soa;
+		soa.resize(6);
+		for (int i = 0; i < 6; i++) {
+			soa.field<"i">()[i] = i;
+		}
+		soa.erase_unordered(soa.begin() + 1);
+		REQUIRE(soa.erase_if<"i">([](int i) { return i % 2 == 0; }) == 3);
+		soa.sort_by<"i">(std::greater<>());
+		soa.stable_sort_by<"i">();
+		REQUIRE_IT_EQUALS(soa.field<"i">(), std::initializer_list<int>{ 3, 5 });
+		// Capacity of the "s" column
+		REQUIRE(soa.memory_usage()[1].allocated_bytes == 0);
+		REQUIRE(soa[1] == Foo(5, ""));
+
+		soa.field<"s">()[0] = "hello 3";
+		soa.sort_by<"i">(std::greater<>());
+		soa.erase_unordered(soa.begin());
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ Foo(3, "hello 3") });
+	}
+
+	SECTION("insert and erase in the middle") {
+		HotColdSoA soa({ foo1, foo1, foo3 });
+		soa.insert(soa.begin() + 2, 2, foo2);
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo1, foo1, foo2, foo2, foo3 });
+		soa.erase(soa.begin(), soa.begin() + 2);
+		soa.emplace(soa.begin() + 1, 4, "hello 4");
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo2, Foo(4, "hello 4"), foo2, foo3 });
+		soa.pop_back();
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo2, Foo(4, "hello 4"), foo2 });
+	}
+
+	SECTION("copy and swap") {
+		HotColdSoA soa1({ foo1, foo2 });
+		HotColdSoA soa2(soa1);
+		soa1.resize(3, foo3);
+		soa1.swap(soa2);
+		REQUIRE_IT_EQUALS(soa1, std::initializer_list<Foo>{ foo1, foo2 });
+		REQUIRE_IT_EQUALS(soa2, std::initializer_list<Foo>{ foo1, foo2, foo3 });
+		soa2.sort_by<"i">(std::greater<>());
+		REQUIRE_IT_EQUALS(soa2, std::initializer_list<Foo>{ foo3, foo2, foo1 });
+	}
+}
+
+TEST_CASE("soa<Foo, cow_storage>") {
+	using CowSoA = soa::soa<Foo, std::allocator<Foo>, soa::cow_storage>;
+	Foo foo1(1, "hello 1");
+	Foo foo2(2, "hello 2");
+	Foo foo3(3, "hello 3");
+
+	SECTION("snapshots share columns until modified") {
+		CowSoA soa({ foo1, foo2 });
+		const CowSoA snapshot = soa.snapshot();
+		const CowSoA& const_soa = soa;
+		REQUIRE(snapshot.field<"i">().data() == const_soa.field<"i">().data());
+		REQUIRE(snapshot.field<"s">().data() == const_soa.field<"s">().data());
+
+		soa.field<"i">()[0] = 10;
+		REQUIRE(snapshot.field<"i">().data() != const_soa.field<"i">().data());
+		REQUIRE(snapshot.field<"s">().data() == const_soa.field<"s">().data());
+		soa[1].field<"s">() = "modified";
+		REQUIRE(snapshot.field<"s">().data() != const_soa.field<"s">().data());
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ Foo(10, "hello 1"), Foo(2, "modified") });
+		REQUIRE_IT_EQUALS(snapshot, std::initializer_list<Foo>{ foo1, foo2 });
+	}
+
+	SECTION("modifiers") {
+		CowSoA soa({ foo1, foo2 });
+		CowSoA copy(soa);
+		soa.push_back(foo3);
+		soa.erase(soa.begin());
+		soa.insert(soa.begin(), foo1);
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo1, foo2, foo3 });
+		REQUIRE_IT_EQUALS(copy, std::initializer_list<Foo>{ foo1, foo2 });
+		copy = soa;
+		soa.clear();
+		REQUIRE(soa.empty());
+		REQUIRE(copy.size() == 3);
+		soa.resize(2, foo3);
+		copy.sort_by<"i">(std::greater<>());
+		REQUIRE_IT_EQUALS(copy, std::initializer_list<Foo>{ foo3, foo2, foo1 });
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo3, foo3 });
+		CowSoA moved(std::move(copy));
+		REQUIRE(moved.size() == 3);
+		copy.push_back(foo1);
+		REQUIRE_IT_EQUALS(copy, std::initializer_list<Foo>{ foo1 });
+	}
+
+	SECTION("concurrent readers") {
+		CowSoA soa;
+		for (int i = 0; i < 1000; i++) {
+			soa.push_back(Foo(i, ""));
+		}
+		CowSoA snapshot = soa.snapshot();
+		std::atomic<long> sum = 0;
+		std::thread reader([&] {
+			sum = snapshot.reduce<"i">(0L);
+		});
+		for (int& i : soa.field<"i">()) {
+			i = 0;
+		}
+		reader.join();
+		REQUIRE(sum == 999 * 1000 / 2);
+		REQUIRE(soa.reduce<"i">(0L) == 0);
+	}
+}
+
+TEST_CASE("soa<Foo, instrumented_storage>") {
+	Foo foo1(1, "hello 1");
+	Foo foo2(2, "hello 2");
+
+	SECTION("hooks") {
+		using InstrumentedSoA = soa::soa<Foo, std::allocator<Foo>, soa::instrumented_storage<RecordingInstrumentation>>;
+		RecordingInstrumentation::reallocations.clear();
+		RecordingInstrumentation::operations.clear();
+		InstrumentedSoA soa;
+		soa.reserve(4);
+		REQUIRE(RecordingInstrumentation::reallocations.size() == 2);
+		REQUIRE(RecordingInstrumentation::reallocations[0].field == "i");
+		REQUIRE(RecordingInstrumentation::reallocations[0].element_size == sizeof(int));
+		REQUIRE(RecordingInstrumentation::reallocations[0].old_capacity == 0);
+		REQUIRE(RecordingInstrumentation::reallocations[1].field == "s");
+		REQUIRE(RecordingInstrumentation::reallocations[1].new_capacity >= 4);
+
+		soa.push_back(foo1);
+		soa.push_back(foo1);
+		soa.push_back(foo2);
+		REQUIRE(RecordingInstrumentation::reallocations.size() == 2);
+		soa.insert(soa.begin() + 1, foo2);
+		soa.erase(soa.begin());
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo2, foo1, foo2 });
+		REQUIRE(RecordingInstrumentation::operations.size() == 6);
+		REQUIRE(RecordingInstrumentation::operations[0].operation == "reserve");
+		REQUIRE(RecordingInstrumentation::operations[4].operation == "insert");
+		REQUIRE(RecordingInstrumentation::operations[4].shifted_rows == 2);
+		REQUIRE(RecordingInstrumentation::operations[5].operation == "erase");
+		REQUIRE(RecordingInstrumentation::operations[5].shifted_rows == 3);
+		REQUIRE(RecordingInstrumentation::operations[5].row_size == sizeof(int) + sizeof(std::string));
+
+		soa.push_back(foo1);
+		soa.push_back(foo1);
+		REQUIRE(RecordingInstrumentation::reallocations.size() == 4);
+		REQUIRE(RecordingInstrumentation::reallocations[2].moved_elements == 4);
+	}
+
+	SECTION("counters") {
+		using counters = soa::instrumentation_counters<struct counters_test>;
+		using InstrumentedSoA = soa::soa<Foo, std::allocator<Foo>, soa::instrumented_storage<counters, soa::block_storage>>;
+		counters::reset();
+		InstrumentedSoA soa({ foo1, foo2 });
+		REQUIRE(counters::operations == 1);
+		REQUIRE(counters::reallocations == 2);
+		REQUIRE(counters::moved_bytes == 0);
+		soa.shrink_to_fit();
+		soa.insert(soa.begin(), foo2);
+		REQUIRE(counters::operations == 3);
+		REQUIRE(counters::moved_bytes == 2 * (sizeof(int) + sizeof(std::string)));
+		REQUIRE(counters::shifted_bytes == 2 * (sizeof(int) + sizeof(std::string)));
+		REQUIRE_IT_EQUALS(soa, std::initializer_list<Foo>{ foo2, foo1, foo2 });
+
+		InstrumentedSoA copy(soa);
+		soa.swap(copy);
+		REQUIRE_IT_EQUALS(soa, copy);
+		counters::reset();
+		REQUIRE(counters::operations == 0);
+	}
+
+	SECTION("memory_usage") {
+		soa::soa<Foo> soa;
+		soa.reserve(8);
+		soa.resize(2);
+		auto usage = soa.memory_usage();
+		REQUIRE(usage[0].name == "i");
+		REQUIRE(usage[0].used_bytes == 2 * sizeof(int));
+		REQUIRE(usage[0].allocated_bytes == 8 * sizeof(int));
+		REQUIRE(usage[1].name == "s");
+		REQUIRE(usage[1].wasted_bytes() == 6 * sizeof(std::string));
+
+		soa::soa<Foo, std::allocator<Foo>, soa::hot_cold_storage<"i">> hot_cold;
+		hot_cold.resize(4);
+		REQUIRE(hot_cold.memory_usage()[0].allocated_bytes >= 4 * sizeof(int));
+		REQUIRE(hot_cold.memory_usage()[1].allocated_bytes == 0);
+	}
+}
+
+TEST_CASE("soa<Flags, packed_bool_storage>") {
+	using PackedSoA = soa::soa<Flags, std::allocator<Flags>, soa::packed_bool_storage>;
+	PackedSoA soa;
+	for (int i = 0; i < 100; i++) {
+		soa.push_back(Flags(i, i % 3 == 0, true));
+	}
+
+	SECTION("bit columns") {
+		soa::bit_span<bool> alive = soa.field<"alive">();
+		REQUIRE(alive.size() == 100);
+		REQUIRE(alive.words().size() == 2);
+		REQUIRE(alive.words()[0] == 0x9249249249249249);
+		REQUIRE(alive.count() == 34);
+		REQUIRE(alive.any());
+		REQUIRE(!alive.all());
+		REQUIRE(soa.field<"visible">().all());
+		soa[1].field<"alive">() = true;
+		REQUIRE(alive[1]);
+		REQUIRE(alive.count() == 35);
+		REQUIRE(soa.reduce<"alive">(0) == 35);
+	}
+
+	SECTION("insert and erase in the middle") {
+		soa.erase(soa.begin(), soa.begin() + 10);
+		REQUIRE(soa[0] == Flags(10, false, true));
+		soa.insert(soa.begin() + 1, 2, Flags(-1, true, false));
+		REQUIRE_IT_EQUALS(std::ranges::subrange(soa.begin(), soa.begin() + 4), std::initializer_list<Flags>{
+			Flags(10, false, true), Flags(-1, true, false), Flags(-1, true, false), Flags(11, false, true)
+		});
+		REQUIRE(soa.field<"alive">().count() == 32);
+		soa.resize(64);
+		REQUIRE(soa.field<"visible">().words().size() == 1);
+		REQUIRE(soa.field<"visible">().count() == 62);
+	}
+
+	SECTION("comparison") {
+		REQUIRE(soa[0] == Flags(0, true, true));
+		REQUIRE(soa[0] != soa[3]);
+		REQUIRE(soa[0] < soa[1]);
+		REQUIRE(soa.find_by<"alive">(false) == soa.begin() + 1);
+		REQUIRE(soa.find_by<"visible">(false) == soa.end());
+	}
+
+	SECTION("erase_if") {
+		REQUIRE(soa.erase_if<"alive", "id">([](bool alive, int id) { return !alive || id > 50; }) == 83);
+		REQUIRE(soa.field<"alive">().all());
+		REQUIRE_IT_EQUALS(soa.field<"id">(), std::initializer_list<int>{ 0, 3, 6, 9, 12, 15, 18, 21, 24, 27, 30, 33, 36, 39, 42, 45, 48 });
+		REQUIRE(soa.erase_if<"alive", "visible">([](bool alive, bool visible) { return alive && visible; }) == 17);
+		REQUIRE(soa.empty());
+	}
+
+	SECTION("memory_usage") {
+		auto usage = soa.memory_usage();
+		REQUIRE(usage[0].used_bytes == 100 * sizeof(int));
+		REQUIRE(usage[1].name == "alive");
+		REQUIRE(usage[1].used_bytes == 13);
+		REQUIRE(usage[2].allocated_bytes % 8 == 0);
+	}
+
+	SECTION("sorting") {
+		soa.sort_by<"alive">(std::greater<>());
+		REQUIRE(soa.field<"alive">().words()[0] == 0x3ffffffff);
+		REQUIRE(std::ranges::all_of(soa.field<"id">().first(34), [](int id) { return id % 3 == 0; }));
+		swap(soa[0], soa[99]);
+		REQUIRE(!soa[0].field<"alive">());
+		REQUIRE(soa[99].field<"alive">());
+	}
+}
+
+TEST_CASE("frozen_soa") {
+	FooSoA soa;
+	for (int i = 0; i < 3000; i++) {
+		soa.push_back(Foo(1000 + i, "hello " + std::to_string(i / 1000)));
+	}
+
+	SECTION("plain") {
+		auto frozen = soa.freeze();
+		REQUIRE(frozen.size() == 3000);
+		REQUIRE(frozen[1234] == Foo(2234, "hello 1"));
+	}
+
+	SECTION("dictionary and frame of reference encodings") {
+		auto frozen = soa.freeze<soa::encode<"i", soa::frame_of_reference_encoding<>>, soa::encode<"s", soa::dictionary_encoding<std::uint8_t>>>();
+		REQUIRE(frozen[0] == Foo(1000, "hello 0"));
+		REQUIRE(frozen[2999] == Foo(3999, "hello 2"));
+		REQUIRE_IT_EQUALS(frozen.field<"s">().values(), std::initializer_list<std::string>{ "hello 0", "hello 1", "hello 2" });
+		REQUIRE(frozen.field<"s">().codes()[1500] == 1);
+		REQUIRE(frozen.memory_usage() < soa.freeze().memory_usage() / 4);
+	}
+
+	SECTION("frame of reference encoding of small integers") {
+		std::vector<std::int16_t> values;
+		for (int i = 0; i < 128; i++) {
+			values.push_back(i % 2 ? 1 : -1);
+		}
+		soa::frame_of_reference_encoding<>::column<std::int16_t> column(values);
+		// One byte per offset, and the block header
+		REQUIRE(column.memory_usage() < values.size() * sizeof(std::int16_t));
+		REQUIRE(column[0] == -1);
+		REQUIRE(column[127] == 1);
+		std::vector<std::int16_t> decoded(values.size());
+		column.decode(0, values.size(), decoded.data());
+		REQUIRE(decoded == values);
+	}
+
+	SECTION("run length encoding") {
+		auto frozen = soa.freeze<soa::encode<"s", soa::run_length_encoding>>();
+		REQUIRE_IT_EQUALS(frozen.field<1>().ends(), std::initializer_list<size_t>{ 1000, 2000, 3000 });
+		REQUIRE(frozen[999].s == "hello 0");
+		REQUIRE(frozen[1000].s == "hello 1");
+	}
+
+	SECTION("for_each_block and thaw") {
+		auto frozen = soa.freeze<soa::encode<"i", soa::frame_of_reference_encoding<>>, soa::encode<"s", soa::run_length_encoding>>();
+		size_t blocks = 0;
+		long long sum = 0;
+		frozen.for_each_block<"i", "s">([&](std::span<const int> i_values, std::span<const std::string> s_values) {
+			REQUIRE(i_values.size() == s_values.size());
+			blocks++;
+			for (int i : i_values) {
+				sum += i;
+			}
+		});
+		REQUIRE(blocks == 3);
+		REQUIRE(sum == soa.reduce<"i">(0ll));
+		REQUIRE_IT_EQUALS(frozen.thaw(), soa);
+	}
+}
+
+TEST_CASE("slot_map<Foo>") {
+	Foo foo1(1, "hello 1");
+	Foo foo2(2, "hello 2");
+	Foo foo3(3, "hello 3");
+	soa::slot_map<Foo> map;
+	auto handle1 = map.insert(foo1);
+	auto handle2 = map.insert(foo2);
+	auto handle3 = map.emplace(3, "hello 3");
+
+	SECTION("handles survive erasure") {
+		REQUIRE(map.size() == 3);
+		REQUIRE(map.erase(handle1));
+		REQUIRE(!map.contains(handle1));
+		REQUIRE(!map.erase(handle1));
+		REQUIRE(map[handle2] == foo2);
+		REQUIRE(map[handle3] == foo3);
+		REQUIRE(map.index_of(handle3) == 0);
+		REQUIRE(map.handle_of(0) == handle3);
+		REQUIRE_IT_EQUALS(map.field<"i">(), std::initializer_list<int>{ 3, 2 });
+		REQUIRE_THROWS_AS(map.at(handle1), std::out_of_range);
+	}
+
+	SECTION("slots are reused with a new generation") {
+		map.erase(handle2);
+		auto handle4 = map.insert(foo1);
+		REQUIRE(handle4.index == handle2.index);
+		REQUIRE(handle4 != handle2);
+		REQUIRE(!map.contains(handle2));
+		REQUIRE(map.at(handle4) == foo1);
+		map.at(handle4).field<"i">() = 4;
+		REQUIRE(map.values().reduce<"i">(0) == 8);
+	}
+
+	SECTION("clear") {
+		map.clear();
+		REQUIRE(map.empty());
+		REQUIRE(!map.contains(handle3));
+		auto handle4 = map.insert(foo2);
+		REQUIRE(map.contains(handle4));
+		REQUIRE(map.size() == 1);
+	}
+}
+
+TEST_CASE("soa_index<Foo>") {
+	Foo foo1(1, "hello 1");
+	Foo foo2(2, "hello 2");
+	Foo foo3(3, "hello 3");
+	FooSoA soa({ foo1, foo2 });
+	soa::soa_index<"i", FooSoA> by_i(soa);
+
+	SECTION("find") {
+		REQUIRE(by_i.size() == 2);
+		REQUIRE(by_i.find(1) == soa.begin());
+		REQUIRE(by_i.find(2) == soa.begin() + 1);
+		REQUIRE(by_i.find(3) == soa.end());
+		by_i.push_back(foo3);
+		REQUIRE(*by_i.find(3) == foo3);
+		by_i.emplace_back(4, "hello 4");
+		REQUIRE(by_i.contains(4));
+		by_i.pop_back();
+		REQUIRE(!by_i.contains(4));
+		by_i.clear();
+		REQUIRE(soa.empty());
+		REQUIRE(!by_i.contains(1));
+	}
+
+	SECTION("erase") {
+		by_i.push_back(foo3);
+		auto it = by_i.erase(soa.begin());
+		REQUIRE(*it == foo2);
+		REQUIRE(!by_i.contains(1));
+		REQUIRE(by_i.find(3) == soa.begin() + 1);
+		it = by_i.erase_unordered(soa.begin());
+		REQUIRE(*it == foo3);
+		REQUIRE(by_i.find(3) == soa.begin());
+		REQUIRE(!by_i.contains(2));
+	}
+
+	SECTION("rebuild") {
+		by_i.assign({ foo3, foo2 });
+		REQUIRE(by_i.find(3) == soa.begin());
+		REQUIRE(!by_i.contains(1));
+		soa.sort_by<"i">();
+		by_i.rebuild();
+		REQUIRE(by_i.find(3) == soa.begin() + 1);
+	}
+
+	SECTION("many keys") {
+		by_i.clear();
+		for (int i = 0; i < 1000; i++) {
+			by_i.push_back(Foo(i * 1024, std::to_string(i)));
+		}
+		REQUIRE(by_i.bucket_count() * 3 >= by_i.size() * 4);
+		for (int i = 0; i < 1000; i += 3) {
+			by_i.erase_unordered(by_i.find(i * 1024));
+		}
+		for (int i = 0; i < 1000; i++) {
+			auto it = by_i.find(i * 1024);
+			if (i % 3 == 0) {
+				REQUIRE(it == soa.end());
+			}
+			else {
+				REQUIRE((*it).field<"s">() == std::to_string(i));
+			}
+		}
+	}
+}
+
+TEST_CASE("concurrent_soa<Foo>") {
+	soa::concurrent_soa<Foo> soa;
+
+	SECTION("push_back") {
+		REQUIRE(soa.empty());
+		REQUIRE(soa.push_back(Foo(1, "hello 1")) == 0);
+		REQUIRE(soa.emplace_back(2, "hello 2") == 1);
+		std::array<Foo, 2> values({ Foo(3, "hello 3"), Foo(4, "hello 4") });
+		REQUIRE(soa.append(values.begin(), values.end()) == 2);
+		REQUIRE(soa.size() == 4);
+		REQUIRE(soa.value(2) == Foo(3, "hello 3"));
+		soa.field<"i">(3) = 5;
+		REQUIRE(soa.field<std::string>(3) == "hello 4");
+		REQUIRE(soa.to_soa()[3] == Foo(5, "hello 4"));
+		soa.clear();
+		REQUIRE(soa.empty());
+
+		// Iterators returning elements by value, and SoA proxies
+		auto generated = std::views::iota(0, 4) | std::views::transform([](int i) { return Foo(i, std::string(40, 'a')); });
+		REQUIRE(soa.append(generated.begin(), generated.end()) == 0);
+		REQUIRE(soa.value(3) == Foo(3, std::string(40, 'a')));
+		FooSoA source({ Foo(4, "hello 4"), Foo(5, "hello 5") });
+		REQUIRE(soa.append(source.begin(), source.end()) == 4);
+		REQUIRE(soa.value(5) == Foo(5, "hello 5"));
+		REQUIRE(source[1] == Foo(5, "hello 5"));
+		soa.clear();
+		REQUIRE(soa.empty());
+	}
+
+	SECTION("segments") {
+		for (int i = 0; i < 5000; i++) {
+			soa.push_back(Foo(i, std::to_string(i)));
+		}
+		const int *first = &soa.field<"i">(0);
+		std::vector<size_t> chunk_sizes;
+		soa.for_each_chunk<"i", "s">([&](std::span<const int> i, std::span<const std::string> s) {
+			chunk_sizes.push_back(i.size());
+			REQUIRE(s.size() == i.size());
+			REQUIRE(s.back() == std::to_string(i.back()));
+		});
+		REQUIRE_IT_EQUALS(chunk_sizes, std::initializer_list<size_t>{ 1024, 1024, 2048, 904 });
+		soa.reserve(100000);
+		REQUIRE(&soa.field<"i">(0) == first);
+	}
+
+	SECTION("failed appends claim no rows") {
+		soa::concurrent_soa<Foo, LimitedAllocator<Foo>> limited;
+		AllocationLimit::limit = 1;
+		for (int i = 0; i < 1024; i++) {
+			limited.push_back(Foo(i, ""));
+		}
+		REQUIRE_THROWS_AS(limited.push_back(Foo(1024, "")), std::bad_alloc);
+		REQUIRE(limited.size() == 1024);
+		AllocationLimit::limit = std::numeric_limits<size_t>::max();
+		REQUIRE(limited.emplace_back(1024, "") == 1024);
+		REQUIRE(limited.size() == 1025);
+
+		soa::concurrent_soa<Sample> samples;
+		Sample sample(1, ThrowingCopy(2));
+		samples.push_back(sample);
+		ThrowingCopy::throws = true;
+		REQUIRE_THROWS_AS(samples.push_back(sample), std::runtime_error);
+		REQUIRE_THROWS_AS(samples.emplace_back(3, sample.payload), std::runtime_error);
+		std::array<Sample, 2> values;
+		REQUIRE_THROWS_AS(samples.append(values.begin(), values.end()), std::runtime_error);
+		ThrowingCopy::throws = false;
+		REQUIRE(samples.size() == 1);
+		REQUIRE(samples.append(values.begin(), values.end()) == 1);
+		REQUIRE(samples.emplace_back(4, ThrowingCopy(5)) == 3);
+		REQUIRE(samples.field<"payload">(3).value == 5);
+	}
+
+	SECTION("concurrent producers") {
+		constexpr int thread_count = 4;
+		constexpr int count = 10000;
+		std::vector<std::thread> threads;
+		for (int t = 0; t < thread_count; t++) {
+			threads.emplace_back([&, t] {
+				for (int i = 0; i < count; i++) {
+					soa.emplace_back(t * count + i, std::to_string(t));
+				}
+			});
+		}
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+		REQUIRE(soa.size() == thread_count * count);
+		long long sum = 0;
+		soa.for_each_chunk<"i">([&](std::span<const int> i) {
+			sum = std::accumulate(i.begin(), i.end(), sum);
+		});
+		REQUIRE(sum == (long long) thread_count * count * (thread_count * count - 1) / 2);
+		for (size_t row = 0; row < soa.size(); row++) {
+			REQUIRE(soa.field<"s">(row) == std::to_string(soa.field<"i">(row) / count));
+		}
+	}
+}
+
+TEST_CASE("tracked_soa<Foo>") {
+	using TrackedSoA = soa::tracked_soa<Foo, std::allocator<Foo>, soa::vector_storage, 4>;
+	using row_range = TrackedSoA::row_range;
+	TrackedSoA soa;
+	for (int i = 0; i < 20; i++) {
+		soa.push_back(Foo(i, std::to_string(i)));
+	}
+	REQUIRE_IT_EQUALS(soa.dirty_ranges<"i">(), std::initializer_list<row_range>{ { 0, 20 } });
+	soa.clear_dirty();
+
+	SECTION("writes") {
+		for (int& i : soa.write<"i">(5, 2)) {
+			i = -i;
+		}
+		REQUIRE(soa[5].field<"i">() == -5);
+		REQUIRE(soa.field<"i">()[6] == -6);
+		soa.mark_dirty<std::string>(17, 18);
+		REQUIRE_IT_EQUALS(soa.dirty_ranges<"i">(), std::initializer_list<row_range>{ { 4, 8 } });
+		REQUIRE_IT_EQUALS(soa.dirty_ranges<"s">(), std::initializer_list<row_range>{ { 4, 8 }, { 16, 20 } });
+		REQUIRE(soa.is_dirty<"s">(16));
+		REQUIRE(!soa.is_dirty<"s">(12));
+		soa.clear_dirty<"s">();
+		REQUIRE(soa.dirty_ranges<1>().empty());
+		REQUIRE(soa.dirty_ranges<0>().size() == 1);
+	}
+
+	SECTION("insert and erase") {
+		soa.insert(soa.begin() + 13, Foo(-1, ""));
+		REQUIRE_IT_EQUALS(soa.dirty_ranges<"s">(), std::initializer_list<row_range>{ { 12, 21 } });
+		soa.clear_dirty();
+		soa.erase(soa.begin() + 9, soa.begin() + 11);
+		REQUIRE_IT_EQUALS(soa.dirty_ranges<"i">(), std::initializer_list<row_range>{ { 8, 19 } });
+		soa.clear_dirty();
+		soa.erase_unordered(soa.begin() + 1);
+		REQUIRE_IT_EQUALS(soa.dirty_ranges<"i">(), std::initializer_list<row_range>{ { 0, 4 } });
+		REQUIRE((*(soa.begin() + 1)).field<"i">() == 19);
+		soa.clear_dirty();
+		soa.resize(5);
+		REQUIRE(soa.dirty_ranges<"i">().empty());
+		soa.resize(7);
+		REQUIRE_IT_EQUALS(soa.dirty_ranges<"i">(), std::initializer_list<row_range>{ { 4, 7 } });
+	}
+}
+
+TEST_CASE("pmr::soa<Foo>") {
+	Foo foo1(1, "hello 1");
+	Foo foo2(2, "hello 2");
+
+	SECTION("vector_storage") {
+		std::array<std::byte, 4096> buffer;
+		std::pmr::monotonic_buffer_resource resource(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+		soa::pmr::soa<Foo> soa(&resource);
+		REQUIRE(soa.get_allocator().resource() == &resource);
+		soa.push_back(foo1);
+		soa.push_back(foo2);
+		REQUIRE(soa[0] == foo1);
+		REQUIRE(soa[1] == foo2);
+		REQUIRE_THROWS_AS(soa.reserve(buffer.size()), std::bad_alloc);
+	}
+
+	SECTION("block_storage") {
+		std::array<std::byte, 4096> buffer;
+		std::pmr::monotonic_buffer_resource resource(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+		soa::pmr::soa<Foo, soa::block_storage> soa(&resource);
+		REQUIRE(soa.get_allocator().resource() == &resource);
+		soa.push_back(foo1);
+		soa.push_back(foo2);
+		REQUIRE(soa[0] == foo1);
+		REQUIRE(soa[1] == foo2);
+		REQUIRE_THROWS_AS(soa.reserve(buffer.size()), std::bad_alloc);
+		REQUIRE(soa.size() == 2);
+	}
+
+	SECTION("copy with allocator") {
+		std::pmr::monotonic_buffer_resource resource;
+		soa::pmr::soa<Foo> soa({ foo1, foo2 });
+		soa::pmr::soa<Foo> soa_copy(soa, &resource);
+		REQUIRE(soa_copy.get_allocator().resource() == &resource);
+		REQUIRE_IT_EQUALS(soa, soa_copy);
+	}
+
+	SECTION("cow_storage") {
+		std::pmr::monotonic_buffer_resource resource;
+		soa::pmr::soa<Foo, soa::cow_storage> soa({ foo1, foo2 });
+		soa::pmr::soa<Foo, soa::cow_storage> shared_copy(soa);
+		soa::pmr::soa<Foo, soa::cow_storage> soa_copy(soa, &resource);
+		REQUIRE(soa_copy.get_allocator().resource() == &resource);
+		REQUIRE(std::as_const(shared_copy).field<"s">().data() == std::as_const(soa).field<"s">().data());
+		REQUIRE(std::as_const(soa_copy).field<"s">().data() != std::as_const(soa).field<"s">().data());
+		REQUIRE_IT_EQUALS(soa, soa_copy);
+	}
+
+	SECTION("move with allocator") {
+		std::pmr::monotonic_buffer_resource resource;
+		soa::pmr::soa<Foo> soa({ foo1, foo2 });
+		soa::pmr::soa<Foo> moved(std::move(soa), &resource);
+		REQUIRE(moved.get_allocator().resource() == &resource);
+		REQUIRE_IT_EQUALS(moved, std::initializer_list<Foo>{ foo1, foo2 });
+
+		soa::pmr::soa<Foo, soa::block_storage> block({ foo1, foo2 });
+		const int *data = block.field<"i">().data();
+		soa::pmr::soa<Foo, soa::block_storage> stolen(std::move(block), block.get_allocator());
+		REQUIRE(stolen.field<"i">().data() == data);
+		soa::pmr::soa<Foo, soa::block_storage> moved_block(std::move(stolen), &resource);
+		REQUIRE(moved_block.get_allocator().resource() == &resource);
+		REQUIRE(stolen.empty());
+		REQUIRE_IT_EQUALS(moved_block, std::initializer_list<Foo>{ foo1, foo2 });
+	}
+}
+
+TEST_CASE("allocator-extended constructors") {
+	Foo foo1(1, "hello 1");
+	Foo foo2(2, "hello 2");
+	std::initializer_list<Foo> foo_ilist = { foo1, foo2 };
+
+	// Columns must be built from the given allocator, even when copy assignment would propagate the allocator of the source
+	auto check = [&]<typename Storage>(Storage) {
+		using ArenaSoA = soa::soa<Foo, ArenaAllocator<Foo>, Storage>;
+		ArenaSoA soa(foo_ilist, ArenaAllocator<Foo>(1));
+		ArenaCounts::allocations = {};
+		ArenaSoA copy(soa, ArenaAllocator<Foo>(2));
+		REQUIRE(ArenaCounts::allocations[1] == 0);
+		REQUIRE(copy.get_allocator().arena == 2);
+		REQUIRE_IT_EQUALS(copy, foo_ilist);
+		ArenaSoA moved(std::move(soa), ArenaAllocator<Foo>(2));
+		REQUIRE(ArenaCounts::allocations[1] == 0);
+		REQUIRE(moved.get_allocator().arena == 2);
+		REQUIRE_IT_EQUALS(moved, foo_ilist);
+	};
+
+	SECTION("vector_storage") {
+		check(soa::vector_storage{});
+	}
+	SECTION("block_storage") {
+		check(soa::block_storage{});
+	}
+	SECTION("chunked_storage") {
+		check(soa::chunked_storage<4>{});
+	}
+	SECTION("cow_storage") {
+		check(soa::cow_storage{});
+	}
+	SECTION("hot_cold_storage") {
+		check(soa::hot_cold_storage<"i">{});
+	}
+	SECTION("instrumented_storage") {
+		check(soa::instrumented_storage<>{});
+	}
+	SECTION("packed_bool_storage") {
+		using FlagsSoA = soa::soa<Flags, ArenaAllocator<Flags>, soa::packed_bool_storage>;
+		FlagsSoA flags({ Flags(1, true, false), Flags(2, false, true) }, ArenaAllocator<Flags>(1));
+		ArenaCounts::allocations = {};
+		FlagsSoA copy(flags, ArenaAllocator<Flags>(2));
+		FlagsSoA moved(std::move(flags), ArenaAllocator<Flags>(2));
+		REQUIRE(ArenaCounts::allocations[1] == 0);
+		REQUIRE(moved[1] == Flags(2, false, true));
+		REQUIRE(copy[0] == Flags(1, true, false));
+	}
+}
+
+TEST_CASE("soa<MoveOnly>") {
+	SECTION("vector_storage") {
+		soa::soa<MoveOnly> soa;
+		soa.push_back(MoveOnly(1, std::make_unique<int>(1)));
+		soa.emplace_back(3, std::make_unique<int>(3));
+		soa.insert(soa.begin() + 1, MoveOnly(2, std::make_unique<int>(2)));
+		soa.emplace(soa.begin(), 0, std::make_unique<int>(0));
+		REQUIRE(soa.size() == 4);
+		for (int i = 0; i < 4; i++) {
+			REQUIRE(soa[i].field<"i">() == i);
+			REQUIRE(*soa[i].field<"p">() == i);
+		}
+
+		MoveOnly value(5, std::make_unique<int>(5));
+		soa[0] = std::move(value);
+		REQUIRE(value.p == nullptr);
+		REQUIRE(*soa[0].field<"p">() == 5);
+	}
+
+	SECTION("block_storage") {
+		soa::soa<MoveOnly, std::allocator<MoveOnly>, soa::block_storage> soa;
+		soa.push_back(MoveOnly(1, std::make_unique<int>(1)));
+		soa.emplace_back(3, std::make_unique<int>(3));
+		soa.insert(soa.begin() + 1, MoveOnly(2, std::make_unique<int>(2)));
+		soa.emplace(soa.begin(), 0, std::make_unique<int>(0));
+		REQUIRE(soa.size() == 4);
+		for (int i = 0; i < 4; i++) {
+			REQUIRE(soa[i].field<"i">() == i);
+			REQUIRE(*soa[i].field<"p">() == i);
+		}
+
+		soa.erase(soa.begin());
+		REQUIRE(*soa[0].field<"p">() == 1);
+		REQUIRE(soa.erase_if<"i">([](int i) { return i == 2; }) == 1);
+		REQUIRE(*soa[1].field<"p">() == 3);
+	}
+
+	SECTION("chunked_storage") {
+		soa::soa<MoveOnly, std::allocator<MoveOnly>, soa::chunked_storage<2>> soa;
+		soa.push_back(MoveOnly(1, std::make_unique<int>(1)));
+		soa.emplace_back(3, std::make_unique<int>(3));
+		soa.insert(soa.begin() + 1, MoveOnly(2, std::make_unique<int>(2)));
+		soa.emplace(soa.begin(), 0, std::make_unique<int>(0));
+		REQUIRE(soa.size() == 4);
+		for (int i = 0; i < 4; i++) {
+			REQUIRE(soa[i].field<"i">() == i);
+			REQUIRE(*soa[i].field<"p">() == i);
+		}
+
+		soa.erase(soa.begin());
+		REQUIRE(*soa[0].field<"p">() == 1);
+		REQUIRE(soa.erase_if<"i">([](int i) { return i == 2; }) == 1);
+		REQUIRE(*soa[1].field<"p">() == 3);
+	}
+}
+
+#ifdef SOA_EXECUTION_POLICIES
+TEST_CASE("execution policies") {
+	Foo foo1(1, "hello 1");
+	Foo foo2(2, "hello 2");
+	Foo foo3(3, "hello 3");
+
+	SECTION("vector_storage") {
+		FooSoA soa;
+		soa.assign(std::execution::par, 100, foo1);
+		REQUIRE(soa.size() == 100);
+		REQUIRE(soa[99] == foo1);
+		soa.resize(std::execution::par, 200, foo2);
+		REQUIRE(soa[199] == foo2);
+		soa.erase(std::execution::par, soa.begin(), soa.begin() + 150);
+		REQUIRE(soa.size() == 50);
+		REQUIRE(soa[0] == foo2);
+		soa.reserve(std::execution::par, 1000);
+		REQUIRE(soa.capacity() >= 1000);
+		soa.shrink_to_fit(std::execution::par);
+		REQUIRE(soa.capacity() == 50);
+		soa.clear(std::execution::par);
+		REQUIRE(soa.empty());
+	}
+
+	SECTION("block_storage") {
+		soa::soa<Foo, std::allocator<Foo>, soa::block_storage> soa;
+		soa.assign(std::execution::par, 100, foo1);
+		REQUIRE(soa.size() == 100);
+		REQUIRE(soa[99] == foo1);
+		soa.resize(std::execution::par, 200, foo2);
+		REQUIRE(soa[199] == foo2);
+		soa.erase(std::execution::par, soa.begin(), soa.begin() + 150);
+		REQUIRE(soa.size() == 50);
+		REQUIRE(soa[0] == foo2);
+		soa.reserve(std::execution::par, 1000);
+		REQUIRE(soa.capacity() == 1000);
+		REQUIRE(soa[49] == foo2);
+		soa.shrink_to_fit(std::execution::par);
+		REQUIRE(soa.capacity() == 50);
+		soa.clear(std::execution::par);
+		REQUIRE(soa.empty());
+	}
+
+	SECTION("sort_by") {
+		FooSoA soa;
+		for (int i = 0; i < 1000; i++) {
+			soa.push_back(Foo((i * 7) % 1000, std::to_string(i)));
+		}
+		soa.sort_by<"i">(std::execution::par);
+		for (int i = 0; i < 1000; i++) {
+			REQUIRE(soa[i].field<"i">() == i);
+			REQUIRE(std::stoi(soa[i].field<"s">()) * 7 % 1000 == i);
+		}
+		soa.stable_sort_by<"s">(std::execution::par, std::greater<>());
+		REQUIRE(soa[0].field<"s">() == "999");
+		REQUIRE(soa.erase_if<"i">(std::execution::par, [](int i) { return i % 2; }) == 500);
+		REQUIRE(soa.size() == 500);
+		REQUIRE(soa.reduce<"i">(0) == 249500);
+		REQUIRE(std::stoi(soa[0].field<"s">()) * 7 % 1000 == soa[0].field<"i">());
+	}
+
+	SECTION("parallel_for") {
+		FooSoA soa;
+		for (int i = 0; i < 10000; i++) {
+			soa.push_back(Foo(i, std::to_string(i % 10)));
+		}
+		// Catch2 assertions are not thread safe, so tasks only count unaligned chunks
+		std::atomic<size_t> task_count = 0;
+		std::atomic<size_t> unaligned_count = 0;
+		soa.parallel_for<"i", "s">(std::execution::par, [&](std::span<int> i, std::span<const std::string> s) {
+			if ((i.data() - soa.field<"i">().data()) % 64 != 0 || i.size() != s.size()) {
+				unaligned_count++;
+			}
+			for (size_t k = 0; k < i.size(); k++) {
+				i[k] += std::stoi(s[k]);
+			}
+			task_count++;
+		}, 1000);
+		REQUIRE(task_count == 10);
+		REQUIRE(unaligned_count == 0);
+		REQUIRE(soa[1234].field<"i">() == 1238);
+		std::atomic<long long> sum = 0;
+		std::as_const(soa).parallel_for<int>(std::execution::par, [&](std::span<const int> i) {
+			sum += std::accumulate(i.begin(), i.end(), 0ll);
+		});
+		REQUIRE(sum == 49995000 + 45000);
+	}
+
+	SECTION("parallel_for over tiles") {
+		soa::soa<Foo, std::allocator<Foo>, soa::tiled_storage<128>> soa;
+		for (int i = 0; i < 1000; i++) {
+			soa.push_back(Foo(i, ""));
+		}
+		std::atomic<size_t> max_size = 0;
+		soa.parallel_for<"i">(std::execution::par, [&](std::span<int> i) {
+			for (int& value : i) {
+				value *= 2;
+			}
+			size_t previous = max_size;
+			while (previous < i.size() && !max_size.compare_exchange_weak(previous, i.size())) {}
+		}, 1);
+		REQUIRE(max_size == 128);
+		REQUIRE(soa.reduce<"i">(0) == 999000);
+	}
+}
+#endif